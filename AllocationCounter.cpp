@@ -0,0 +1,142 @@
+#include "AllocationCounter.h"
+
+#ifdef GRAPH_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *memory, std::size_t size);
+void __libc_free(void *memory);
+}
+#endif
+
+namespace {
+
+// Initial-exec, so that reading it from malloc() never allocates the TLS
+// block itself.
+#if defined(__GNUC__)
+__attribute__((tls_model("initial-exec")))
+#endif
+thread_local quint64 t_allocations = 0;
+
+void *rawAllocate(std::size_t size)
+{
+#if defined(__GLIBC__)
+    return __libc_malloc(size);
+#else
+    return std::malloc(size);
+#endif
+}
+
+void rawFree(void *memory)
+{
+#if defined(__GLIBC__)
+    __libc_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void *countedAllocate(std::size_t size)
+{
+    ++t_allocations;
+    if (void *memory = rawAllocate(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+#if defined(__GLIBC__)
+// Qt containers and C libraries allocate through malloc() rather than
+// operator new; glibc lets the executable interpose these and forward to
+// the real implementation. Elsewhere only operator new is counted.
+extern "C" {
+
+void *malloc(std::size_t size)
+{
+    ++t_allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    ++t_allocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, std::size_t size)
+{
+    // Counted even when the block grows in place; callers cannot tell.
+    if (size > 0)
+        ++t_allocations;
+    return __libc_realloc(memory, size);
+}
+
+void free(void *memory)
+{
+    __libc_free(memory);
+}
+
+} // extern "C"
+#endif
+
+void *operator new(std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAllocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    ++t_allocations;
+    return rawAllocate(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    ++t_allocations;
+    return rawAllocate(size ? size : 1);
+}
+
+void operator delete(void *memory) noexcept
+{
+    rawFree(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    rawFree(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    rawFree(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    rawFree(memory);
+}
+
+quint64 AllocationCounter::count()
+{
+    return t_allocations;
+}
+
+#else
+
+quint64 AllocationCounter::count()
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// Heap allocation count of the calling thread, for checking that hot paths
+// stay allocation free. Building with GRAPH_COUNT_ALLOCATIONS (set for debug
+// builds of GraphBenchmarks only) replaces the global operator new, and with
+// glibc also malloc(), calloc() and realloc(), to count; otherwise
+// isEnabled() is false and count() stays 0.
+class AllocationCounter
+{
+public:
+    static constexpr bool isEnabled()
+    {
+#ifdef GRAPH_COUNT_ALLOCATIONS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static quint64 count();
+};
+
+// Allocations made by the thread between construction and allocations().
+class AllocationScope
+{
+public:
+    AllocationScope() : m_start(AllocationCounter::count()) {}
+    quint64 allocations() const { return AllocationCounter::count() - m_start; }
+
+private:
+    quint64 m_start;
+};
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,234 @@
+#include "BatchRenderer.h"
+#include "DataProvider.h"
+#include "ReplaySource.h"
+#include "SessionFile.h"
+#include "Trace.h"
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImage>
+#include <QRunnable>
+#include <QSvgGenerator>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <cstring>
+
+namespace {
+
+constexpr int ReadBufferSize = 16384;
+
+} // namespace
+
+class BatchRenderer::Worker : public QRunnable
+{
+public:
+    explicit Worker(BatchRenderer *batch)
+        : m_batch(batch)
+        , m_options(batch->m_options)
+        , m_provider(nullptr)
+    {
+    }
+
+    void run() override
+    {
+        GRAPH_TRACE_FUNCTION(TraceRender);
+        // Created here so that it lives in the worker thread.
+        DataProvider provider;
+        // Every sample of a job is rendered or exported, not just the
+        // newest hour.
+        provider.setRawRetention(0);
+        m_provider = &provider;
+        m_renderer.setStyle(m_options.style);
+        m_renderer.setSize(m_options.size);
+        m_readBuffer.resize(ReadBufferSize);
+
+        if (m_options.format == PngFormat) {
+            m_image = QImage(m_options.size * m_options.devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+            m_image.setDevicePixelRatio(m_options.devicePixelRatio);
+        }
+
+        for (;;) {
+            const int input = m_batch->m_nextInput.fetch_add(1, std::memory_order_relaxed);
+            if (input >= m_options.inputs.size())
+                break;
+            const QString &path = m_options.inputs.at(input);
+            if (render(path, m_batch->outputPath(path))) {
+                m_batch->m_rendered.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                m_batch->m_failed.fetch_add(1, std::memory_order_relaxed);
+                qWarning("Failed to render %s", qPrintable(path));
+            }
+            // Drops the chunks or the session mapping of this job.
+            m_provider->clearData();
+        }
+        m_provider = nullptr;
+    }
+
+private:
+    bool load(const QString &path)
+    {
+        if (SessionFile::isSessionFile(path))
+            return m_provider->openSession(path);
+
+        CsvReplaySource source(path);
+        if (!source.isOpen())
+            return false;
+        m_provider->clearData();
+        int count = 0;
+        while ((count = source.read(m_readBuffer.data(), m_readBuffer.size())) > 0)
+            m_provider->appendPoints(m_readBuffer.constData(), count);
+        return true;
+    }
+
+    bool render(const QString &input, const QString &output)
+    {
+        GRAPH_TRACE_SCOPE(TraceRender, "batchRenderJob");
+        if (!load(input))
+            return false;
+
+        const DataSnapshot snapshot = m_provider->snapshot();
+        const double peakPower = m_provider->getPeakPower();
+        m_renderer.mapPoints(snapshot, peakPower, m_options.devicePixelRatio, true, m_decimator,
+                             m_mappedPoints, m_pixelPoints);
+
+        if (m_options.format == SvgFormat) {
+            QSvgGenerator generator;
+            generator.setFileName(output);
+            generator.setSize(m_options.size);
+            generator.setViewBox(QRect(QPoint(0, 0), m_options.size));
+            generator.setTitle(QFileInfo(input).completeBaseName());
+            if (!m_painter.begin(&generator))
+                return false;
+            m_painter.setRenderHint(QPainter::Antialiasing, true);
+            m_renderer.drawChrome(&m_painter);
+            m_renderer.drawData(&m_painter, snapshot, peakPower, m_pixelPoints);
+            return m_painter.end();
+        }
+
+        // Size and style are the same for every job, so the renderer keeps
+        // the chrome layer and it is only copied under each graph.
+        const QImage &chrome = m_renderer.chromeLayer(m_options.devicePixelRatio);
+        std::memcpy(m_image.bits(), chrome.constBits(), size_t(chrome.sizeInBytes()));
+        m_painter.begin(&m_image);
+        m_painter.setRenderHint(QPainter::Antialiasing, true);
+        m_renderer.drawData(&m_painter, snapshot, peakPower, m_pixelPoints);
+        m_painter.end();
+        return m_image.save(output, "PNG");
+    }
+
+    BatchRenderer *m_batch;
+    const Options &m_options;
+    GraphRenderer m_renderer;
+    DataProvider *m_provider;
+    Decimator m_decimator;
+    QVector<DataPoint> m_readBuffer;
+    QVector<QPointF> m_mappedPoints;
+    QVector<QPointF> m_pixelPoints;
+    QPainter m_painter;
+    QImage m_image;
+};
+
+BatchRenderer::BatchRenderer(const Options &options)
+    : m_options(options)
+    , m_nextInput(0)
+    , m_rendered(0)
+    , m_failed(0)
+{
+}
+
+BatchRenderer::Result BatchRenderer::run()
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    m_nextInput = 0;
+    m_rendered = 0;
+    m_failed = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const int threads = m_options.threadCount > 0 ? m_options.threadCount : QThread::idealThreadCount();
+    const int workers = qMax(1, qMin(threads, int(m_options.inputs.size())));
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
+    for (int i = 0; i < workers; ++i)
+        pool.start(new Worker(this));
+    pool.waitForDone();
+
+    Result result;
+    result.rendered = m_rendered;
+    result.failed = m_failed;
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+QString BatchRenderer::outputPath(const QString &input) const
+{
+    const QString suffix = m_options.format == SvgFormat ? QStringLiteral(".svg") : QStringLiteral(".png");
+    return QDir(m_options.outputDirectory).filePath(QFileInfo(input).completeBaseName() + suffix);
+}
+
+bool BatchRenderer::isBatchInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0)
+            return true;
+    }
+    return false;
+}
+
+int BatchRenderer::exec(const QStringList &arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Renders recorded sessions to image files without a window.");
+    parser.addHelpOption();
+    QCommandLineOption batchOption("batch", "Run the headless batch renderer.");
+    QCommandLineOption outputOption(QStringList() << "o" << "output-dir", "Directory for the images.", "dir", ".");
+    QCommandLineOption formatOption("format", "png or svg (default png).", "format", "png");
+    QCommandLineOption sizeOption("size", "Image size in pixels (default 1280x720).", "WxH", "1280x720");
+    QCommandLineOption scaleOption("scale", "Device pixel ratio of PNG output (default 1).", "ratio", "1");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs", "Worker threads (default: one per core).", "count", "0");
+    parser.addOptions({ batchOption, outputOption, formatOption, sizeOption, scaleOption, jobsOption });
+    parser.addPositionalArgument("inputs", "Session or CSV files, or directories containing them.", "<inputs...>");
+    parser.process(arguments);
+
+    Options options;
+    options.outputDirectory = parser.value(outputOption);
+    options.format = parser.value(formatOption).compare(QLatin1String("svg"), Qt::CaseInsensitive) == 0
+                         ? SvgFormat : PngFormat;
+    const QStringList size = parser.value(sizeOption).split(QLatin1Char('x'));
+    if (size.size() == 2)
+        options.size = QSize(size.at(0).toInt(), size.at(1).toInt());
+    options.devicePixelRatio = qMax(0.1, parser.value(scaleOption).toDouble());
+    options.threadCount = parser.value(jobsOption).toInt();
+
+    for (const QString &input : parser.positionalArguments()) {
+        const QFileInfo info(input);
+        if (!info.isDir()) {
+            options.inputs.append(input);
+            continue;
+        }
+        const QFileInfoList entries = QDir(input).entryInfoList(QDir::Files, QDir::Name);
+        for (const QFileInfo &entry : entries)
+            options.inputs.append(entry.filePath());
+    }
+
+    QTextStream out(stdout);
+    if (options.inputs.isEmpty() || options.size.isEmpty()) {
+        out << parser.helpText();
+        return 1;
+    }
+    if (!QDir().mkpath(options.outputDirectory)) {
+        out << "Cannot create " << options.outputDirectory << "\n";
+        return 1;
+    }
+
+    BatchRenderer renderer(options);
+    const Result result = renderer.run();
+    const double seconds = qMax<qint64>(1, result.elapsedMs) / 1000.0;
+    out << "Rendered " << result.rendered << " of " << options.inputs.size() << " graphs in "
+        << QString::number(seconds, 'f', 2) << " s ("
+        << QString::number(result.rendered / seconds, 'f', 1) << " images/s)\n";
+    return result.failed == 0 ? 0 : 1;
+}
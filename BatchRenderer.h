@@ -0,0 +1,60 @@
+#ifndef BATCHRENDERER_H
+#define BATCHRENDERER_H
+
+#include <QSize>
+#include <QString>
+#include <QStringList>
+#include <atomic>
+#include "GraphRenderer.h"
+
+// Headless export of recorded sessions (binary or CSV) to PNG or SVG for
+// reports. Inputs are spread over a thread pool; each worker owns a
+// GraphRenderer, a QPainter, the point buffers and, for PNG, the target
+// image plus a pre-rendered chrome layer, all reused from job to job. Runs
+// without a window, so the offscreen platform plugin is enough.
+class BatchRenderer
+{
+public:
+    enum Format {
+        PngFormat,
+        SvgFormat
+    };
+
+    struct Options {
+        QStringList inputs;
+        QString outputDirectory;
+        Format format = PngFormat;
+        QSize size = QSize(1280, 720);
+        qreal devicePixelRatio = 1.0;
+        int threadCount = 0;
+        GraphRenderer::Style style;
+    };
+
+    struct Result {
+        int rendered = 0;
+        int failed = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    explicit BatchRenderer(const Options &options);
+
+    // Renders every input and blocks until all workers are done.
+    Result run();
+
+    // Command line front end: "--batch [options] <inputs...>". The check
+    // runs before QGuiApplication exists, so it only looks at argv.
+    static bool isBatchInvocation(int argc, char *argv[]);
+    static int exec(const QStringList &arguments);
+
+private:
+    class Worker;
+
+    QString outputPath(const QString &input) const;
+
+    Options m_options;
+    std::atomic<int> m_nextInput;
+    std::atomic<int> m_rendered;
+    std::atomic<int> m_failed;
+};
+
+#endif // BATCHRENDERER_H
@@ -0,0 +1,44 @@
+import QtQuick 2.15
+import QtQuick.Controls 2.15
+import GraphComponents 1.0
+
+// One live graph per charger bay of the provider registry. The graphs share
+// their title and style, so the window's render cache lays out their text
+// and renders their chrome once, and they map their points on the shared
+// geometry worker pool. GridView only instantiates the visible bays.
+GridView {
+    id: dashboard
+
+    property var registry: null
+    property FleetEnvelope envelope: null
+    readonly property int columns: Math.max(1, Math.floor(width / 420))
+
+    clip: true
+    cellWidth: width / columns
+    cellHeight: 320
+    model: registry ? registry.chargerIds : []
+    ScrollBar.vertical: ScrollBar {}
+
+    delegate: Item {
+        width: dashboard.cellWidth
+        height: dashboard.cellHeight
+
+        GraphItem {
+            anchors.fill: parent
+            anchors.margins: 4
+            graphPointsProvider: dashboard.registry ? dashboard.registry.provider(modelData) : null
+            threadedGeometry: true
+            envelope: dashboard.envelope
+        }
+
+        Text {
+            anchors.left: parent.left
+            anchors.top: parent.top
+            anchors.margins: 12
+            color: "#ffffff"
+            font.pixelSize: 16
+            font.bold: true
+            text: modelData
+        }
+    }
+}
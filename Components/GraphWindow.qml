@@ -8,4 +8,17 @@ GraphItem {
         anchors.fill: parent
         anchors.margins: 20
         graphPointsProvider: null
+
+        // Wheel zoom, drag pan and double-click reset are handled by the
+        // item itself; pinch comes from touch screens and touchpads.
+        PinchHandler {
+            property real lastScale: 1
+
+            target: null
+            onActiveChanged: lastScale = scale
+            onScaleChanged: {
+                powerGraph.zoomAt(scale / lastScale, centroid.position.x)
+                lastScale = scale
+            }
+        }
 }
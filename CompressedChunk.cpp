@@ -0,0 +1,317 @@
+#include "CompressedChunk.h"
+#include <QMutex>
+#include <QtAlgorithms>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
+namespace {
+
+// Raw bits of a sample, zero-extended to 64 bits.
+using SampleBits = std::conditional_t<sizeof(Sample) == 8, quint64, quint32>;
+
+quint64 toBits(Sample value)
+{
+    SampleBits bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+Sample fromBits(quint64 bits)
+{
+    const SampleBits narrowed = SampleBits(bits);
+    Sample value;
+    std::memcpy(&value, &narrowed, sizeof(value));
+    return value;
+}
+
+// Value widths of the delta buckets. A zero is a single 0 bit; bucket i is
+// i + 1 one bits and a 0 followed by the zigzag encoded value. Five one
+// bits and no terminator announce a full 64 bit value.
+constexpr int DeltaWidths[] = { 7, 9, 12, 32 };
+constexpr int DeltaBuckets = 4;
+
+constexpr int MaxDecimals = 4;
+constexpr double DecimalScales[MaxDecimals + 1] = { 1.0, 10.0, 100.0, 1000.0, 10000.0 };
+
+Sample fromDecimal(qint64 value, int decimals)
+{
+    return Sample(double(value) / DecimalScales[decimals]);
+}
+
+// Telemetry is usually a fixed number of decimals, whose doubles differ in
+// nearly every mantissa bit from one sample to the next. If every value of
+// a column is exactly such a decimal, the column is coded as the integers
+// instead. Returns the number of decimals, or -1 to code the raw bits.
+int decimalsOf(const Sample *values, int count)
+{
+    for (int decimals = 0; decimals <= MaxDecimals; ++decimals) {
+        bool exact = true;
+        for (int i = 0; i < count && exact; ++i) {
+            const double scaled = double(values[i]) * DecimalScales[decimals];
+            // Compared bitwise, so -0.0 and NaN stay raw.
+            exact = qAbs(scaled) < 9.0e15
+                    && toBits(fromDecimal(qint64(std::llround(scaled)), decimals)) == toBits(values[i]);
+        }
+        if (exact)
+            return decimals;
+    }
+    return -1;
+}
+
+qint64 toDecimal(Sample value, int decimals)
+{
+    return qint64(std::llround(double(value) * DecimalScales[decimals]));
+}
+
+// Bits are packed LSB first into 64 bit words.
+class BitWriter
+{
+public:
+    explicit BitWriter(QVector<quint64> &words)
+        : m_words(words)
+        , m_bitCount(0)
+    {
+    }
+
+    void write(quint64 value, int count)
+    {
+        if (count < 64)
+            value &= (quint64(1) << count) - 1;
+        const int used = int(m_bitCount & 63);
+        if (used == 0)
+            m_words.append(0);
+        m_words.last() |= value << used;
+        if (used + count > 64)
+            m_words.append(value >> (64 - used));
+        m_bitCount += count;
+    }
+
+    void writeDelta(qint64 value)
+    {
+        const quint64 zigzag = (quint64(value) << 1) ^ quint64(value >> 63);
+        if (zigzag == 0) {
+            write(0, 1);
+            return;
+        }
+        for (int bucket = 0; bucket < DeltaBuckets; ++bucket) {
+            if (zigzag < (quint64(1) << DeltaWidths[bucket])) {
+                write((quint64(1) << (bucket + 1)) - 1, bucket + 2);
+                write(zigzag, DeltaWidths[bucket]);
+                return;
+            }
+        }
+        write(0x1f, DeltaBuckets + 1);
+        write(zigzag, 64);
+    }
+
+private:
+    QVector<quint64> &m_words;
+    qsizetype m_bitCount;
+};
+
+// Decoded chunks kept alive beyond their last user; about 1.5 MB.
+constexpr int MaxCachedDecodedChunks = 16;
+
+QMutex decodeMutex;
+QVector<QSharedPointer<const DataChunk>> recentlyDecoded;
+
+} // namespace
+
+CompressedChunk::CompressedChunk(const DataChunk &chunk)
+    : m_size(chunk.size())
+    , m_summary(chunk.summary())
+    , m_socDecimals(-1)
+    , m_powerDecimals(-1)
+{
+    if (m_size == 0)
+        return;
+    m_first = chunk.at(0);
+    m_last = chunk.at(m_size - 1);
+
+    const Sample *soc = chunk.socData();
+    const Sample *power = chunk.powerData();
+    const qint64 *timestamp = chunk.timestampData();
+    m_socDecimals = decimalsOf(soc, m_size);
+    m_powerDecimals = decimalsOf(power, m_size);
+
+    BitWriter out(m_bits);
+    // Wrapping unsigned arithmetic keeps every delta exact.
+    quint64 previousTimestamp = quint64(timestamp[0]);
+    quint64 timestampDelta = 0;
+    quint64 previousSoc = socCode(soc[0]);
+    quint64 socDelta = 0;
+    quint64 previousPower = powerCode(power[0]);
+    int leading = -1;
+    int trailing = 0;
+    for (int i = 1; i < m_size; ++i) {
+        const quint64 t = quint64(timestamp[i]);
+        out.writeDelta(qint64((t - previousTimestamp) - timestampDelta));
+        timestampDelta = t - previousTimestamp;
+        previousTimestamp = t;
+
+        const quint64 s = socCode(soc[i]);
+        out.writeDelta(qint64((s - previousSoc) - socDelta));
+        socDelta = s - previousSoc;
+        previousSoc = s;
+
+        const quint64 p = powerCode(power[i]);
+        if (m_powerDecimals >= 0) {
+            // Power is noisy rather than a ramp: plain deltas are smaller.
+            out.writeDelta(qint64(p - previousPower));
+            previousPower = p;
+            continue;
+        }
+        const quint64 xorValue = p ^ previousPower;
+        previousPower = p;
+        if (xorValue == 0) {
+            out.write(0, 1);
+            continue;
+        }
+        const int newLeading = qCountLeadingZeroBits(xorValue);
+        const int newTrailing = qCountTrailingZeroBits(xorValue);
+        if (leading >= 0 && newLeading >= leading && newTrailing >= trailing) {
+            // Fits the previous window: '10' and the bits inside it.
+            out.write(0x1, 2);
+            out.write(xorValue >> trailing, 64 - leading - trailing);
+        } else {
+            // New window: '11', its leading zeros and length, the bits.
+            const int meaningful = 64 - newLeading - newTrailing;
+            out.write(0x3, 2);
+            out.write(quint64(newLeading), 6);
+            out.write(quint64(meaningful - 1), 6);
+            out.write(xorValue >> newTrailing, meaningful);
+            leading = newLeading;
+            trailing = newTrailing;
+        }
+    }
+    m_bits.squeeze();
+}
+
+quint64 CompressedChunk::socCode(Sample soc) const
+{
+    return m_socDecimals >= 0 ? quint64(toDecimal(soc, m_socDecimals)) : toBits(soc);
+}
+
+quint64 CompressedChunk::powerCode(Sample power) const
+{
+    return m_powerDecimals >= 0 ? quint64(toDecimal(power, m_powerDecimals)) : toBits(power);
+}
+
+Sample CompressedChunk::socValue(quint64 code) const
+{
+    return m_socDecimals >= 0 ? fromDecimal(qint64(code), m_socDecimals) : fromBits(code);
+}
+
+Sample CompressedChunk::powerValue(quint64 code) const
+{
+    return m_powerDecimals >= 0 ? fromDecimal(qint64(code), m_powerDecimals) : fromBits(code);
+}
+
+qsizetype CompressedChunk::byteSize() const
+{
+    return qsizetype(sizeof(*this)) + m_bits.capacity() * qsizetype(sizeof(quint64));
+}
+
+CompressedChunk::Reader::Reader(const CompressedChunk &chunk)
+    : m_chunk(&chunk)
+    , m_bit(0)
+    , m_index(0)
+    , m_timestamp(0)
+    , m_timestampDelta(0)
+    , m_soc(0)
+    , m_socDelta(0)
+    , m_power(0)
+    , m_leading(0)
+    , m_trailing(0)
+{
+}
+
+int CompressedChunk::Reader::read(Sample *soc, Sample *power, qint64 *timestamp, int max)
+{
+    const CompressedChunk &chunk = *m_chunk;
+    int count = 0;
+    if (m_index == 0 && max > 0 && !atEnd()) {
+        m_timestamp = quint64(chunk.m_first.getTimestamp());
+        m_soc = chunk.socCode(Sample(chunk.m_first.getSocPercentage()));
+        m_power = chunk.powerCode(Sample(chunk.m_first.getPower()));
+        soc[0] = chunk.socValue(m_soc);
+        power[0] = chunk.powerValue(m_power);
+        timestamp[0] = qint64(m_timestamp);
+        ++m_index;
+        ++count;
+    }
+
+    for (; count < max && !atEnd(); ++count, ++m_index) {
+        m_timestampDelta += quint64(readDelta());
+        m_timestamp += m_timestampDelta;
+        m_socDelta += quint64(readDelta());
+        m_soc += m_socDelta;
+
+        if (chunk.m_powerDecimals >= 0) {
+            m_power += quint64(readDelta());
+        } else if (readBits(1)) {
+            if (readBits(1)) {
+                m_leading = int(readBits(6));
+                const int meaningful = int(readBits(6)) + 1;
+                m_trailing = 64 - m_leading - meaningful;
+            }
+            m_power ^= readBits(64 - m_leading - m_trailing) << m_trailing;
+        }
+
+        soc[count] = chunk.socValue(m_soc);
+        power[count] = chunk.powerValue(m_power);
+        timestamp[count] = qint64(m_timestamp);
+    }
+    return count;
+}
+
+quint64 CompressedChunk::Reader::readBits(int count)
+{
+    const quint64 *words = m_chunk->m_bits.constData();
+    const qsizetype word = m_bit >> 6;
+    const int used = int(m_bit & 63);
+    quint64 value = words[word] >> used;
+    if (used + count > 64)
+        value |= words[word + 1] << (64 - used);
+    if (count < 64)
+        value &= (quint64(1) << count) - 1;
+    m_bit += count;
+    return value;
+}
+
+qint64 CompressedChunk::Reader::readDelta()
+{
+    int ones = 0;
+    while (ones <= DeltaBuckets && readBits(1))
+        ++ones;
+    if (ones == 0)
+        return 0;
+    const quint64 zigzag = readBits(ones <= DeltaBuckets ? DeltaWidths[ones - 1] : 64);
+    return qint64(zigzag >> 1) ^ -qint64(zigzag & 1);
+}
+
+QSharedPointer<const DataChunk> CompressedChunk::decoded() const
+{
+    {
+        QMutexLocker locker(&decodeMutex);
+        if (QSharedPointer<const DataChunk> chunk = m_decoded.toStrongRef())
+            return chunk;
+    }
+
+    // Decoded without the lock, so workers decoding different chunks do
+    // not wait for each other.
+    QSharedPointer<DataChunk> chunk = QSharedPointer<DataChunk>::create();
+    Reader reader(*this);
+    chunk->m_size = reader.read(chunk->m_soc, chunk->m_power, chunk->m_timestamp, m_size);
+    chunk->m_summary = m_summary;
+
+    QMutexLocker locker(&decodeMutex);
+    if (QSharedPointer<const DataChunk> other = m_decoded.toStrongRef())
+        return other;
+    m_decoded = chunk;
+    recentlyDecoded.append(chunk);
+    if (recentlyDecoded.size() > MaxCachedDecodedChunks)
+        recentlyDecoded.removeFirst();
+    return chunk;
+}
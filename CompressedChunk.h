@@ -0,0 +1,83 @@
+#ifndef COMPRESSEDCHUNK_H
+#define COMPRESSEDCHUNK_H
+
+#include <QSharedPointer>
+#include <QVector>
+#include "DataChunk.h"
+
+// Immutable, Gorilla-style compressed copy of a sealed DataChunk.
+// Timestamps and SOC are stored as delta-of-deltas, power as the XOR
+// against the previous value with the leading/trailing zero window of the
+// last one reused. A regular sample interval costs one bit per timestamp, a
+// steady SOC ramp a few bits per point and unchanged power one bit.
+//
+// The encoding is lossless. SOC is coded on its IEEE bit pattern, except
+// that a column whose values are all exact decimals with up to four
+// places (what telemetry sends) is coded as those integers, power then as
+// plain deltas rather than XORs.
+//
+// The summary and the first and last point are kept as they are, so
+// overviews and retention checks never decode.
+class CompressedChunk
+{
+public:
+    explicit CompressedChunk(const DataChunk &chunk);
+
+    int size() const { return m_size; }
+    const ChunkSummary &summary() const { return m_summary; }
+    const DataPoint &first() const { return m_first; }
+    const DataPoint &last() const { return m_last; }
+    // Memory held by the chunk, encoded stream included.
+    qsizetype byteSize() const;
+
+    // Streaming decoder: points come out in order, any number at a time.
+    class Reader
+    {
+    public:
+        explicit Reader(const CompressedChunk &chunk);
+
+        bool atEnd() const { return m_index >= m_chunk->m_size; }
+        // Decodes up to max points into the columns and returns how many.
+        int read(Sample *soc, Sample *power, qint64 *timestamp, int max);
+
+    private:
+        quint64 readBits(int count);
+        qint64 readDelta();
+
+        const CompressedChunk *m_chunk;
+        qsizetype m_bit;
+        int m_index;
+        quint64 m_timestamp;
+        quint64 m_timestampDelta;
+        quint64 m_soc;
+        quint64 m_socDelta;
+        quint64 m_power;
+        int m_leading;
+        int m_trailing;
+    };
+
+    // The whole chunk decoded. Everyone decoding the chunk at the same time
+    // shares one copy, and the most recently decoded chunks of the process
+    // stay cached. Thread-safe.
+    QSharedPointer<const DataChunk> decoded() const;
+
+private:
+    Q_DISABLE_COPY(CompressedChunk)
+
+    quint64 socCode(Sample soc) const;
+    quint64 powerCode(Sample power) const;
+    Sample socValue(quint64 code) const;
+    Sample powerValue(quint64 code) const;
+
+    QVector<quint64> m_bits;
+    int m_size;
+    ChunkSummary m_summary;
+    // Decimal places of the integer coding, -1 for raw bits.
+    int m_socDecimals;
+    int m_powerDecimals;
+    DataPoint m_first;
+    DataPoint m_last;
+    mutable QWeakPointer<const DataChunk> m_decoded;
+};
+
+#endif // COMPRESSEDCHUNK_H
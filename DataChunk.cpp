@@ -0,0 +1,123 @@
+#include "DataChunk.h"
+
+DataChunk::DataChunk()
+    : m_size(0)
+    , m_published(0)
+    , m_summary{ 0, 0, 0, 0, 0 }
+{
+}
+
+DataChunk::DataChunk(const DataChunk &other, int count)
+    : m_size(count)
+    , m_published(0)
+    , m_summary{ 0, 0, 0, 0, 0 }
+{
+    Q_ASSERT(count >= 0 && count <= other.m_size);
+    std::memcpy(m_soc, other.m_soc, sizeof(Sample) * size_t(count));
+    std::memcpy(m_power, other.m_power, sizeof(Sample) * size_t(count));
+    std::memcpy(m_timestamp, other.m_timestamp, sizeof(qint64) * size_t(count));
+    if (count == other.m_size) {
+        m_summary = other.m_summary;
+    } else if (count > 0) {
+        PointKernels::minMax(m_soc, count, &m_summary.minSoc, &m_summary.maxSoc);
+        PointKernels::minMax(m_power, count, &m_summary.minPower, &m_summary.maxPower);
+        for (int i = 0; i < count; ++i)
+            m_summary.hash += hashSample(i, m_soc[i], m_power[i], m_timestamp[i]);
+    }
+}
+
+void DataChunk::append(const DataPoint &point)
+{
+    Q_ASSERT(!isFull());
+    const Sample soc = Sample(point.getSocPercentage());
+    const Sample power = Sample(point.getPower());
+
+    if (m_size == 0) {
+        m_summary = { soc, soc, power, power, 0 };
+    } else {
+        m_summary.minSoc = qMin(m_summary.minSoc, soc);
+        m_summary.maxSoc = qMax(m_summary.maxSoc, soc);
+        m_summary.minPower = qMin(m_summary.minPower, power);
+        m_summary.maxPower = qMax(m_summary.maxPower, power);
+    }
+    set(m_size, soc, power, point.getTimestamp());
+    ++m_size;
+}
+
+void DataChunk::replace(int index, const DataPoint &point)
+{
+    Q_ASSERT(index >= m_published && index < m_size);
+    const Sample oldSoc = m_soc[index];
+    const Sample oldPower = m_power[index];
+    m_summary.hash -= hashSample(index, oldSoc, oldPower, m_timestamp[index]);
+    const Sample soc = Sample(point.getSocPercentage());
+    const Sample power = Sample(point.getPower());
+    set(index, soc, power, point.getTimestamp());
+    if (!refreshRange(oldSoc, oldPower)) {
+        m_summary.minSoc = qMin(m_summary.minSoc, soc);
+        m_summary.maxSoc = qMax(m_summary.maxSoc, soc);
+        m_summary.minPower = qMin(m_summary.minPower, power);
+        m_summary.maxPower = qMax(m_summary.maxPower, power);
+    }
+}
+
+void DataChunk::insert(int index, const DataPoint &point)
+{
+    Q_ASSERT(index >= m_published && index <= m_size && !isFull());
+    // The moved points hash at their new positions.
+    for (int i = index; i < m_size; ++i) {
+        m_summary.hash -= hashSample(i, m_soc[i], m_power[i], m_timestamp[i]);
+        m_summary.hash += hashSample(i + 1, m_soc[i], m_power[i], m_timestamp[i]);
+    }
+    const size_t moved = size_t(m_size - index);
+    std::memmove(m_soc + index + 1, m_soc + index, sizeof(Sample) * moved);
+    std::memmove(m_power + index + 1, m_power + index, sizeof(Sample) * moved);
+    std::memmove(m_timestamp + index + 1, m_timestamp + index, sizeof(qint64) * moved);
+
+    const Sample soc = Sample(point.getSocPercentage());
+    const Sample power = Sample(point.getPower());
+    if (m_size == 0) {
+        m_summary = { soc, soc, power, power, 0 };
+    } else {
+        m_summary.minSoc = qMin(m_summary.minSoc, soc);
+        m_summary.maxSoc = qMax(m_summary.maxSoc, soc);
+        m_summary.minPower = qMin(m_summary.minPower, power);
+        m_summary.maxPower = qMax(m_summary.maxPower, power);
+    }
+    set(index, soc, power, point.getTimestamp());
+    ++m_size;
+}
+
+DataPoint DataChunk::takeLast()
+{
+    Q_ASSERT(m_size > m_published);
+    const int last = m_size - 1;
+    const DataPoint point = at(last);
+    m_summary.hash -= hashSample(last, m_soc[last], m_power[last], m_timestamp[last]);
+    --m_size;
+    refreshRange(m_soc[last], m_power[last]);
+    return point;
+}
+
+void DataChunk::set(int index, Sample soc, Sample power, qint64 timestamp)
+{
+    m_soc[index] = soc;
+    m_power[index] = power;
+    m_timestamp[index] = timestamp;
+    m_summary.hash += hashSample(index, soc, power, timestamp);
+}
+
+bool DataChunk::refreshRange(Sample oldSoc, Sample oldPower)
+{
+    // Only a removed extreme needs the columns scanned again.
+    if (m_size == 0) {
+        m_summary = { 0, 0, 0, 0, 0 };
+        return true;
+    }
+    if (oldSoc != m_summary.minSoc && oldSoc != m_summary.maxSoc
+        && oldPower != m_summary.minPower && oldPower != m_summary.maxPower)
+        return false;
+    PointKernels::minMax(m_soc, m_size, &m_summary.minSoc, &m_summary.maxSoc);
+    PointKernels::minMax(m_power, m_size, &m_summary.minPower, &m_summary.maxPower);
+    return true;
+}
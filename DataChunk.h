@@ -0,0 +1,89 @@
+#ifndef DATACHUNK_H
+#define DATACHUNK_H
+
+#include <QtGlobal>
+#include <cstring>
+#include "DataPoint.h"
+#include "PointKernels.h"
+
+struct ChunkSummary
+{
+    Sample minSoc;
+    Sample maxSoc;
+    Sample minPower;
+    Sample maxPower;
+    // Order-sensitive hash of the samples as stored: the wrapping sum of
+    // DataChunk::hashSample() over them. 0 where it was never computed
+    // (chunks of a recorded session).
+    quint64 hash;
+};
+
+// Fixed-capacity block of points stored as contiguous SOC, power and
+// timestamp columns so scans can be vectorized. Storage is part of the
+// object and never reallocated, so a snapshot can keep reading the first N
+// samples through raw pointers while the owner keeps appending behind them.
+// The min/max summary and content hash are maintained on every change. Once
+// full, a provider's chunk is replaced by a CompressedChunk.
+//
+// Points a snapshot may be reading are never changed: publish() marks them,
+// and replace(), insert() and takeLast() only touch points after them.
+class DataChunk
+{
+public:
+    static constexpr int Capacity = 4096;
+
+    DataChunk();
+    // A chunk holding the first count points of other, none of them
+    // published.
+    DataChunk(const DataChunk &other, int count);
+
+    int size() const { return m_size; }
+    bool isFull() const { return m_size >= Capacity; }
+    const Sample *socData() const { return m_soc; }
+    const Sample *powerData() const { return m_power; }
+    const qint64 *timestampData() const { return m_timestamp; }
+    const ChunkSummary &summary() const { return m_summary; }
+    DataPoint at(int index) const { return DataPoint(m_soc[index], m_power[index], m_timestamp[index]); }
+
+    void append(const DataPoint &point);
+
+    int published() const { return m_published; }
+    void publish() { m_published = m_size; }
+    void replace(int index, const DataPoint &point);
+    // Moves the points from index on up by one; the chunk must not be full.
+    void insert(int index, const DataPoint &point);
+    DataPoint takeLast();
+
+    // Hash of one sample at index, summed into ChunkSummary::hash. Equal
+    // samples (including -0 and 0) hash the same.
+    static quint64 hashSample(int index, Sample soc, Sample power, qint64 timestamp)
+    {
+        const double values[2] = { double(soc) + 0.0, double(power) + 0.0 };
+        quint64 bits[2];
+        std::memcpy(bits, values, sizeof(bits));
+        quint64 hash = (0xcbf29ce484222325ULL + quint64(index)) * 0x9e3779b97f4a7c15ULL;
+        hash = (hash ^ (hash >> 29) ^ bits[0]) * 0xbf58476d1ce4e5b9ULL;
+        hash = (hash ^ (hash >> 32) ^ bits[1]) * 0x94d049bb133111ebULL;
+        hash = (hash ^ (hash >> 29) ^ quint64(timestamp)) * 0xbf58476d1ce4e5b9ULL;
+        return hash ^ (hash >> 32);
+    }
+
+private:
+    Q_DISABLE_COPY(DataChunk)
+    // Decodes straight into the columns.
+    friend class CompressedChunk;
+
+    void set(int index, Sample soc, Sample power, qint64 timestamp);
+    // After a value was overwritten or removed; false if the range was
+    // left as it is.
+    bool refreshRange(Sample oldSoc, Sample oldPower);
+
+    alignas(16) Sample m_soc[Capacity];
+    alignas(16) Sample m_power[Capacity];
+    alignas(16) qint64 m_timestamp[Capacity];
+    int m_size;
+    int m_published;
+    ChunkSummary m_summary;
+};
+
+#endif // DATACHUNK_H
@@ -1,49 +1,12 @@
 #include "DataPoint.h"
 
-DataPoint::DataPoint()
-{
-    qDebug() << Q_FUNC_INFO;
-}
-
-DataPoint::DataPoint(double soc, double power)
-    : m_socPercentage(soc), m_power(power)
-{
-    qDebug() << Q_FUNC_INFO;
-}
-
-DataPoint::~DataPoint()
-{
-    qDebug() << Q_FUNC_INFO;
-}
-
-double DataPoint::getSocPercentage() const
-{
-    qDebug() << Q_FUNC_INFO;
-    return m_socPercentage;
-}
-
-void DataPoint::setSocPercentage(double newSocPercentage)
-{
-    qDebug() << Q_FUNC_INFO;
-    m_socPercentage = newSocPercentage;
-}
-
-double DataPoint::getPower() const
-{
-    qDebug() << Q_FUNC_INFO;
-    return m_power;
-}
-
-void DataPoint::setPower(double newPower)
-{
-    qDebug() << Q_FUNC_INFO;
-    m_power = newPower;
-}
-
 bool DataPoint::operator==(const DataPoint &other) const
 {
-    return qFuzzyCompare(m_socPercentage, other.m_socPercentage) &&
-           qFuzzyCompare(m_power, other.m_power);
+    // Exact. qFuzzyCompare() is relative and breaks down against 0.0, which
+    // is a common power; DataProvider compares at storage precision itself.
+    return m_socPercentage == other.m_socPercentage &&
+           m_power == other.m_power &&
+           m_timestamp == other.m_timestamp;
 }
 
 bool DataPoint::operator!=(const DataPoint &other) const
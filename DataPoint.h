@@ -1,19 +1,34 @@
 #ifndef DATAPOINT_H
 #define DATAPOINT_H
 #include <QDebug>
+#include <QObject>
+#include <type_traits>
 
+// Lightweight value/view type for a single sample. Bulk storage lives in
+// the columnar DataChunk arrays; DataPoint is what individual accessors hand
+// out, so its accessors are inline and free of side effects. As a gadget its
+// values are readable from QML (DataPointModel::get()).
 class DataPoint
 {
+    Q_GADGET
+    Q_PROPERTY(double soc READ getSocPercentage FINAL)
+    Q_PROPERTY(double power READ getPower FINAL)
+    Q_PROPERTY(qint64 timestamp READ getTimestamp FINAL)
+
 public:
-    DataPoint();
-    DataPoint(double soc, double power);
-    ~DataPoint();
+    DataPoint() : m_socPercentage(0.0), m_power(0.0), m_timestamp(0) {}
+    DataPoint(double soc, double power, qint64 timestamp = 0)
+        : m_socPercentage(soc), m_power(power), m_timestamp(timestamp) {}
+
+    double getSocPercentage() const { return m_socPercentage; }
+    void setSocPercentage(double newSocPercentage) { m_socPercentage = newSocPercentage; }
 
-    double getSocPercentage() const;
-    void setSocPercentage(double newSocPercentage);
+    double getPower() const { return m_power; }
+    void setPower(double newPower) { m_power = newPower; }
 
-    double getPower() const;
-    void setPower(double newPower);
+    // Milliseconds since the epoch; 0 when the source did not provide one.
+    qint64 getTimestamp() const { return m_timestamp; }
+    void setTimestamp(qint64 newTimestamp) { m_timestamp = newTimestamp; }
 
     bool operator==(const DataPoint &other) const;
     bool operator!=(const DataPoint &other) const;
@@ -21,6 +36,11 @@ public:
 private:
     double m_socPercentage;
     double m_power;
+    qint64 m_timestamp;
 };
 
+// Copied around by value in hot loops and scratch buffers; keep it memcpy-able.
+static_assert(std::is_trivially_copyable<DataPoint>::value, "DataPoint must stay trivially copyable");
+Q_DECLARE_TYPEINFO(DataPoint, Q_RELOCATABLE_TYPE);
+
 #endif // DATAPOINT_H
@@ -0,0 +1,176 @@
+#include "DataPointModel.h"
+#include "GraphRenderer.h"
+#include "Trace.h"
+
+DataPointModel::DataPointModel(QObject *parent)
+    : QAbstractListModel{parent}
+    , m_batchSize(DefaultBatchSize)
+    , m_rowCount(0)
+{
+}
+
+DataProvider *DataPointModel::getProvider() const
+{
+    return m_provider;
+}
+
+void DataPointModel::setProvider(DataProvider *newProvider)
+{
+    if (m_provider == newProvider)
+        return;
+
+    if (m_provider)
+        disconnect(m_provider, nullptr, this, nullptr);
+
+    m_provider = newProvider;
+
+    if (m_provider) {
+        connect(m_provider, &DataProvider::pointsAppended, this, &DataPointModel::onPointsAppended);
+        connect(m_provider, &DataProvider::pointsReplaced, this, &DataPointModel::onPointsReplaced);
+        connect(m_provider, &DataProvider::pointsReset, this, &DataPointModel::onPointsReset);
+        connect(m_provider, &DataProvider::pointsTrimmed, this, &DataPointModel::onPointsTrimmed);
+        connect(m_provider, &QObject::destroyed, this, &DataPointModel::onPointsReset);
+    }
+
+    resetRows();
+    emit providerChanged();
+}
+
+int DataPointModel::getBatchSize() const
+{
+    return m_batchSize;
+}
+
+void DataPointModel::setBatchSize(int newBatchSize)
+{
+    newBatchSize = qMax(1, newBatchSize);
+    if (m_batchSize == newBatchSize)
+        return;
+    m_batchSize = newBatchSize;
+    emit batchSizeChanged();
+}
+
+int DataPointModel::getCount() const
+{
+    return m_rowCount;
+}
+
+int DataPointModel::getTotalCount() const
+{
+    return m_snapshot.size();
+}
+
+int DataPointModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_rowCount;
+}
+
+QVariant DataPointModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rowCount)
+        return QVariant();
+
+    const DataPoint point = m_snapshot.at(index.row());
+    switch (role) {
+    case SocRole:
+        return point.getSocPercentage();
+    case PowerRole:
+        return point.getPower();
+    case TimestampRole:
+        return point.getTimestamp();
+    case Qt::DisplayRole:
+        return GraphRenderer::formatHoverValue(point);
+    default:
+        return QVariant();
+    }
+}
+
+QHash<int, QByteArray> DataPointModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = QAbstractListModel::roleNames();
+    roles.insert(SocRole, "soc");
+    roles.insert(PowerRole, "power");
+    roles.insert(TimestampRole, "timestamp");
+    return roles;
+}
+
+bool DataPointModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && m_rowCount < m_snapshot.size();
+}
+
+void DataPointModel::fetchMore(const QModelIndex &parent)
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    if (!canFetchMore(parent))
+        return;
+
+    const int count = qMin(m_batchSize, m_snapshot.size() - m_rowCount);
+    beginInsertRows(QModelIndex(), m_rowCount, m_rowCount + count - 1);
+    m_rowCount += count;
+    endInsertRows();
+    emit countChanged();
+}
+
+DataPoint DataPointModel::get(int row) const
+{
+    if (row < 0 || row >= m_snapshot.size())
+        return DataPoint();
+    return m_snapshot.at(row);
+}
+
+void DataPointModel::onPointsAppended(int first, int count)
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    // Views that have not paged to the end yet pick the new samples up
+    // through fetchMore(); only a fully exposed model grows by itself.
+    // pointsReplaced() can have taken the new snapshot already.
+    const bool complete = m_rowCount == first;
+    m_snapshot = m_provider->snapshot();
+    emit totalCountChanged();
+    if (!complete || count <= 0)
+        return;
+
+    beginInsertRows(QModelIndex(), first, first + count - 1);
+    m_rowCount = m_snapshot.size();
+    endInsertRows();
+    emit countChanged();
+}
+
+void DataPointModel::onPointsReplaced(int first, int count)
+{
+    m_snapshot = m_provider->snapshot();
+    const int last = qMin(first + count, m_rowCount) - 1;
+    if (last >= first)
+        emit dataChanged(index(first), index(last));
+}
+
+void DataPointModel::onPointsReset()
+{
+    resetRows();
+}
+
+void DataPointModel::onPointsTrimmed(int count)
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    m_snapshot = m_provider->snapshot();
+    const int removed = qMin(count, m_rowCount);
+    if (removed > 0) {
+        beginRemoveRows(QModelIndex(), 0, removed - 1);
+        m_rowCount -= removed;
+        endRemoveRows();
+        emit countChanged();
+    }
+    emit totalCountChanged();
+}
+
+void DataPointModel::resetRows()
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    beginResetModel();
+    m_snapshot = m_provider ? m_provider->snapshot() : DataSnapshot();
+    m_rowCount = qMin(m_batchSize, m_snapshot.size());
+    endResetModel();
+    emit countChanged();
+    emit totalCountChanged();
+}
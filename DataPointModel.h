@@ -0,0 +1,80 @@
+#ifndef DATAPOINTMODEL_H
+#define DATAPOINTMODEL_H
+
+#include <QAbstractListModel>
+#include <QPointer>
+#include "DataProvider.h"
+#include "DataSnapshot.h"
+
+// List model over a DataProvider for QML views, one row per sample with the
+// roles soc, power and timestamp. Rows are read from a DataSnapshot, so
+// nothing is copied or converted up front.
+//
+// Rows are exposed in pages of batchSize: canFetchMore()/fetchMore() let a
+// view page through long or memory-mapped sessions as it scrolls. Once all
+// rows are exposed, appended samples are inserted as new rows; samples
+// dropped by the raw retention are removed rows, replaced samples become
+// dataChanged() and anything else resets the model.
+class DataPointModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(DataProvider *provider READ getProvider WRITE setProvider NOTIFY providerChanged FINAL)
+    Q_PROPERTY(int batchSize READ getBatchSize WRITE setBatchSize NOTIFY batchSizeChanged FINAL)
+    Q_PROPERTY(int count READ getCount NOTIFY countChanged FINAL)
+    Q_PROPERTY(int totalCount READ getTotalCount NOTIFY totalCountChanged FINAL)
+
+public:
+    enum Role {
+        SocRole = Qt::UserRole + 1,
+        PowerRole,
+        TimestampRole
+    };
+    Q_ENUM(Role)
+
+    static constexpr int DefaultBatchSize = 1000;
+
+    explicit DataPointModel(QObject *parent = nullptr);
+
+    DataProvider *getProvider() const;
+    void setProvider(DataProvider *newProvider);
+
+    int getBatchSize() const;
+    void setBatchSize(int newBatchSize);
+
+    // Rows exposed so far, and samples in the provider.
+    int getCount() const;
+    int getTotalCount() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // Sample at row, for delegates outside of a view. row may be beyond
+    // count; an invalid DataPoint is not distinguishable, so check
+    // totalCount first.
+    Q_INVOKABLE DataPoint get(int row) const;
+
+signals:
+    void providerChanged();
+    void batchSizeChanged();
+    void countChanged();
+    void totalCountChanged();
+
+private slots:
+    void onPointsAppended(int first, int count);
+    void onPointsReplaced(int first, int count);
+    void onPointsReset();
+    void onPointsTrimmed(int count);
+
+private:
+    void resetRows();
+
+    QPointer<DataProvider> m_provider;
+    DataSnapshot m_snapshot;
+    int m_batchSize;
+    int m_rowCount;
+};
+
+#endif // DATAPOINTMODEL_H
@@ -1,86 +1,809 @@
 #include "DataProvider.h"
+#include "Trace.h"
 #include <QRandomGenerator>
 #include <QTimer>
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+constexpr int StatisticsInterval = 16;
+
+} // namespace
 
 DataProvider::DataProvider(QObject *parent)
     : QObject{parent}
+    , m_compressionEnabled(true)
+    , m_duplicatePolicy(KeepAll)
+    , m_tailMerges(1)
+    , m_droppedSampleCount(0)
+    , m_pointCount(0)
+    , m_generation(0)
+    , m_materializedGeneration(0)
     , m_peakPower(0.0)
+    , m_statisticsTimer(new QTimer(this))
+    , m_rawRetention(DefaultRawRetention)
+    , m_secondTier(1000, SecondTierCapacity)
+    , m_minuteTier(60 * 1000, MinuteTierCapacity)
+    , m_trimmedCount(0)
+    , m_trimGeneration(1)
     , m_autoGenerationTimer(new QTimer(this))
 {
-    qDebug() << Q_FUNC_INFO;
-    connect(m_autoGenerationTimer, &QTimer::timeout, this, &DataProvider::generateRandomData);
-}
-
-DataProvider::DataProvider()
-    : m_peakPower(0.0)
-    , m_autoGenerationTimer(new QTimer(this))
-{
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceData);
+    for (int resolution = 0; resolution < ResolutionCount; ++resolution)
+        m_historyGeneration[resolution] = 0;
+    m_statisticsTimer->setSingleShot(true);
+    m_statisticsTimer->setInterval(StatisticsInterval);
+    connect(m_statisticsTimer, &QTimer::timeout, this, &DataProvider::statisticsChanged);
     connect(m_autoGenerationTimer, &QTimer::timeout, this, &DataProvider::generateRandomData);
 }
 
 DataProvider::~DataProvider()
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceData);
     m_autoGenerationTimer->stop();
     delete m_autoGenerationTimer;
 }
 
 QVector<DataPoint> DataProvider::getDataPoints() const
 {
-    qDebug() << Q_FUNC_INFO;
-    return m_dataPoints;
+    GRAPH_TRACE_FUNCTION(TraceData);
+    // Only QML still needs a flat vector; it is rebuilt at most once per
+    // generation and shared implicitly after that.
+    if (m_materializedGeneration != m_generation) {
+        const DataSnapshot points = snapshot();
+        m_materializedPoints.clear();
+        m_materializedPoints.reserve(m_pointCount);
+        for (int chunk = 0; chunk < points.chunkCount(); ++chunk) {
+            const DataSnapshot::Columns columns = points.columns(chunk);
+            for (int i = 0; i < points.chunkSize(chunk); ++i)
+                m_materializedPoints.append(DataPoint(columns.soc[i], columns.power[i], columns.timestamp[i]));
+        }
+        m_materializedGeneration = m_generation;
+    }
+    return m_materializedPoints;
 }
 
-void DataProvider::setDataPoints(const QVector<DataPoint> &newDataPoints)
+void DataProvider::setDataPoints(const QVector<DataPoint> &points)
 {
-    qDebug() << Q_FUNC_INFO;
-    if (m_dataPoints == newDataPoints)
+    GRAPH_TRACE_FUNCTION(TraceData);
+    // QML writing back what it read, or a tool handing the same vector
+    // again.
+    if (m_materializedGeneration == m_generation && points.constData() == m_materializedPoints.constData()
+        && points.size() == m_materializedPoints.size())
         return;
-    m_dataPoints = newDataPoints;
+
+    const QVector<DataPoint> newDataPoints = ordered(points);
+    const DataSnapshot current = snapshot();
+    const int oldSize = current.size();
+    const int firstDifference = firstMismatch(current, newDataPoints);
+
+    if (firstDifference == oldSize && oldSize == newDataPoints.size())
+        return;
+
+    const bool appendOnly = firstDifference == oldSize;
+    if (!appendOnly)
+        resetChunks();
+    for (int i = appendOnly ? oldSize : 0; i < newDataPoints.size(); ++i)
+        appendToChunks(newDataPoints.at(i));
+    m_tailMerges = 1;
+    ++m_generation;
+
+    if (appendOnly) {
+        for (int i = oldSize; i < newDataPoints.size(); ++i) {
+            const DataPoint &point = newDataPoints.at(i);
+            m_statistics.append(point.getSocPercentage(), point.getPower(), point.getTimestamp());
+            appendToTiers(point);
+        }
+    } else {
+        m_statistics.rebuild(snapshot());
+        rebuildTiers(snapshot());
+    }
+    scheduleStatisticsChanged();
+
+    // Appends only need to look at the new tail to keep the peak current;
+    // otherwise the chunk summaries give the peak without a full scan.
+    double peakPower = 0.0;
+    if (appendOnly) {
+        peakPower = m_peakPower;
+        for (int i = oldSize; i < newDataPoints.size(); ++i)
+            peakPower = qMax(peakPower, newDataPoints.at(i).getPower());
+    } else {
+        double minPower = 0.0;
+        if (!snapshot().powerRange(&minPower, &peakPower))
+            peakPower = 0.0;
+    }
+    setPeakPower(peakPower);
+
+    if (appendOnly) {
+        emit pointsAppended(oldSize, m_pointCount - oldSize);
+    } else if (oldSize == m_pointCount) {
+        emit pointsReplaced(firstDifference, oldSize - firstDifference);
+    } else {
+        emit pointsReset();
+    }
     emit dataPointsChanged();
+    trimToRetention();
+}
+
+DataSnapshot DataProvider::snapshot() const
+{
+    if (m_snapshot.m_generation == m_generation && m_snapshot.m_size == m_pointCount)
+        return m_snapshot;
+
+    // Only the newest ReorderChunks chunks are ever replaced individually
+    // (sealed, or rewritten by a late sample); older ones are appended or
+    // all dropped together. If the first chunk is unchanged, every ref up to
+    // the first replaced one, minus the last (whose size may have grown), is
+    // still valid, which keeps steady-state appends at O(1).
+    int reuse = 0;
+    if (!m_snapshot.m_chunks.isEmpty() && m_snapshot.m_chunks.first().owner.data() == firstChunkOwner())
+        reuse = m_snapshot.m_chunks.size() - 1;
+    while (reuse > 0 && m_snapshot.m_chunks.at(reuse - 1).owner.data() != chunkOwner(reuse - 1))
+        --reuse;
+
+    const int sealedCount = m_sealedChunks.size();
+    m_snapshot.m_chunks.resize(reuse);
+    int start = reuse > 0 ? m_snapshot.m_chunks.last().start + m_snapshot.m_chunks.last().size : 0;
+    for (int i = reuse; i < sealedCount + m_chunks.size(); ++i) {
+        if (i < sealedCount) {
+            m_snapshot.m_chunks.append(m_sealedChunks.at(i));
+        } else {
+            const QSharedPointer<DataChunk> &chunk = m_chunks.at(i - sealedCount);
+            chunk->publish();
+            m_snapshot.m_chunks.append(DataSnapshot::ChunkRef{ chunk, chunk->socData(), chunk->powerData(),
+                                                               chunk->timestampData(), chunk->size(),
+                                                               chunk->summary(), 0 });
+        }
+        m_snapshot.m_chunks.last().start = start;
+        start += m_snapshot.m_chunks.last().size;
+    }
+    m_snapshot.m_size = m_pointCount;
+    m_snapshot.m_generation = m_generation;
+    return m_snapshot;
+}
+
+quint64 DataProvider::generation() const
+{
+    return m_generation;
+}
+
+quint64 DataProvider::contentHash() const
+{
+    return snapshot().contentHash();
+}
+
+int DataProvider::firstMismatch(const DataSnapshot &current, const QVector<DataPoint> &points)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    const int commonSize = qMin(current.size(), int(points.size()));
+    const DataPoint *data = points.constData();
+    for (int chunk = 0; chunk < current.chunkCount(); ++chunk) {
+        const int start = current.chunkStart(chunk);
+        const int size = current.chunkSize(chunk);
+        if (start >= commonSize)
+            break;
+        const int end = qMin(start + size, commonSize);
+
+        const DataSnapshot::Columns columns = current.columns(chunk);
+        for (int i = start; i < end; ++i) {
+            const DataPoint &point = data[i];
+            if (Sample(point.getSocPercentage()) != columns.soc[i - start]
+                || Sample(point.getPower()) != columns.power[i - start]
+                || point.getTimestamp() != columns.timestamp[i - start])
+                return i;
+        }
+    }
+    return commonSize;
+}
+
+int DataProvider::pointCount() const
+{
+    return m_pointCount;
+}
+
+void DataProvider::appendToChunks(const DataPoint &point)
+{
+    if (m_chunks.isEmpty() || m_chunks.last()->isFull()) {
+        m_chunks.append(QSharedPointer<DataChunk>::create());
+        if (m_compressionEnabled)
+            sealChunks();
+    }
+    m_chunks.last()->append(point);
+    ++m_pointCount;
+}
+
+bool DataProvider::appendInOrder(const DataPoint &point)
+{
+    // Compared at storage precision, which is what later reads see.
+    const Sample soc = Sample(point.getSocPercentage());
+    if (m_pointCount > 0) {
+        const Sample lastSoc = Sample(lastPoint().getSocPercentage());
+        if (!(soc > lastSoc || (soc == lastSoc && m_duplicatePolicy == KeepAll)))
+            return false;
+    }
+    appendToChunks(point);
+    m_tailMerges = 1;
+    return true;
+}
+
+int DataProvider::mergeLate(const DataPoint &point)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    // The newest plain chunk starting at or below the sample's SOC, if it
+    // is within reach; sealed chunks are never changed. NaN never is.
+    const Sample soc = Sample(point.getSocPercentage());
+    int chunk = -1;
+    for (int candidate = m_chunks.size() - 1; candidate >= 0 && candidate >= m_chunks.size() - ReorderChunks;
+         --candidate) {
+        if (m_chunks.at(candidate)->socData()[0] <= soc) {
+            chunk = candidate;
+            break;
+        }
+    }
+    // Below every plain chunk it goes to the front of the first one, as
+    // long as that is in reach and nothing sealed lies at or above it.
+    if (chunk < 0 && !m_chunks.isEmpty() && m_chunks.size() <= ReorderChunks && !qIsNaN(soc)
+        && (m_sealedChunks.isEmpty()
+            || soc > Sample(chunkLast(m_sealedChunks.size() - 1).getSocPercentage())))
+        chunk = 0;
+    if (chunk < 0)
+        return -1;
+
+    int start = m_pointCount;
+    for (int i = chunk; i < m_chunks.size(); ++i)
+        start -= m_chunks.at(i)->size();
+    // After any equal SOC, so KeepAll keeps arrival order.
+    const Sample *socData = m_chunks.at(chunk)->socData();
+    const int position = int(std::upper_bound(socData, socData + m_chunks.at(chunk)->size(), soc) - socData);
+
+    if (m_duplicatePolicy != KeepAll && position > 0 && socData[position - 1] == soc) {
+        const int index = start + position - 1;
+        const bool last = index == m_pointCount - 1;
+        DataChunk *data = writableChunk(chunk, position - 1);
+        data->replace(position - 1, mergeDuplicate(data->at(position - 1), point, last ? m_tailMerges : 1));
+        if (last)
+            ++m_tailMerges;
+        return index;
+    }
+
+    // Inserted in place. Every plain chunk but the last is full, so each
+    // one on the way passes its last point on to the next.
+    DataPoint carried = point;
+    for (int next = chunk, index = position;; ++next, index = 0) {
+        if (next == m_chunks.size())
+            m_chunks.append(QSharedPointer<DataChunk>::create());
+        if (index == m_chunks.at(next)->size() && m_chunks.at(next)->isFull())
+            continue;
+        DataChunk *data = writableChunk(next, index);
+        if (!data->isFull()) {
+            data->insert(index, carried);
+            break;
+        }
+        const DataPoint spilled = data->takeLast();
+        data->insert(index, carried);
+        carried = spilled;
+    }
+    ++m_pointCount;
+    if (m_compressionEnabled)
+        sealChunks();
+    return start + position;
+}
+
+DataChunk *DataProvider::writableChunk(int chunk, int from)
+{
+    // Points a snapshot may be reading are not touched: the store goes on
+    // with a copy instead, at most once per chunk and snapshot taken.
+    QSharedPointer<DataChunk> &data = m_chunks[chunk];
+    if (from < data->published())
+        data = QSharedPointer<DataChunk>::create(*data, data->size());
+    return data.data();
+}
+
+DataPoint DataProvider::mergeDuplicate(const DataPoint &stored, const DataPoint &point, int storedCount) const
+{
+    switch (m_duplicatePolicy) {
+    case KeepMax:
+        return point.getPower() > stored.getPower() ? point : stored;
+    case KeepMean:
+        return DataPoint(stored.getSocPercentage(),
+                         stored.getPower() + (point.getPower() - stored.getPower()) / (storedCount + 1),
+                         qMax(stored.getTimestamp(), point.getTimestamp()));
+    case KeepAll:
+    case KeepLast:
+        break;
+    }
+    return point;
+}
+
+QVector<DataPoint> DataProvider::ordered(const QVector<DataPoint> &points) const
+{
+    // Sorted input without duplicates to merge is shared as it is.
+    bool sorted = true;
+    bool duplicates = false;
+    for (int i = 1; i < points.size() && sorted; ++i) {
+        const Sample previous = Sample(points.at(i - 1).getSocPercentage());
+        const Sample soc = Sample(points.at(i).getSocPercentage());
+        sorted = !(soc < previous);
+        duplicates = duplicates || soc == previous;
+    }
+    if (sorted && (!duplicates || m_duplicatePolicy == KeepAll))
+        return points;
+
+    QVector<DataPoint> result = points;
+    std::stable_sort(result.begin(), result.end(), [](const DataPoint &a, const DataPoint &b) {
+        return Sample(a.getSocPercentage()) < Sample(b.getSocPercentage());
+    });
+    if (m_duplicatePolicy == KeepAll)
+        return result;
+
+    int count = 0;
+    int merges = 1;
+    for (const DataPoint &point : std::as_const(result)) {
+        if (count > 0 && Sample(result.at(count - 1).getSocPercentage()) == Sample(point.getSocPercentage())) {
+            result[count - 1] = mergeDuplicate(result.at(count - 1), point, merges++);
+            continue;
+        }
+        result[count++] = point;
+        merges = 1;
+    }
+    result.resize(count);
+    return result;
+}
+
+DataPoint DataProvider::lastPoint() const
+{
+    return chunkLast(m_sealedChunks.size() + m_chunks.size() - 1);
+}
+
+DataPoint DataProvider::chunkLast(int chunk) const
+{
+    const int sealedCount = m_sealedChunks.size();
+    if (chunk >= sealedCount) {
+        const DataChunk &data = *m_chunks.at(chunk - sealedCount);
+        return data.at(data.size() - 1);
+    }
+    const DataSnapshot::ChunkRef &ref = m_sealedChunks.at(chunk);
+    if (ref.compressed)
+        return ref.compressed->last();
+    return DataPoint(ref.soc[ref.size - 1], ref.power[ref.size - 1], ref.timestamp[ref.size - 1]);
+}
+
+bool DataProvider::storedPowerRange(double *minPower, double *maxPower) const
+{
+    // From the chunk summaries, without taking a snapshot: that would
+    // publish the plain chunks (see DataChunk::publish()).
+    bool found = false;
+    auto widen = [&](const ChunkSummary &summary) {
+        *minPower = found ? qMin(*minPower, double(summary.minPower)) : double(summary.minPower);
+        *maxPower = found ? qMax(*maxPower, double(summary.maxPower)) : double(summary.maxPower);
+        found = true;
+    };
+    for (const DataSnapshot::ChunkRef &ref : m_sealedChunks)
+        widen(ref.summary);
+    for (const QSharedPointer<DataChunk> &chunk : m_chunks)
+        widen(chunk->summary());
+    return found;
+}
+
+void DataProvider::sealChunks()
+{
+    // Snapshots still reading the plain chunks keep them alive; the next
+    // snapshot() picks up the compressed ones.
+    int sealed = 0;
+    while (sealed < m_chunks.size() - ReorderChunks && m_chunks.at(sealed)->isFull()) {
+        const DataChunk &chunk = *m_chunks.at(sealed);
+        const QSharedPointer<const CompressedChunk> compressed = QSharedPointer<CompressedChunk>::create(chunk);
+        m_sealedChunks.append(DataSnapshot::ChunkRef{ compressed, nullptr, nullptr, nullptr, chunk.size(),
+                                                      chunk.summary(), 0, compressed });
+        ++sealed;
+    }
+    m_chunks.remove(0, sealed);
+}
+
+void DataProvider::resetChunks()
+{
+    // Snapshots still referencing the old chunks keep them alive.
+    m_sealedChunks.clear();
+    m_session.reset();
+    m_chunks.clear();
+    m_pointCount = 0;
+    m_tailMerges = 1;
+}
+
+const void *DataProvider::firstChunkOwner() const
+{
+    if (!m_sealedChunks.isEmpty())
+        return m_sealedChunks.first().owner.data();
+    return m_chunks.isEmpty() ? nullptr : m_chunks.first().data();
+}
+
+const void *DataProvider::chunkOwner(int chunk) const
+{
+    const int sealedCount = m_sealedChunks.size();
+    if (chunk < sealedCount)
+        return m_sealedChunks.at(chunk).owner.data();
+    return chunk - sealedCount < m_chunks.size() ? m_chunks.at(chunk - sealedCount).data() : nullptr;
 }
 
 double DataProvider::getPeakPower() const
 {
-    qDebug() << Q_FUNC_INFO;
     return m_peakPower;
 }
 
 void DataProvider::setPeakPower(double newPeakPower)
 {
-    qDebug() << Q_FUNC_INFO;
-    if (qFuzzyCompare(m_peakPower, newPeakPower))
+    GRAPH_TRACE_FUNCTION(TraceData);
+    if (m_peakPower == newPeakPower)
         return;
     m_peakPower = newPeakPower;
     emit peakPowerChanged();
 }
 
+int DataProvider::getStatisticsWindow() const
+{
+    return m_statistics.window();
+}
+
+void DataProvider::setStatisticsWindow(int newStatisticsWindow)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    newStatisticsWindow = qMax(1, newStatisticsWindow);
+    if (m_statistics.window() == newStatisticsWindow)
+        return;
+    m_statistics.setWindow(newStatisticsWindow);
+    // Only the retained raw samples can be replayed into the statistics.
+    m_statistics.rebuild(snapshot());
+    emit statisticsWindowChanged();
+    scheduleStatisticsChanged();
+}
+
+double DataProvider::getWindowPeakPower() const
+{
+    return m_statistics.windowMaxPower();
+}
+
+double DataProvider::getWindowMinPower() const
+{
+    return m_statistics.windowMinPower();
+}
+
+double DataProvider::getDeliveredEnergy() const
+{
+    return m_statistics.energyKWh();
+}
+
+double DataProvider::getAveragePower() const
+{
+    return m_statistics.meanPower();
+}
+
+double DataProvider::getPowerSocSlope() const
+{
+    return m_statistics.powerSocSlope();
+}
+
+QVariantList DataProvider::getSocBandCounts() const
+{
+    QVariantList counts;
+    counts.reserve(PowerStatistics::BandCount);
+    for (int band = 0; band < PowerStatistics::BandCount; ++band)
+        counts.append(m_statistics.bandCount(band));
+    return counts;
+}
+
+QVariantList DataProvider::getSocBandAveragePower() const
+{
+    QVariantList powers;
+    powers.reserve(PowerStatistics::BandCount);
+    for (int band = 0; band < PowerStatistics::BandCount; ++band)
+        powers.append(m_statistics.bandMeanPower(band));
+    return powers;
+}
+
+qint64 DataProvider::getRawRetention() const
+{
+    return m_rawRetention;
+}
+
+void DataProvider::setRawRetention(qint64 newRawRetention)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    newRawRetention = qMax<qint64>(0, newRawRetention);
+    if (m_rawRetention == newRawRetention)
+        return;
+    m_rawRetention = newRawRetention;
+    emit rawRetentionChanged();
+    trimToRetention();
+}
+
+bool DataProvider::isCompressionEnabled() const
+{
+    return m_compressionEnabled;
+}
+
+void DataProvider::setCompressionEnabled(bool newCompressionEnabled)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    if (m_compressionEnabled == newCompressionEnabled)
+        return;
+    m_compressionEnabled = newCompressionEnabled;
+    if (m_compressionEnabled) {
+        sealChunks();
+        // The cached snapshot would keep the plain chunks alive.
+        m_snapshot = DataSnapshot();
+    }
+    emit compressionEnabledChanged();
+}
+
+qint64 DataProvider::getMemoryUsage() const
+{
+    qint64 bytes = 0;
+    for (const DataSnapshot::ChunkRef &ref : m_sealedChunks) {
+        if (ref.compressed)
+            bytes += ref.compressed->byteSize();
+    }
+    return bytes + m_chunks.size() * qint64(sizeof(DataChunk));
+}
+
+DataProvider::DuplicatePolicy DataProvider::getDuplicatePolicy() const
+{
+    return m_duplicatePolicy;
+}
+
+void DataProvider::setDuplicatePolicy(DuplicatePolicy newDuplicatePolicy)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    // Applies to samples arriving from now on; stored duplicates stay.
+    if (m_duplicatePolicy == newDuplicatePolicy)
+        return;
+    m_duplicatePolicy = newDuplicatePolicy;
+    m_tailMerges = 1;
+    emit duplicatePolicyChanged();
+}
+
+int DataProvider::getDroppedSampleCount() const
+{
+    return m_droppedSampleCount;
+}
+
+const RollupTier &DataProvider::tier(Resolution resolution) const
+{
+    return resolution == SecondResolution ? m_secondTier : m_minuteTier;
+}
+
+DataSnapshot DataProvider::historySnapshot(Resolution resolution) const
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    if (m_historyGeneration[resolution] == m_trimGeneration)
+        return m_history[resolution];
+
+    DataSnapshot history;
+    if (m_trimmedCount > 0) {
+        const DataSnapshot raw = snapshot();
+        const qint64 end = raw.isEmpty() ? std::numeric_limits<qint64>::max() : raw.first().getTimestamp();
+        QVector<DataPoint> points;
+        if (resolution == SecondResolution && !m_secondTier.isEmpty()) {
+            m_minuteTier.appendPoints(qMin(end, m_secondTier.oldestStart()), points);
+            m_secondTier.appendPoints(end, points);
+        } else {
+            m_minuteTier.appendPoints(end, points);
+        }
+
+        QSharedPointer<DataChunk> chunk;
+        for (const DataPoint &point : points) {
+            if (!chunk || chunk->isFull()) {
+                chunk = QSharedPointer<DataChunk>::create();
+                history.m_chunks.append(DataSnapshot::ChunkRef{ chunk, chunk->socData(), chunk->powerData(),
+                                                                chunk->timestampData(), 0, ChunkSummary(),
+                                                                history.m_size });
+            }
+            chunk->append(point);
+            ++history.m_size;
+            DataSnapshot::ChunkRef &ref = history.m_chunks.last();
+            ref.size = chunk->size();
+            ref.summary = chunk->summary();
+        }
+        history.m_generation = m_generation;
+    }
+
+    m_history[resolution] = history;
+    m_historyGeneration[resolution] = m_trimGeneration;
+    return history;
+}
+
+void DataProvider::appendToTiers(const DataPoint &point)
+{
+    m_secondTier.append(point);
+    m_minuteTier.append(point);
+}
+
+void DataProvider::rebuildTiers(const DataSnapshot &snapshot)
+{
+    m_secondTier.clear();
+    m_minuteTier.clear();
+    for (int chunk = 0; chunk < snapshot.chunkCount(); ++chunk) {
+        const DataSnapshot::Columns columns = snapshot.columns(chunk);
+        for (int i = 0; i < snapshot.chunkSize(chunk); ++i)
+            appendToTiers(DataPoint(columns.soc[i], columns.power[i], columns.timestamp[i]));
+    }
+    m_trimmedCount = 0;
+    ++m_trimGeneration;
+}
+
+void DataProvider::trimToRetention()
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    if (m_rawRetention <= 0 || m_sealedChunks.size() + m_chunks.size() < 2)
+        return;
+
+    const qint64 newest = lastPoint().getTimestamp();
+    if (newest <= 0)
+        return;
+
+    // Whole chunks only, so every chunk but the last stays full, and never
+    // the last one. The tiers saw every sample on append already.
+    const qint64 cutoff = newest - m_rawRetention;
+    const int sealedCount = m_sealedChunks.size();
+    const int chunkCount = sealedCount + m_chunks.size();
+    int dropChunks = 0;
+    int dropped = 0;
+    while (dropChunks < chunkCount - 1) {
+        const qint64 last = chunkLast(dropChunks).getTimestamp();
+        if (last <= 0 || last >= cutoff)
+            break;
+        dropped += dropChunks < sealedCount ? m_sealedChunks.at(dropChunks).size
+                                            : m_chunks.at(dropChunks - sealedCount)->size();
+        ++dropChunks;
+    }
+    if (dropChunks == 0)
+        return;
+
+    const int sealedDrops = qMin(dropChunks, int(m_sealedChunks.size()));
+    m_sealedChunks.remove(0, sealedDrops);
+    m_chunks.remove(0, dropChunks - sealedDrops);
+    if (m_sealedChunks.isEmpty() || m_sealedChunks.first().owner.data() != m_session.data())
+        m_session.reset();
+    m_pointCount -= dropped;
+    m_trimmedCount += dropped;
+    // Mapped chunks share one owner, so the incremental rebuild in
+    // snapshot() cannot tell that the front changed.
+    m_snapshot = DataSnapshot();
+    ++m_generation;
+    ++m_trimGeneration;
+
+    emit pointsTrimmed(dropped);
+    emit dataPointsChanged();
+}
+
+void DataProvider::scheduleStatisticsChanged()
+{
+    // Live feeds append far more often than anything can display, so the
+    // notification is coalesced to one per frame.
+    if (!m_statisticsTimer->isActive())
+        m_statisticsTimer->start();
+}
+
 void DataProvider::addPoint(const DataPoint &point)
 {
-    qDebug() << Q_FUNC_INFO;
-    m_dataPoints.append(point);
+    GRAPH_TRACE_FUNCTION(TraceData);
+    appendPoints(&point, 1);
+}
+
+void DataProvider::appendPoints(const DataPoint *points, int count)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    if (count <= 0)
+        return;
+
+    const int first = m_pointCount;
+    const int droppedSampleCount = m_droppedSampleCount;
+    // First stored point a late sample changed or moved.
+    int changedFrom = first;
+    double peakPower = m_peakPower;
+    for (int i = 0; i < count; ++i) {
+        const DataPoint &point = points[i];
+        if (!appendInOrder(point)) {
+            const int index = mergeLate(point);
+            if (index < 0) {
+                ++m_droppedSampleCount;
+                continue;
+            }
+            changedFrom = qMin(changedFrom, index);
+        }
+        peakPower = qMax(peakPower, point.getPower());
+        m_statistics.append(point.getSocPercentage(), point.getPower(), point.getTimestamp());
+        appendToTiers(point);
+    }
+    if (m_droppedSampleCount != droppedSampleCount)
+        emit droppedSampleCountChanged();
+    if (changedFrom == first && m_pointCount == first)
+        return;
+    ++m_generation;
+    scheduleStatisticsChanged();
 
-    if (point.getPower() > m_peakPower)
+    // A merged duplicate can have replaced the peak.
+    if (changedFrom < first) {
+        double minPower = 0.0;
+        if (!storedPowerRange(&minPower, &peakPower))
+            peakPower = 0.0;
+    }
+    if (peakPower != m_peakPower)
     {
-        m_peakPower = point.getPower();
+        m_peakPower = peakPower;
         emit peakPowerChanged();
     }
+    if (changedFrom < first)
+        emit pointsReplaced(changedFrom, first - changedFrom);
+    if (m_pointCount > first)
+        emit pointsAppended(first, m_pointCount - first);
     emit dataPointsChanged();
+    trimToRetention();
 }
 
 void DataProvider::clearData()
 {
-    qDebug() << Q_FUNC_INFO;
-    m_dataPoints.clear();
+    GRAPH_TRACE_FUNCTION(TraceData);
+    resetChunks();
+    ++m_generation;
     m_peakPower = 0.0;
+    m_statistics.reset();
+    rebuildTiers(DataSnapshot());
+    scheduleStatisticsChanged();
+    emit pointsReset();
+    emit dataPointsChanged();
+    emit peakPowerChanged();
+}
+
+bool DataProvider::openSession(const QString &path)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    QString errorString;
+    const QSharedPointer<SessionFile> session = SessionFile::open(path, &errorString);
+    if (!session) {
+        qWarning("Cannot open session %s: %s", qPrintable(path), qPrintable(errorString));
+        return false;
+    }
+
+    resetChunks();
+    m_session = session;
+    for (int chunk = 0; chunk < session->chunkCount(); ++chunk) {
+        const int size = session->chunkSize(chunk);
+        if (size == DataChunk::Capacity) {
+            m_sealedChunks.append(DataSnapshot::ChunkRef{ session, session->socData(chunk), session->powerData(chunk),
+                                                          session->timestampData(chunk), size,
+                                                          session->chunkSummary(chunk), m_pointCount });
+            m_pointCount += size;
+            continue;
+        }
+        // Only the last chunk can be partial. It is copied so that live
+        // appends can continue it and every chunk but the last stays full.
+        const Sample *soc = session->socData(chunk);
+        const Sample *power = session->powerData(chunk);
+        const qint64 *timestamp = session->timestampData(chunk);
+        for (int i = 0; i < size; ++i)
+            appendToChunks(DataPoint(soc[i], power[i], timestamp[i]));
+    }
+    ++m_generation;
+
+    double minPower = 0.0;
+    double peakPower = 0.0;
+    if (!snapshot().powerRange(&minPower, &peakPower))
+        peakPower = 0.0;
+    m_peakPower = peakPower;
+    m_statistics.rebuild(snapshot());
+    rebuildTiers(snapshot());
+    scheduleStatisticsChanged();
+
+    emit pointsReset();
     emit dataPointsChanged();
     emit peakPowerChanged();
+    return true;
 }
 
 void DataProvider::startRandomGeneration()
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceData);
     if (!m_autoGenerationTimer->isActive()) {
         m_autoGenerationTimer->start(5000);
     }
@@ -88,7 +811,7 @@ void DataProvider::startRandomGeneration()
 
 void DataProvider::stopRandomGeneration()
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceData);
     if (m_autoGenerationTimer->isActive()) {
         m_autoGenerationTimer->stop();
     }
@@ -96,30 +819,26 @@ void DataProvider::stopRandomGeneration()
 
 void DataProvider::generateRandomData()
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceData);
     clearData();
-    int numPoints = QRandomGenerator::global()->bounded(5, 15);
-    QVector<DataPoint> newData;
+    const int numPoints = QRandomGenerator::global()->bounded(5, 15);
+    constexpr int minSoc = 25;
+    constexpr int maxSoc = 85;
+    constexpr double minPower = 100;
+    constexpr double maxPower = 300;
+    const double step = (maxPower - minPower) / (numPoints - 1);
 
-    for (int i = 0; i < numPoints; ++i) {
-        double soc = QRandomGenerator::global()->bounded(25, 85);
-        newData.append(DataPoint(soc, 0));
-    }
-
-    std::sort(newData.begin(), newData.end(), [](const DataPoint &a, const DataPoint &b) {
-        return a.getSocPercentage() < b.getSocPercentage();
-    });
-
-    double minPower = 100;
-    double maxPower = 300;
-    double step = (maxPower - minPower) / (numPoints - 1);
-
-    for (int i = 0; i < numPoints; ++i) {
-        double power = minPower + i * step;
-        power += QRandomGenerator::global()->bounded(10.0) - 5.0;
-        newData[i] = DataPoint(newData[i].getSocPercentage(), power);
+    // Distinct SOC values drawn in ascending order (selection sampling:
+    // each value is taken with probability needed / remaining), so the
+    // points come out sorted and are built once.
+    QVector<DataPoint> newData;
+    newData.reserve(numPoints);
+    for (int soc = minSoc; soc < maxSoc && newData.size() < numPoints; ++soc) {
+        if (QRandomGenerator::global()->bounded(maxSoc - soc) >= numPoints - newData.size())
+            continue;
+        const double power = minPower + newData.size() * step + QRandomGenerator::global()->bounded(10.0) - 5.0;
+        newData.append(DataPoint(soc, power));
     }
 
     setDataPoints(newData);
 }
-
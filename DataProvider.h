@@ -4,28 +4,145 @@
 #include <QObject>
 #include <QVector>
 #include <QTimer>
+#include <QVariantList>
 #include "DataPoint.h"
+#include "DataChunk.h"
+#include "DataSnapshot.h"
+#include "PowerStatistics.h"
+#include "RollupTier.h"
+#include "SessionFile.h"
 
 class DataProvider : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QVector<DataPoint> dataPoints READ getDataPoints WRITE setDataPoints NOTIFY dataPointsChanged FINAL)
     Q_PROPERTY(double peakPower READ getPeakPower WRITE setPeakPower NOTIFY peakPowerChanged FINAL)
+    Q_PROPERTY(int statisticsWindow READ getStatisticsWindow WRITE setStatisticsWindow NOTIFY statisticsWindowChanged FINAL)
+    Q_PROPERTY(double windowPeakPower READ getWindowPeakPower NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(double windowMinPower READ getWindowMinPower NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(double deliveredEnergy READ getDeliveredEnergy NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(double averagePower READ getAveragePower NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(double powerSocSlope READ getPowerSocSlope NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(QVariantList socBandCounts READ getSocBandCounts NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(QVariantList socBandAveragePower READ getSocBandAveragePower NOTIFY statisticsChanged FINAL)
+    Q_PROPERTY(qint64 rawRetention READ getRawRetention WRITE setRawRetention NOTIFY rawRetentionChanged FINAL)
+    Q_PROPERTY(bool compressionEnabled READ isCompressionEnabled WRITE setCompressionEnabled NOTIFY compressionEnabledChanged FINAL)
+    Q_PROPERTY(qint64 memoryUsage READ getMemoryUsage NOTIFY dataPointsChanged FINAL)
+    Q_PROPERTY(DuplicatePolicy duplicatePolicy READ getDuplicatePolicy WRITE setDuplicatePolicy NOTIFY duplicatePolicyChanged FINAL)
+    Q_PROPERTY(int droppedSampleCount READ getDroppedSampleCount NOTIFY droppedSampleCountChanged FINAL)
 
 public:
+    // Rollup tiers behind the raw samples, see RollupTier.
+    enum Resolution {
+        SecondResolution,
+        MinuteResolution,
+        ResolutionCount
+    };
+    Q_ENUM(Resolution)
+
+    // What becomes of a sample with the same SOC as a stored point: stored
+    // after it, or merged into it keeping the newer sample, the one with
+    // the higher power, or the mean power. The mean is exact for repeats of
+    // the last SOC; a late duplicate further back is averaged with the
+    // stored value as if that were a single sample.
+    enum DuplicatePolicy {
+        KeepAll,
+        KeepLast,
+        KeepMax,
+        KeepMean
+    };
+    Q_ENUM(DuplicatePolicy)
+
+    // Raw samples are kept for an hour of sample time; older ones survive
+    // only in the tiers, the 1 s tier for six hours and the 1 min tier for
+    // 30 days.
+    static constexpr qint64 DefaultRawRetention = 60 * 60 * 1000;
+    static constexpr int SecondTierCapacity = 6 * 60 * 60;
+    static constexpr int MinuteTierCapacity = 30 * 24 * 60;
+    // Newest chunks kept as plain columns so late samples can be merged
+    // into them.
+    static constexpr int ReorderChunks = 2;
+
     explicit DataProvider(QObject *parent = nullptr);
-    DataProvider();
     ~DataProvider();
 
+    // Materializes every point; views should use a DataPointModel instead.
     QVector<DataPoint> getDataPoints() const;
+    // The vector getDataPoints() handed out is recognized by identity and
+    // costs nothing. Any other vector is compared point by point at storage
+    // precision up to the first difference, which decodes the compressed
+    // chunks before it; equal data in a different vector is O(n).
     void setDataPoints(const QVector<DataPoint> &newDataPoints);
 
+    // Zero-copy read access for renderers and other consumers.
+    DataSnapshot snapshot() const;
+    quint64 generation() const;
+    // See DataSnapshot::contentHash().
+    quint64 contentHash() const;
+    int pointCount() const;
+
     double getPeakPower() const;
     void setPeakPower(double newPeakPower);
 
+    // Incremental statistics, see PowerStatistics. The window is a number of
+    // samples; energy is in kWh and the slope in kW per percent SOC.
+    int getStatisticsWindow() const;
+    void setStatisticsWindow(int newStatisticsWindow);
+    double getWindowPeakPower() const;
+    double getWindowMinPower() const;
+    double getDeliveredEnergy() const;
+    double getAveragePower() const;
+    double getPowerSocSlope() const;
+    QVariantList getSocBandCounts() const;
+    QVariantList getSocBandAveragePower() const;
+    const PowerStatistics &statistics() const { return m_statistics; }
+
+    // Milliseconds of sample time for which raw samples are kept, 0 to keep
+    // all of them. Older chunks are dropped from the front once appends
+    // move past the window (samples without timestamps never age) and are
+    // then only available rolled up through historySnapshot().
+    qint64 getRawRetention() const;
+    void setRawRetention(qint64 newRawRetention);
+    const RollupTier &tier(Resolution resolution) const;
+    // The samples dropped from the raw data, as the M4 points of the tier
+    // buckets before the first raw sample. The 1 s history falls back to
+    // 1 min buckets where the 1 s tier no longer reaches. Empty while
+    // nothing has been dropped.
+    DataSnapshot historySnapshot(Resolution resolution) const;
+
+    // Full chunks are compressed (see CompressedChunk) once they are no
+    // longer among the newest ReorderChunks, which stay plain columns.
+    // Turning it off keeps new chunks plain; compressed ones stay
+    // compressed.
+    bool isCompressionEnabled() const;
+    void setCompressionEnabled(bool newCompressionEnabled);
+    // Bytes held by the in-memory chunks; mapped session chunks are backed
+    // by the file and not counted.
+    qint64 getMemoryUsage() const;
+
+    // The points stay sorted by SOC. A sample at or above the last SOC is
+    // appended in O(1), and a repeat of the last SOC under anything but
+    // KeepAll is merged into it in place. A late one is inserted in place
+    // into the newest ReorderChunks chunks, moving at most the points
+    // behind it in each, also ahead of the first point while those chunks
+    // are all there is after the sealed ones, and dropped (counted in
+    // droppedSampleCount) if it belongs further back. A chunk with points a snapshot has seen is
+    // copied before such a change, so that costs a copy at most once per
+    // chunk and snapshot. Statistics and tiers take every accepted sample
+    // in arrival order.
+    DuplicatePolicy getDuplicatePolicy() const;
+    void setDuplicatePolicy(DuplicatePolicy newDuplicatePolicy);
+    int getDroppedSampleCount() const;
+
     void addPoint(const DataPoint &point);
+    // Appends a batch with a single set of notifications.
+    void appendPoints(const DataPoint *points, int count);
     void clearData();
 
+    // Replaces the data with a recorded session. Full chunks are used in
+    // place from the memory-mapped file, so opening does not read samples.
+    Q_INVOKABLE bool openSession(const QString &path);
+
     Q_INVOKABLE void startRandomGeneration();
     Q_INVOKABLE void stopRandomGeneration();
     Q_INVOKABLE void generateRandomData();
@@ -34,10 +151,70 @@ public:
 signals:
     void dataPointsChanged();
     void peakPowerChanged();
+    void statisticsWindowChanged();
+    // Emitted at most once per frame however many samples arrive.
+    void statisticsChanged();
+
+    // Fine-grained notifications for consumers that cache derived state.
+    // dataPointsChanged() is still emitted alongside every one of them.
+    void pointsAppended(int first, int count);
+    void pointsReplaced(int first, int count);
+    void pointsReset();
+    // count samples were dropped from the front by the raw retention;
+    // indexes of the remaining ones moved down by count.
+    void pointsTrimmed(int count);
+    void rawRetentionChanged();
+    void compressionEnabledChanged();
+    void duplicatePolicyChanged();
+    void droppedSampleCountChanged();
+
+private:
+    void appendToChunks(const DataPoint &point);
+    bool appendInOrder(const DataPoint &point);
+    int mergeLate(const DataPoint &point);
+    DataPoint mergeDuplicate(const DataPoint &stored, const DataPoint &point, int storedCount) const;
+    QVector<DataPoint> ordered(const QVector<DataPoint> &points) const;
+    DataPoint lastPoint() const;
+    DataPoint chunkLast(int chunk) const;
+    bool storedPowerRange(double *minPower, double *maxPower) const;
+    DataChunk *writableChunk(int chunk, int from);
+    const void *chunkOwner(int chunk) const;
+    static int firstMismatch(const DataSnapshot &current, const QVector<DataPoint> &points);
+    void sealChunks();
+    void resetChunks();
+    const void *firstChunkOwner() const;
+    void scheduleStatisticsChanged();
+    void appendToTiers(const DataPoint &point);
+    void rebuildTiers(const DataSnapshot &snapshot);
+    void trimToRetention();
 
 private:
-    QVector<DataPoint> m_dataPoints;
+    QSharedPointer<SessionFile> m_session;
+    // Full chunks that never change again: first those mapped from
+    // m_session, then compressed ones. m_chunks follow them.
+    QVector<DataSnapshot::ChunkRef> m_sealedChunks;
+    QVector<QSharedPointer<DataChunk>> m_chunks;
+    bool m_compressionEnabled;
+    DuplicatePolicy m_duplicatePolicy;
+    // Samples merged into the last point, for KeepMean.
+    int m_tailMerges;
+    int m_droppedSampleCount;
+    int m_pointCount;
+    quint64 m_generation;
+    mutable DataSnapshot m_snapshot;
+    mutable QVector<DataPoint> m_materializedPoints;
+    mutable quint64 m_materializedGeneration;
     double m_peakPower;
+    PowerStatistics m_statistics;
+    QTimer *m_statisticsTimer;
+    qint64 m_rawRetention;
+    RollupTier m_secondTier;
+    RollupTier m_minuteTier;
+    qint64 m_trimmedCount;
+    // Bumped whenever the history changes: trims and tier rebuilds.
+    quint64 m_trimGeneration;
+    mutable DataSnapshot m_history[ResolutionCount];
+    mutable quint64 m_historyGeneration[ResolutionCount];
     QTimer *m_autoGenerationTimer;
 };
 
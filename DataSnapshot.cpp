@@ -0,0 +1,204 @@
+#include "DataSnapshot.h"
+#include "SessionFile.h"
+#include <algorithm>
+
+DataSnapshot::DataSnapshot()
+    : m_size(0)
+    , m_generation(0)
+{
+}
+
+DataSnapshot DataSnapshot::fromSession(const QSharedPointer<const SessionFile> &session)
+{
+    DataSnapshot snapshot;
+    if (!session)
+        return snapshot;
+    for (int chunk = 0; chunk < session->chunkCount(); ++chunk) {
+        const int size = session->chunkSize(chunk);
+        snapshot.m_chunks.append(ChunkRef{ session, session->socData(chunk), session->powerData(chunk),
+                                           session->timestampData(chunk), size, session->chunkSummary(chunk),
+                                           snapshot.m_size });
+        snapshot.m_size += size;
+    }
+    return snapshot;
+}
+
+DataSnapshot DataSnapshot::fromPoints(const QVector<DataPoint> &points)
+{
+    DataSnapshot snapshot;
+    for (int start = 0; start < points.size(); start += DataChunk::Capacity) {
+        const QSharedPointer<DataChunk> chunk(new DataChunk);
+        const int end = qMin(start + DataChunk::Capacity, int(points.size()));
+        for (int i = start; i < end; ++i)
+            chunk->append(points.at(i));
+        snapshot.m_chunks.append(ChunkRef{ chunk, chunk->socData(), chunk->powerData(), chunk->timestampData(),
+                                           chunk->size(), chunk->summary(), start });
+    }
+    snapshot.m_size = points.size();
+    return snapshot;
+}
+
+DataPoint DataSnapshot::at(int index) const
+{
+    Q_ASSERT(index >= 0 && index < m_size);
+    const ChunkRef &ref = m_chunks.at(chunkIndex(index));
+    const int offset = index - ref.start;
+    if (ref.compressed)
+        return ref.compressed->decoded()->at(offset);
+    return DataPoint(ref.soc[offset], ref.power[offset], ref.timestamp[offset]);
+}
+
+DataPoint DataSnapshot::chunkFirst(int chunk) const
+{
+    const ChunkRef &ref = m_chunks.at(chunk);
+    if (ref.compressed)
+        return ref.compressed->first();
+    return DataPoint(ref.soc[0], ref.power[0], ref.timestamp[0]);
+}
+
+DataPoint DataSnapshot::chunkLast(int chunk) const
+{
+    const ChunkRef &ref = m_chunks.at(chunk);
+    if (ref.compressed)
+        return ref.compressed->last();
+    const int last = ref.size - 1;
+    return DataPoint(ref.soc[last], ref.power[last], ref.timestamp[last]);
+}
+
+DataSnapshot::Columns DataSnapshot::columns(int chunk) const
+{
+    const ChunkRef &ref = m_chunks.at(chunk);
+    Columns columns;
+    if (ref.compressed) {
+        const QSharedPointer<const DataChunk> decoded = ref.compressed->decoded();
+        columns.soc = decoded->socData();
+        columns.power = decoded->powerData();
+        columns.timestamp = decoded->timestampData();
+        columns.owner = decoded;
+    } else {
+        columns.soc = ref.soc;
+        columns.power = ref.power;
+        columns.timestamp = ref.timestamp;
+        columns.owner = ref.owner;
+    }
+    return columns;
+}
+
+int DataSnapshot::chunkIndex(int index) const
+{
+    if (index >= m_size)
+        return m_chunks.size();
+
+    // Provider snapshots have full chunks up to the last, so the division
+    // is right unless history was prepended.
+    const int guess = index / DataChunk::Capacity;
+    if (guess < m_chunks.size()) {
+        const ChunkRef &ref = m_chunks.at(guess);
+        if (index >= ref.start && index < ref.start + ref.size)
+            return guess;
+    }
+    const auto next = std::upper_bound(m_chunks.cbegin(), m_chunks.cend(), index,
+                                       [](int value, const ChunkRef &ref) { return value < ref.start; });
+    return int(next - m_chunks.cbegin()) - 1;
+}
+
+DataSnapshot DataSnapshot::prepended(const DataSnapshot &history) const
+{
+    if (history.isEmpty())
+        return *this;
+
+    DataSnapshot combined;
+    combined.m_chunks = history.m_chunks;
+    combined.m_chunks.reserve(history.m_chunks.size() + m_chunks.size());
+    for (ChunkRef ref : m_chunks) {
+        ref.start += history.m_size;
+        combined.m_chunks.append(ref);
+    }
+    combined.m_size = history.m_size + m_size;
+    combined.m_generation = m_generation;
+    return combined;
+}
+
+bool DataSnapshot::powerRange(double *minPower, double *maxPower) const
+{
+    if (m_chunks.isEmpty())
+        return false;
+
+    Sample lo = m_chunks.first().summary.minPower;
+    Sample hi = m_chunks.first().summary.maxPower;
+    for (const ChunkRef &ref : m_chunks) {
+        lo = qMin(lo, ref.summary.minPower);
+        hi = qMax(hi, ref.summary.maxPower);
+    }
+    *minPower = lo;
+    *maxPower = hi;
+    return true;
+}
+
+int DataSnapshot::peakPowerIndex() const
+{
+    if (m_chunks.isEmpty())
+        return -1;
+
+    int peakChunk = 0;
+    for (int i = 1; i < m_chunks.size(); ++i) {
+        if (m_chunks.at(i).summary.maxPower > m_chunks.at(peakChunk).summary.maxPower)
+            peakChunk = i;
+    }
+
+    const ChunkRef &ref = m_chunks.at(peakChunk);
+    return ref.start + PointKernels::peakIndex(columns(peakChunk).power, ref.size);
+}
+
+quint64 DataSnapshot::contentHash() const
+{
+    quint64 hash = 0xcbf29ce484222325ULL ^ quint64(m_size);
+    for (int chunk = 0; chunk < m_chunks.size(); ++chunk) {
+        const ChunkRef &ref = m_chunks.at(chunk);
+        quint64 chunkHash = ref.summary.hash;
+        if (chunkHash == 0) {
+            const Columns data = columns(chunk);
+            for (int i = 0; i < ref.size; ++i)
+                chunkHash += DataChunk::hashSample(i, data.soc[i], data.power[i], data.timestamp[i]);
+        }
+        hash = (hash ^ chunkHash) * 0x9e3779b97f4a7c15ULL;
+        hash ^= hash >> 32;
+    }
+    return hash;
+}
+
+int DataSnapshot::lowerBoundSoc(double soc) const
+{
+    // Binary search over the chunk maxima first, then within one chunk.
+    int first = 0;
+    int length = m_chunks.size();
+    while (length > 0) {
+        const int half = length / 2;
+        if (m_chunks.at(first + half).summary.maxSoc < soc) {
+            first += half + 1;
+            length -= half + 1;
+        } else {
+            length = half;
+        }
+    }
+
+    if (first >= m_chunks.size())
+        return m_size;
+
+    const ChunkRef &ref = m_chunks.at(first);
+    return ref.start + PointKernels::lowerBound(columns(first).soc, ref.size, soc);
+}
+
+int DataSnapshot::nearestSoc(double soc) const
+{
+    if (m_size == 0)
+        return -1;
+
+    const int upper = lowerBoundSoc(soc);
+    if (upper == 0)
+        return 0;
+    if (upper == m_size)
+        return m_size - 1;
+    const int lower = upper - 1;
+    return soc - at(lower).getSocPercentage() <= at(upper).getSocPercentage() - soc ? lower : upper;
+}
@@ -0,0 +1,103 @@
+#ifndef DATASNAPSHOT_H
+#define DATASNAPSHOT_H
+
+#include <QVector>
+#include <QSharedPointer>
+#include "CompressedChunk.h"
+#include "DataChunk.h"
+
+class SessionFile;
+
+// Immutable, versioned view of a DataProvider's points. Taking one costs a
+// reference per chunk; no point is copied. It stays valid and unchanged
+// while the provider keeps appending, replacing or clearing its data, so it
+// can be handed to another thread. generation() changes on every mutation
+// of the provider, letting readers skip work when nothing happened.
+class DataSnapshot
+{
+public:
+    DataSnapshot();
+
+    // Snapshots of points no provider holds, with generation 0: a recorded
+    // session read in place, or SOC-sorted points copied into chunks.
+    static DataSnapshot fromSession(const QSharedPointer<const SessionFile> &session);
+    static DataSnapshot fromPoints(const QVector<DataPoint> &points);
+
+    quint64 generation() const { return m_generation; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    DataPoint at(int index) const;
+    // Read from the chunk ends, so they never decode a compressed chunk.
+    DataPoint first() const { return chunkFirst(0); }
+    DataPoint last() const { return chunkLast(m_chunks.size() - 1); }
+
+    // Contiguous SOC/power/timestamp columns, one span per chunk, for
+    // vectorized loops. A provider snapshot has DataChunk::Capacity points
+    // in every chunk but the last; one with history prepended does not, so
+    // loops go through chunkStart()/chunkIndex() rather than dividing.
+    int chunkCount() const { return m_chunks.size(); }
+    int chunkSize(int chunk) const { return m_chunks.at(chunk).size; }
+    int chunkStart(int chunk) const { return m_chunks.at(chunk).start; }
+    // Chunk holding index; chunkCount() for index >= size().
+    int chunkIndex(int index) const;
+    const ChunkSummary &chunkSummary(int chunk) const { return m_chunks.at(chunk).summary; }
+    DataPoint chunkFirst(int chunk) const;
+    DataPoint chunkLast(int chunk) const;
+    bool isCompressed(int chunk) const { return !m_chunks.at(chunk).compressed.isNull(); }
+
+    // The column pointers of a chunk together with what keeps them alive;
+    // hold on to it while reading. Compressed chunks are decoded here, so
+    // anything the summary, chunkFirst() or chunkLast() can answer should
+    // not ask for the columns.
+    struct Columns {
+        const Sample *soc = nullptr;
+        const Sample *power = nullptr;
+        const qint64 *timestamp = nullptr;
+        QSharedPointer<const void> owner;
+    };
+    Columns columns(int chunk) const;
+
+    // Whole-snapshot scans. They use the per-chunk summaries where possible
+    // and the PointKernels for the remaining samples.
+    bool powerRange(double *minPower, double *maxPower) const;
+    int peakPowerIndex() const;
+    // Hash of the points from the chunk hashes maintained on append, so
+    // O(chunks); only chunks of a recorded session are read. Equal points
+    // in equal chunks hash the same, which holds between provider
+    // snapshots, as those split at every DataChunk::Capacity points.
+    quint64 contentHash() const;
+    // First index with SOC >= soc. Requires SOC-sorted data.
+    int lowerBoundSoc(double soc) const;
+    // Index of the point whose SOC is closest to soc, -1 if empty. Same
+    // O(log n) search and requirement as lowerBoundSoc().
+    int nearestSoc(double soc) const;
+
+    // history followed by this snapshot, keeping this snapshot's generation.
+    // history must end before this snapshot starts, in SOC and in time.
+    DataSnapshot prepended(const DataSnapshot &history) const;
+
+private:
+    friend class DataProvider;
+
+    // owner keeps the column storage alive: an in-memory DataChunk or the
+    // memory-mapped SessionFile the columns point into. Compressed chunks
+    // have no columns until decoded.
+    struct ChunkRef {
+        QSharedPointer<const void> owner;
+        const Sample *soc;
+        const Sample *power;
+        const qint64 *timestamp;
+        int size;
+        ChunkSummary summary;
+        // Index of the chunk's first point in the snapshot.
+        int start;
+        QSharedPointer<const CompressedChunk> compressed;
+    };
+
+    QVector<ChunkRef> m_chunks;
+    int m_size;
+    quint64 m_generation;
+};
+
+#endif // DATASNAPSHOT_H
@@ -0,0 +1,100 @@
+#include "Decimator.h"
+#include <QtMath>
+#include <algorithm>
+
+Decimator::Decimator(qreal columnWidth)
+{
+    reset(columnWidth);
+}
+
+void Decimator::reset(qreal columnWidth)
+{
+    m_scale = columnWidth > 0 ? 1.0 / columnWidth : 1.0;
+    m_column = 0;
+    m_runStart = -1;
+    m_minIndex = -1;
+    m_maxIndex = -1;
+    m_runOutputStart = 0;
+    m_inputCount = 0;
+    m_runs.resize(0);
+}
+
+int Decimator::append(const QVector<QPointF> &input, int first, QVector<QPointF> &output)
+{
+    const int count = input.size();
+    if (first >= count)
+        return output.size();
+    m_inputCount = count;
+
+    const QPointF *points = input.constData();
+    int begin = first;
+
+    if (m_runStart < 0) {
+        m_runOutputStart = output.size();
+        m_runStart = m_minIndex = m_maxIndex = first;
+        m_column = qFloor(points[first].x() * m_scale);
+        begin = first + 1;
+    } else {
+        output.resize(m_runOutputStart);
+    }
+
+    const int changedFrom = m_runOutputStart;
+
+    for (int i = begin; i < count; ++i) {
+        const qint64 column = qFloor(points[i].x() * m_scale);
+        if (column == m_column) {
+            if (points[i].y() < points[m_minIndex].y())
+                m_minIndex = i;
+            if (points[i].y() > points[m_maxIndex].y())
+                m_maxIndex = i;
+            continue;
+        }
+
+        emitRun(points, i - 1, output);
+        m_runs.append(Run{ m_runStart, m_runOutputStart });
+        m_runOutputStart = output.size();
+        m_runStart = m_minIndex = m_maxIndex = i;
+        m_column = column;
+    }
+
+    // The tail column stays open; it is re-emitted on the next append.
+    emitRun(points, count - 1, output);
+    return changedFrom;
+}
+
+int Decimator::rewind(int first, QVector<QPointF> &output)
+{
+    if (first >= m_inputCount || m_runStart < 0)
+        return first;
+
+    Run restart{ m_runStart, m_runOutputStart };
+    if (first < m_runStart) {
+        const auto run = std::upper_bound(m_runs.cbegin(), m_runs.cend(), first,
+                                          [](int value, const Run &run) { return value < run.inputStart; }) - 1;
+        restart = *run;
+        m_runs.resize(int(run - m_runs.cbegin()));
+    }
+    output.resize(restart.outputStart);
+    m_runStart = m_minIndex = m_maxIndex = -1;
+    m_inputCount = restart.inputStart;
+    return restart.inputStart;
+}
+
+void Decimator::decimateM4(const QVector<QPointF> &input, QVector<QPointF> &output, qreal columnWidth)
+{
+    output.clear();
+    Decimator decimator(columnWidth);
+    decimator.append(input, 0, output);
+}
+
+void Decimator::emitRun(const QPointF *points, int last, QVector<QPointF> &output) const
+{
+    int picks[4] = { m_runStart, m_minIndex, m_maxIndex, last };
+    std::sort(picks, picks + 4);
+    int previous = -1;
+    for (int pick : picks) {
+        if (pick != previous)
+            output.append(points[pick]);
+        previous = pick;
+    }
+}
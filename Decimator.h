@@ -0,0 +1,53 @@
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <QVector>
+#include <QPointF>
+
+// Min/max (M4) level-of-detail reduction of an already mapped polyline.
+// Every run of consecutive points that falls into the same pixel column is
+// reduced to its first, last, minimum-y and maximum-y sample, in original
+// order. Rasterizing the reduced polyline touches exactly the same pixels as
+// the full one, so the output is visually identical.
+//
+// The decimator is incremental: appended input only re-emits the still open
+// tail column, so live feeds cost O(new points) per update. Input that
+// changed behind the tail is fed again from the start of its column after
+// rewind().
+class Decimator
+{
+public:
+    explicit Decimator(qreal columnWidth = 1.0);
+
+    void reset(qreal columnWidth);
+
+    // Consumes input[first..] (everything before first must already have been
+    // fed) and updates output. Returns the first output index that changed.
+    int append(const QVector<QPointF> &input, int first, QVector<QPointF> &output);
+    // Forgets input[first..] and the output made from it. Returns where
+    // append() has to continue, the start of first's column.
+    int rewind(int first, QVector<QPointF> &output);
+
+    static void decimateM4(const QVector<QPointF> &input, QVector<QPointF> &output,
+                           qreal columnWidth = 1.0);
+
+private:
+    void emitRun(const QPointF *points, int last, QVector<QPointF> &output) const;
+
+    // Where each closed column started, in input and output.
+    struct Run {
+        int inputStart;
+        int outputStart;
+    };
+
+    qreal m_scale;
+    qint64 m_column;
+    int m_runStart;
+    int m_minIndex;
+    int m_maxIndex;
+    int m_runOutputStart;
+    int m_inputCount;
+    QVector<Run> m_runs;
+};
+
+#endif // DECIMATOR_H
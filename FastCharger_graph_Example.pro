@@ -1,10 +1,43 @@
-QT += quick charts
+QT += quick charts network svg
+
+# Structured trace points; drop from CONFIG to compile them out entirely.
+CONFIG += graph_tracing
+graph_tracing: DEFINES += GRAPH_TRACING
+# Float32 point columns: qmake CONFIG+=graph_float_samples
+graph_float_samples: DEFINES += GRAPH_FLOAT_SAMPLES
+# The performance suite is a separate project: benchmarks/benchmarks.pro
 
 SOURCES += \
+    AllocationCounter.cpp \
+    BatchRenderer.cpp \
+    CompressedChunk.cpp \
+    DataChunk.cpp \
     DataPoint.cpp \
+    DataPointModel.cpp \
     DataProvider.cpp \
+    DataSnapshot.cpp \
+    Decimator.cpp \
+    FleetEnvelope.cpp \
+    FrameScheduler.cpp \
+    GeometryWorker.cpp \
     GraphItem.cpp \
-    main.cpp
+    GraphNode.cpp \
+    GraphRenderer.cpp \
+    main.cpp \
+    PointKernels.cpp \
+    PowerStatistics.cpp \
+    ProviderRegistry.cpp \
+    QuantileSketch.cpp \
+    RenderCache.cpp \
+    ReplayController.cpp \
+    ReplaySource.cpp \
+    RollupTier.cpp \
+    SessionFile.cpp \
+    SessionWriter.cpp \
+    TelemetryIngestor.cpp \
+    TelemetryReader.cpp \
+    Trace.cpp \
+    TraceController.cpp
 
 RESOURCES += qml.qrc
 
@@ -14,6 +47,35 @@ else: unix:!android: target.path = /opt/$${TARGET}/bin
 !isEmpty(target.path): INSTALLS += target
 
 HEADERS += \
+    AllocationCounter.h \
+    BatchRenderer.h \
+    CompressedChunk.h \
+    DataChunk.h \
     DataPoint.h \
+    DataPointModel.h \
     DataProvider.h \
-    GraphItem.h
+    DataSnapshot.h \
+    Decimator.h \
+    FleetEnvelope.h \
+    FrameScheduler.h \
+    GeometryWorker.h \
+    GraphItem.h \
+    GraphNode.h \
+    GraphRenderer.h \
+    PointKernels.h \
+    PowerEnvelope.h \
+    PowerStatistics.h \
+    ProviderRegistry.h \
+    QuantileSketch.h \
+    RenderCache.h \
+    ReplayController.h \
+    ReplaySource.h \
+    RollupTier.h \
+    ScratchArena.h \
+    SessionFile.h \
+    SessionWriter.h \
+    SpscQueue.h \
+    TelemetryIngestor.h \
+    TelemetryReader.h \
+    Trace.h \
+    TraceController.h
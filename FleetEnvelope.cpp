@@ -0,0 +1,363 @@
+#include "FleetEnvelope.h"
+#include "PointKernels.h"
+#include "QuantileSketch.h"
+#include "SessionFile.h"
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QMutex>
+#include <QPointer>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+namespace {
+
+constexpr double MinSocStep = 0.01;
+constexpr double MaxSocStep = 10.0;
+constexpr double FullSoc = 100.0;
+
+int binCountFor(double socStep)
+{
+    return int(FullSoc / socStep + 0.5) + 1;
+}
+
+void widen(int from, int to, int *first, int *end)
+{
+    if (from >= to)
+        return;
+    *first = qMin(*first, from);
+    *end = qMax(*end, to);
+}
+
+// Interpolated power of session at every grid bin between its first and last
+// SOC, returned as [*first, *end). The segment between two chunks is
+// resampled on its own.
+void resampleSession(const DataSnapshot &session, double socStep, int binCount, double *grid,
+                     int *first, int *end)
+{
+    *first = binCount;
+    *end = 0;
+    Sample previous[2] = {};
+    bool hasPrevious = false;
+    for (int chunk = 0; chunk < session.chunkCount(); ++chunk) {
+        const int size = session.chunkSize(chunk);
+        if (size == 0)
+            continue;
+        const DataSnapshot::Columns columns = session.columns(chunk);
+        int from = 0;
+        int to = 0;
+        if (hasPrevious) {
+            const Sample soc[2] = { previous[0], columns.soc[0] };
+            const Sample power[2] = { previous[1], columns.power[0] };
+            PointKernels::resample(soc, power, 2, 0.0, socStep, binCount, grid, &from, &to);
+            widen(from, to, first, end);
+        }
+        PointKernels::resample(columns.soc, columns.power, size, 0.0, socStep, binCount, grid, &from, &to);
+        widen(from, to, first, end);
+        previous[0] = columns.soc[size - 1];
+        previous[1] = columns.power[size - 1];
+        hasPrevious = true;
+    }
+}
+
+} // namespace
+
+struct FleetEnvelope::Run
+{
+    QVector<DataSnapshot> sessions;
+    double socStep = DefaultSocStep;
+    int binCount = 0;
+    double minPower = 0.0;
+    double maxPower = 0.0;
+
+    std::atomic<int> next{ 0 };
+    std::atomic<bool> cancelled{ false };
+
+    QMutex mutex;
+    std::unique_ptr<QuantileSketch> merged;
+    int finished = 0;
+    // Called once, on the worker that merges the last sketch.
+    std::function<void(const PowerEnvelope &)> done;
+};
+
+FleetEnvelope::FleetEnvelope(QObject *parent)
+    : QObject{parent}
+    , m_socStep(DefaultSocStep)
+    , m_key(0)
+    , m_cache(CachedEnvelopes)
+    , m_busy(false)
+{
+}
+
+FleetEnvelope::~FleetEnvelope()
+{
+    if (m_run)
+        m_run->cancelled = true;
+}
+
+double FleetEnvelope::getSocStep() const
+{
+    return m_socStep;
+}
+
+void FleetEnvelope::setSocStep(double newSocStep)
+{
+    newSocStep = qBound(MinSocStep, newSocStep, MaxSocStep);
+    if (m_socStep == newSocStep)
+        return;
+    m_socStep = newSocStep;
+    emit socStepChanged();
+    start();
+}
+
+int FleetEnvelope::getSessionCount() const
+{
+    return m_envelope.sessionCount;
+}
+
+double FleetEnvelope::getPeakPower() const
+{
+    return m_envelope.peakPower;
+}
+
+bool FleetEnvelope::isBusy() const
+{
+    return m_busy;
+}
+
+const PowerEnvelope &FleetEnvelope::envelope() const
+{
+    return m_envelope;
+}
+
+void FleetEnvelope::setSessions(const QVector<DataSnapshot> &sessions)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    m_sessions = sessions;
+    start();
+}
+
+int FleetEnvelope::loadSessions(const QStringList &paths)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    QVector<DataSnapshot> sessions;
+    sessions.reserve(paths.size());
+    for (const QString &path : paths) {
+        QString errorString;
+        const QSharedPointer<SessionFile> session = SessionFile::open(path, &errorString);
+        if (!session) {
+            qWarning("Cannot open session %s: %s", qPrintable(path), qPrintable(errorString));
+            continue;
+        }
+        sessions.append(DataSnapshot::fromSession(session));
+    }
+    setSessions(sessions);
+    return sessions.size();
+}
+
+void FleetEnvelope::clear()
+{
+    setSessions(QVector<DataSnapshot>());
+}
+
+PowerEnvelope FleetEnvelope::compute(const QVector<DataSnapshot> &sessions, double socStep)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    const QSharedPointer<Run> run = createRun(sessions, qBound(MinSocStep, socStep, MaxSocStep));
+    if (run->sessions.isEmpty()) {
+        PowerEnvelope empty;
+        empty.socStep = run->socStep;
+        return empty;
+    }
+
+    // The calling thread works along, so this finishes even when every
+    // pool thread is busy. Helpers that start after the last session was
+    // taken return without touching the result.
+    PowerEnvelope result;
+    QSemaphore finished;
+    run->done = [&result, &finished](const PowerEnvelope &envelope) {
+        result = envelope;
+        finished.release();
+    };
+    const int helpers = qMin(pool()->maxThreadCount(), int(run->sessions.size()) - 1);
+    for (int i = 0; i < helpers; ++i)
+        pool()->start([run]() { work(run); });
+    work(run);
+    finished.acquire();
+    return result;
+}
+
+QThreadPool *FleetEnvelope::pool()
+{
+    // Separate from the geometry workers so a long fleet computation does
+    // not hold back the frames of the graphs. Parented to the application so
+    // that its destructor waits for workers still running.
+    static QThreadPool *pool = [] {
+        QThreadPool *threadPool = new QThreadPool(QCoreApplication::instance());
+        threadPool->setObjectName(QStringLiteral("FleetEnvelope"));
+        threadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+        return threadPool;
+    }();
+    return pool;
+}
+
+void FleetEnvelope::start()
+{
+    if (m_run) {
+        m_run->cancelled = true;
+        m_run.reset();
+    }
+
+    m_key = fingerprint(m_sessions, m_socStep);
+    if (const PowerEnvelope *cached = m_cache.object(m_key)) {
+        setEnvelope(*cached);
+        setBusy(false);
+        return;
+    }
+
+    const QSharedPointer<Run> run = createRun(m_sessions, m_socStep);
+    if (run->sessions.isEmpty()) {
+        PowerEnvelope empty;
+        empty.socStep = m_socStep;
+        setEnvelope(empty);
+        setBusy(false);
+        return;
+    }
+    QPointer<FleetEnvelope> guard(this);
+    const quint64 key = m_key;
+    run->done = [guard, key](const PowerEnvelope &envelope) {
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [guard, key, envelope]() {
+                // A newer session set or step has been requested meanwhile.
+                if (!guard || guard->m_key != key)
+                    return;
+                guard->m_cache.insert(key, new PowerEnvelope(envelope));
+                guard->m_run.reset();
+                guard->setEnvelope(envelope);
+                guard->setBusy(false);
+            },
+            Qt::QueuedConnection);
+    };
+    m_run = run;
+    setBusy(true);
+
+    const int workers = qMin(pool()->maxThreadCount(), int(run->sessions.size()));
+    for (int i = 0; i < workers; ++i)
+        pool()->start([run]() { work(run); });
+}
+
+void FleetEnvelope::setEnvelope(const PowerEnvelope &envelope)
+{
+    m_envelope = envelope;
+    emit envelopeChanged();
+}
+
+void FleetEnvelope::setBusy(bool busy)
+{
+    if (m_busy == busy)
+        return;
+    m_busy = busy;
+    emit busyChanged();
+}
+
+quint64 FleetEnvelope::fingerprint(const QVector<DataSnapshot> &sessions, double socStep)
+{
+    // Generation, size, chunk summaries and chunk end points of every
+    // session: exact for provider snapshots, and enough to tell recorded
+    // sessions apart without reading their samples.
+    QVector<double> values;
+    values.reserve(2 + sessions.size() * 2);
+    values << socStep << double(sessions.size());
+    for (const DataSnapshot &session : sessions) {
+        values << double(session.generation()) << double(session.size());
+        for (int chunk = 0; chunk < session.chunkCount(); ++chunk) {
+            const ChunkSummary &summary = session.chunkSummary(chunk);
+            const DataPoint first = session.chunkFirst(chunk);
+            const DataPoint last = session.chunkLast(chunk);
+            values << summary.minSoc << summary.maxSoc << summary.minPower << summary.maxPower
+                   << double(first.getTimestamp()) << double(last.getTimestamp());
+        }
+    }
+    return quint64(qHashBits(values.constData(), size_t(values.size()) * sizeof(double)));
+}
+
+QSharedPointer<FleetEnvelope::Run> FleetEnvelope::createRun(const QVector<DataSnapshot> &sessions, double socStep)
+{
+    QSharedPointer<Run> run(new Run);
+    run->socStep = socStep;
+    run->binCount = binCountFor(socStep);
+    bool hasRange = false;
+    for (const DataSnapshot &session : sessions) {
+        double minPower = 0.0;
+        double maxPower = 0.0;
+        if (!session.powerRange(&minPower, &maxPower))
+            continue;
+        run->sessions.append(session);
+        run->minPower = hasRange ? qMin(run->minPower, minPower) : minPower;
+        run->maxPower = hasRange ? qMax(run->maxPower, maxPower) : maxPower;
+        hasRange = true;
+    }
+    // Power axes start at zero, and so do the sketch buckets unless a
+    // session fed power back (negative values).
+    run->minPower = qMin(0.0, run->minPower);
+    return run;
+}
+
+void FleetEnvelope::work(const QSharedPointer<Run> &run)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    std::unique_ptr<QuantileSketch> sketch;
+    QVector<double> grid;
+    int processed = 0;
+    const int sessionCount = run->sessions.size();
+    for (;;) {
+        if (run->cancelled)
+            return;
+        const int index = run->next.fetch_add(1);
+        if (index >= sessionCount)
+            break;
+        if (!sketch) {
+            sketch.reset(new QuantileSketch(run->binCount, run->minPower, run->maxPower));
+            grid.resize(run->binCount);
+        }
+
+        int first = 0;
+        int end = 0;
+        resampleSession(run->sessions.at(index), run->socStep, run->binCount, grid.data(), &first, &end);
+        for (int bin = first; bin < end; ++bin)
+            sketch->add(bin, grid.at(bin));
+        ++processed;
+    }
+    if (processed == 0)
+        return;
+
+    QMutexLocker locker(&run->mutex);
+    if (run->merged)
+        run->merged->merge(*sketch);
+    else
+        run->merged = std::move(sketch);
+    run->finished += processed;
+    if (run->finished < sessionCount)
+        return;
+
+    const QuantileSketch &merged = *run->merged;
+    PowerEnvelope envelope;
+    envelope.socStep = run->socStep;
+    envelope.sessionCount = sessionCount;
+    envelope.lower.resize(run->binCount);
+    envelope.median.resize(run->binCount);
+    envelope.upper.resize(run->binCount);
+    for (int bin = 0; bin < run->binCount; ++bin) {
+        envelope.lower[bin] = merged.quantile(bin, LowerQuantile);
+        envelope.median[bin] = merged.quantile(bin, MedianQuantile);
+        envelope.upper[bin] = merged.quantile(bin, UpperQuantile);
+        if (merged.count(bin) > 0)
+            envelope.peakPower = qMax(envelope.peakPower, envelope.upper.at(bin));
+    }
+    locker.unlock();
+    run->done(envelope);
+}
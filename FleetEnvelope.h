@@ -0,0 +1,93 @@
+#ifndef FLEETENVELOPE_H
+#define FLEETENVELOPE_H
+
+#include <QObject>
+#include <QCache>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QVector>
+#include "DataSnapshot.h"
+#include "PowerEnvelope.h"
+
+class QThreadPool;
+
+// Power-vs-SOC envelope of a fleet of charging sessions: P10, P50 and P90
+// power per SOC bin of socStep percent over 0-100 %, for GraphItem to draw
+// behind the live curve.
+//
+// Every session is resampled onto the SOC grid by linear interpolation, so
+// sessions weigh the same whatever their sample rate, and only counts for the
+// bins between its first and last SOC. Sessions are handed out one at a time
+// to the workers of pool(); each fills its own QuantileSketch and the last
+// one to finish merges and evaluates them. Envelopes are kept per session set
+// and step, so going back to a set computed before costs nothing.
+class FleetEnvelope : public QObject
+{
+    Q_OBJECT
+
+    Q_PROPERTY(double socStep READ getSocStep WRITE setSocStep NOTIFY socStepChanged FINAL)
+    Q_PROPERTY(int sessionCount READ getSessionCount NOTIFY envelopeChanged FINAL)
+    Q_PROPERTY(double peakPower READ getPeakPower NOTIFY envelopeChanged FINAL)
+    Q_PROPERTY(bool busy READ isBusy NOTIFY busyChanged FINAL)
+
+public:
+    static constexpr double DefaultSocStep = 0.1;
+    static constexpr double LowerQuantile = 0.1;
+    static constexpr double MedianQuantile = 0.5;
+    static constexpr double UpperQuantile = 0.9;
+
+    explicit FleetEnvelope(QObject *parent = nullptr);
+    ~FleetEnvelope();
+
+    double getSocStep() const;
+    void setSocStep(double newSocStep);
+
+    int getSessionCount() const;
+    double getPeakPower() const;
+    bool isBusy() const;
+
+    // The last finished envelope; it stays in place while a new one is
+    // computed.
+    const PowerEnvelope &envelope() const;
+
+    // Sessions must be sorted by SOC. Recomputes in the background unless
+    // the envelope of this set is cached.
+    void setSessions(const QVector<DataSnapshot> &sessions);
+    // Opens recorded session files and uses them as the fleet. Returns how
+    // many could be opened.
+    Q_INVOKABLE int loadSessions(const QStringList &paths);
+    Q_INVOKABLE void clear();
+
+    // The same computation on the calling thread plus the pool, returning
+    // when done. For benchmarks and batch use.
+    static PowerEnvelope compute(const QVector<DataSnapshot> &sessions, double socStep);
+
+    static QThreadPool *pool();
+
+signals:
+    void socStepChanged();
+    void envelopeChanged();
+    void busyChanged();
+
+private:
+    struct Run;
+
+    void start();
+    void setEnvelope(const PowerEnvelope &envelope);
+    void setBusy(bool busy);
+    static quint64 fingerprint(const QVector<DataSnapshot> &sessions, double socStep);
+    static QSharedPointer<Run> createRun(const QVector<DataSnapshot> &sessions, double socStep);
+    static void work(const QSharedPointer<Run> &run);
+
+    static constexpr int CachedEnvelopes = 8;
+
+    double m_socStep;
+    QVector<DataSnapshot> m_sessions;
+    quint64 m_key;
+    PowerEnvelope m_envelope;
+    QCache<quint64, PowerEnvelope> m_cache;
+    QSharedPointer<Run> m_run;
+    bool m_busy;
+};
+
+#endif // FLEETENVELOPE_H
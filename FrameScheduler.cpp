@@ -0,0 +1,206 @@
+#include "FrameScheduler.h"
+#include "Trace.h"
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QScreen>
+
+namespace {
+
+constexpr double DefaultRefreshRate = 60.0;
+// Exponential smoothing of the frame cost.
+constexpr double Smoothing = 0.1;
+// Hysteresis: step down quickly when over budget, step up slowly once the
+// frames are cheap enough that the next level up should still fit.
+constexpr double OverBudgetRatio = 0.8;
+constexpr double UnderBudgetRatio = 0.4;
+constexpr int StepDownFrames = 5;
+constexpr int StepUpFrames = 60;
+// frameTime is for display; notifying every frame would itself keep QML
+// bindings, and so the window, busy.
+constexpr int ReportInterval = 250;
+
+} // namespace
+
+FrameScheduler::FrameScheduler(QQuickWindow *window)
+    : QObject{window}
+    , m_window(window)
+    , m_renderCache(QSharedPointer<RenderCache>::create())
+    , m_renderNanoseconds(0)
+    , m_polishNanoseconds(0)
+    , m_quality(HighQuality)
+    , m_adaptive(true)
+    , m_frameBudget(1000.0 / DefaultRefreshRate)
+    , m_frameTime(0.0)
+    , m_reportedFrameTime(0.0)
+    , m_overBudgetFrames(0)
+    , m_underBudgetFrames(0)
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    updateFrameBudget();
+    m_reportTimer.start();
+    connect(window, &QWindow::screenChanged, this, &FrameScheduler::updateFrameBudget);
+
+    // The render thread signals are handled where they are emitted; only
+    // the finished measurement is posted back to the GUI thread.
+    connect(window, &QQuickWindow::beforeSynchronizing, this, &FrameScheduler::onBeforeSynchronizing,
+            Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterSynchronizing, this, &FrameScheduler::onAfterSynchronizing,
+            Qt::DirectConnection);
+    connect(window, &QQuickWindow::beforeRendering, this, &FrameScheduler::onBeforeRendering,
+            Qt::DirectConnection);
+    connect(window, &QQuickWindow::afterRendering, this, &FrameScheduler::onAfterRendering,
+            Qt::DirectConnection);
+    connect(window, &QQuickWindow::frameSwapped, this, &FrameScheduler::onFrameSwapped, Qt::DirectConnection);
+}
+
+FrameScheduler *FrameScheduler::forWindow(QQuickWindow *window)
+{
+    if (!window)
+        return nullptr;
+    FrameScheduler *scheduler = window->findChild<FrameScheduler *>(QString(), Qt::FindDirectChildrenOnly);
+    return scheduler ? scheduler : new FrameScheduler(window);
+}
+
+void FrameScheduler::schedule(QQuickItem *item)
+{
+    item->polish();
+    if (m_pending.contains(item))
+        return;
+    m_pending.insert(item);
+    item->update();
+}
+
+void FrameScheduler::unschedule(QQuickItem *item)
+{
+    m_pending.remove(item);
+}
+
+void FrameScheduler::addPolishTime(qint64 nanoseconds)
+{
+    m_polishNanoseconds += nanoseconds;
+}
+
+QSharedPointer<RenderCache> FrameScheduler::renderCache() const
+{
+    return m_renderCache;
+}
+
+FrameScheduler::Quality FrameScheduler::getQuality() const
+{
+    return m_quality;
+}
+
+bool FrameScheduler::isAdaptive() const
+{
+    return m_adaptive;
+}
+
+void FrameScheduler::setAdaptive(bool newAdaptive)
+{
+    if (m_adaptive == newAdaptive)
+        return;
+    m_adaptive = newAdaptive;
+    emit adaptiveChanged();
+    if (!m_adaptive)
+        setQuality(HighQuality);
+}
+
+double FrameScheduler::getFrameBudget() const
+{
+    return m_frameBudget;
+}
+
+double FrameScheduler::getFrameTime() const
+{
+    return m_reportedFrameTime;
+}
+
+bool FrameScheduler::isOverBudget() const
+{
+    return m_reportedFrameTime > m_frameBudget;
+}
+
+void FrameScheduler::updateFrameBudget()
+{
+    const QScreen *screen = m_window ? m_window->screen() : nullptr;
+    const double refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : DefaultRefreshRate;
+    const double budget = 1000.0 / refreshRate;
+    if (qFuzzyCompare(m_frameBudget, budget))
+        return;
+    m_frameBudget = budget;
+    emit frameBudgetChanged();
+}
+
+void FrameScheduler::recordFrame(qint64 renderNanoseconds)
+{
+    const double cost = (renderNanoseconds + m_polishNanoseconds) / 1e6;
+    m_polishNanoseconds = 0;
+    m_frameTime = m_frameTime > 0.0 ? m_frameTime + (cost - m_frameTime) * Smoothing : cost;
+    GRAPH_TRACE_COUNTER(TraceRender, "frameCostUs", qint64(cost * 1000));
+
+    if (m_adaptive) {
+        if (m_frameTime > m_frameBudget * OverBudgetRatio) {
+            m_underBudgetFrames = 0;
+            if (++m_overBudgetFrames >= StepDownFrames && m_quality < CoarseDecimation)
+                setQuality(Quality(m_quality + 1));
+        } else if (m_frameTime < m_frameBudget * UnderBudgetRatio) {
+            m_overBudgetFrames = 0;
+            if (++m_underBudgetFrames >= StepUpFrames && m_quality > HighQuality)
+                setQuality(Quality(m_quality - 1));
+        } else {
+            m_overBudgetFrames = 0;
+            m_underBudgetFrames = 0;
+        }
+    }
+
+    if (m_reportTimer.elapsed() >= ReportInterval && !qFuzzyCompare(m_reportedFrameTime, m_frameTime)) {
+        m_reportTimer.restart();
+        m_reportedFrameTime = m_frameTime;
+        emit frameTimeChanged();
+    }
+}
+
+void FrameScheduler::setQuality(Quality newQuality)
+{
+    if (m_quality == newQuality)
+        return;
+    GRAPH_TRACE_COUNTER(TraceRender, "quality", newQuality);
+    m_quality = newQuality;
+    // The smoothed cost belongs to the old level; measure the new one afresh.
+    m_frameTime = 0.0;
+    m_overBudgetFrames = 0;
+    m_underBudgetFrames = 0;
+    emit qualityChanged();
+}
+
+void FrameScheduler::onBeforeSynchronizing()
+{
+    // The GUI thread is blocked until the sync is done, so everything
+    // scheduled so far is taken by this frame.
+    m_pending.clear();
+    m_renderNanoseconds = 0;
+    m_phaseTimer.start();
+}
+
+void FrameScheduler::onAfterSynchronizing()
+{
+    m_renderNanoseconds += m_phaseTimer.nsecsElapsed();
+}
+
+void FrameScheduler::onBeforeRendering()
+{
+    m_phaseTimer.start();
+}
+
+void FrameScheduler::onAfterRendering()
+{
+    m_renderNanoseconds += m_phaseTimer.nsecsElapsed();
+}
+
+void FrameScheduler::onFrameSwapped()
+{
+    const qint64 renderNanoseconds = m_renderNanoseconds;
+    QMetaObject::invokeMethod(this, [this, renderNanoseconds]() {
+        recordFrame(renderNanoseconds);
+    }, Qt::QueuedConnection);
+}
@@ -0,0 +1,110 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include "RenderCache.h"
+
+class QQuickItem;
+class QQuickWindow;
+
+// One per QQuickWindow, shared by every graph in it.
+//
+// Items route their repaint requests through schedule(), which updates an
+// item at most once per frame however many provider notifications arrive
+// before the next sync. Polishing is requested on every call, since a
+// change arriving after this frame's polish has to be mapped in the next
+// one; Qt still polishes each item once per frame.
+//
+// It also measures what each frame costs (item polish on the GUI thread,
+// sync and render on the render thread) against the refresh interval of the
+// window's screen. While the smoothed cost stays over budget the quality
+// level is stepped down one level at a time; once it has stayed well under
+// budget for about a second it is stepped back up. Levels are cumulative:
+//
+//   HighQuality       everything on
+//   NoAntialiasing    curve and markers drawn without antialiasing
+//   NoFill            no gradient fill under the curve
+//   CoarseDecimation  M4 decimation over two pixel wide columns
+//
+// The graphs of the window share its RenderCache, so N identically styled
+// graphs lay out their text and render their chrome once.
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(Quality quality READ getQuality NOTIFY qualityChanged FINAL)
+    Q_PROPERTY(bool adaptive READ isAdaptive WRITE setAdaptive NOTIFY adaptiveChanged FINAL)
+    Q_PROPERTY(double frameBudget READ getFrameBudget NOTIFY frameBudgetChanged FINAL)
+    Q_PROPERTY(double frameTime READ getFrameTime NOTIFY frameTimeChanged FINAL)
+    Q_PROPERTY(bool overBudget READ isOverBudget NOTIFY frameTimeChanged FINAL)
+
+public:
+    enum Quality {
+        HighQuality,
+        NoAntialiasing,
+        NoFill,
+        CoarseDecimation
+    };
+    Q_ENUM(Quality)
+
+    // Returns the scheduler of window, creating it on first use.
+    static FrameScheduler *forWindow(QQuickWindow *window);
+
+    void schedule(QQuickItem *item);
+    // Called by an item leaving the window or being destroyed.
+    void unschedule(QQuickItem *item);
+    // GUI thread work done for the coming frame, added to its cost.
+    void addPolishTime(qint64 nanoseconds);
+
+    QSharedPointer<RenderCache> renderCache() const;
+
+    Quality getQuality() const;
+    bool isAdaptive() const;
+    void setAdaptive(bool newAdaptive);
+    double getFrameBudget() const;
+    double getFrameTime() const;
+    bool isOverBudget() const;
+
+signals:
+    void qualityChanged();
+    void adaptiveChanged();
+    void frameBudgetChanged();
+    void frameTimeChanged();
+
+private:
+    explicit FrameScheduler(QQuickWindow *window);
+
+    void updateFrameBudget();
+    void recordFrame(qint64 renderNanoseconds);
+    void setQuality(Quality newQuality);
+
+    // Render thread.
+    void onBeforeSynchronizing();
+    void onAfterSynchronizing();
+    void onBeforeRendering();
+    void onAfterRendering();
+    void onFrameSwapped();
+
+    QPointer<QQuickWindow> m_window;
+    // Only touched on the GUI thread or while it is blocked in sync.
+    QSet<QQuickItem *> m_pending;
+    QSharedPointer<RenderCache> m_renderCache;
+
+    QElapsedTimer m_phaseTimer;
+    qint64 m_renderNanoseconds;
+
+    qint64 m_polishNanoseconds;
+    Quality m_quality;
+    bool m_adaptive;
+    double m_frameBudget;
+    double m_frameTime;
+    double m_reportedFrameTime;
+    int m_overBudgetFrames;
+    int m_underBudgetFrames;
+    QElapsedTimer m_reportTimer;
+};
+
+#endif // FRAMESCHEDULER_H
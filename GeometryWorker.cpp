@@ -0,0 +1,85 @@
+#include "GeometryWorker.h"
+#include "GraphRenderer.h"
+#include "Trace.h"
+#include <QCoreApplication>
+#include <QPointer>
+#include <QThread>
+#include <QThreadPool>
+
+void GeometryWorker::run(Job &job)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    // The Y scale only changes together with the peak power, which forces a
+    // full rebuild, so points already mapped stay valid and only the points
+    // from the first new or replaced one on have to be mapped and
+    // decimated, unless that one went into a chunk mapped from its summary.
+    // While zoomed only the visible range is mapped, which is bounded by the
+    // viewport rather than the session, so it is simply mapped again.
+    const int first = job.appendFrom;
+    if (first >= 0 && first >= job.mappedExactFrom && first <= job.mappedSourceCount
+        && first <= job.snapshot.size() && !job.zoomed) {
+        append(job);
+        return;
+    }
+
+    GraphRenderer::mapRange(job.snapshot, job.first, job.end, job.transform, job.devicePixelRatio,
+                            job.decimate, job.decimator, job.mapped, job.pixels, &job.mappedExactFrom);
+    job.mappedSourceCount = job.snapshot.size();
+    job.visibleCount = job.end - job.first;
+    job.pixelDirtyFrom = 0;
+}
+
+void GeometryWorker::append(Job &job)
+{
+    const DataSnapshot &snapshot = job.snapshot;
+    const int first = job.appendFrom;
+    QVector<QPointF> &mapped = job.decimate ? job.mapped : job.pixels;
+
+    // Collapsed chunks, all before mappedExactFrom, make mapped shorter
+    // than the source; from there on it is one to one.
+    const int mappedFirst = mapped.size() - (job.mappedSourceCount - first);
+    mapped.resize(mappedFirst + snapshot.size() - first);
+    for (int i = first; i < snapshot.size();) {
+        const int chunk = snapshot.chunkIndex(i);
+        const int offset = i - snapshot.chunkStart(chunk);
+        const int count = snapshot.chunkSize(chunk) - offset;
+        const DataSnapshot::Columns columns = snapshot.columns(chunk);
+        PointKernels::mapToPixel(columns.soc + offset, columns.power + offset, count, job.transform,
+                                 mapped.data() + mappedFirst + (i - first));
+        i += count;
+    }
+    job.mappedSourceCount = snapshot.size();
+    job.visibleCount = snapshot.size();
+    job.pixelDirtyFrom = job.decimate
+                             ? job.decimator.append(job.mapped, job.decimator.rewind(mappedFirst, job.pixels),
+                                                    job.pixels)
+                             : mappedFirst;
+}
+
+void GeometryWorker::start(Job job, QObject *receiver, std::function<void(Job &)> done)
+{
+    QPointer<QObject> guard(receiver);
+    pool()->start([job = std::move(job), guard, done = std::move(done)]() mutable {
+        run(job);
+        QMetaObject::invokeMethod(
+            QCoreApplication::instance(),
+            [job = std::move(job), guard, done = std::move(done)]() mutable {
+                if (guard)
+                    done(job);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+QThreadPool *GeometryWorker::pool()
+{
+    // Parented to the application so that its destructor waits for jobs
+    // still running. The GUI and render threads keep a core each.
+    static QThreadPool *pool = [] {
+        QThreadPool *threadPool = new QThreadPool(QCoreApplication::instance());
+        threadPool->setObjectName(QStringLiteral("GeometryWorker"));
+        threadPool->setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 2));
+        return threadPool;
+    }();
+    return pool;
+}
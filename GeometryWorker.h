@@ -0,0 +1,65 @@
+#ifndef GEOMETRYWORKER_H
+#define GEOMETRYWORKER_H
+
+#include <QPointF>
+#include <QVector>
+#include <functional>
+#include "DataSnapshot.h"
+#include "Decimator.h"
+#include "PointKernels.h"
+
+class QObject;
+class QThreadPool;
+
+// Mapping and decimation of a graph's points as a self-contained job, so it
+// can run on the caller's thread or on the worker pool shared by every graph
+// of the process. A job owns copies of everything it reads; the buffers it
+// fills are handed back to the item that submitted it.
+class GeometryWorker
+{
+public:
+    struct Job {
+        // Inputs.
+        DataSnapshot snapshot;
+        int historyCount = 0;
+        double peakPower = 0.0;
+        PixelTransform transform = {};
+        // Visible index range; the whole snapshot unless zoomed.
+        int first = 0;
+        int end = 0;
+        bool zoomed = false;
+        qreal devicePixelRatio = 1.0;
+        bool decimate = true;
+        // First new or replaced point since the previous job, or -1 to map
+        // everything.
+        int appendFrom = -1;
+
+        // State carried from one job to the next.
+        Decimator decimator;
+        QVector<QPointF> mapped;
+        QVector<QPointF> pixels;
+        int mappedSourceCount = 0;
+        // Points from here on were mapped one by one; see
+        // GraphRenderer::mapRange().
+        int mappedExactFrom = 0;
+
+        // Results.
+        int visibleCount = 0;
+        int pixelDirtyFrom = 0;
+    };
+
+    // Maps job.snapshot into job.pixels. Appended or replaced points are
+    // mapped and decimated from the first of them on when the previous job
+    // covered everything before them.
+    static void run(Job &job);
+    // Runs job on the pool and passes the result to done on the GUI thread,
+    // unless receiver has been destroyed by then.
+    static void start(Job job, QObject *receiver, std::function<void(Job &)> done);
+
+    static QThreadPool *pool();
+
+private:
+    static void append(Job &job);
+};
+
+#endif // GEOMETRYWORKER_H
@@ -1,38 +1,532 @@
 #include "GraphItem.h"
-#include <QPainterPath>
-#include <QLinearGradient>
-#include <QPolygonF>
+#include "Decimator.h"
+#include "Trace.h"
+#include <QQuickWindow>
+#include <QElapsedTimer>
+#include <QFontMetrics>
+#include <QMouseEvent>
+#include <QWheelEvent>
 #include <QtMath>
 
-GraphItem::GraphItem() : m_graphPointsProvider(nullptr)
+GraphItem::GraphItem()
+    : m_graphPointsProvider(nullptr)
+    , m_dirty(AllDirty)
+    , m_decimationEnabled(true)
+    , m_decimationInputCount(0)
+    , m_decimationOutputCount(0)
+    , m_historyResolution(DataProvider::SecondResolution)
+    , m_historyCount(0)
+    , m_mappedGeneration(InvalidGeneration)
+    , m_mappedPeakPower(0.0)
+    , m_appendFrom(-1)
+    , m_mappedSourceCount(0)
+    , m_mappedExactFrom(0)
+    , m_pixelDirtyFrom(0)
+    , m_threadedGeometry(false)
+    , m_geometryBusy(false)
+    , m_pendingDirty(0)
+    , m_appliedDirty(0)
+    , m_unmappedDirty(0)
+    , m_dragX(0)
+    , m_dragging(false)
+    , m_hoverX(0)
+    , m_hovering(false)
+    , m_hoverIndex(-1)
+    , m_decimationColumnWidth(1.0)
 {
+    setFlag(ItemHasContents, true);
+    setAcceptedMouseButtons(Qt::LeftButton);
+    setAcceptHoverEvents(true);
     initializeDefaults();
+
+    // The renderer's chrome layer and text layouts only follow these.
+    connect(this, &GraphItem::backgroundColorChanged, this, &GraphItem::onThemeChanged);
+    connect(this, &GraphItem::textColorChanged, this, &GraphItem::onThemeChanged);
+    connect(this, &GraphItem::lineColorChanged, this, &GraphItem::onThemeChanged);
+    connect(this, &GraphItem::titleChanged, this, &GraphItem::onLabelsChanged);
+    connect(this, &GraphItem::xAxisLabelChanged, this, &GraphItem::onLabelsChanged);
+    connect(this, &GraphItem::yAxisLabelChanged, this, &GraphItem::onLabelsChanged);
 }
 
-void GraphItem::paint(QPainter *painter)
+GraphItem::~GraphItem()
 {
-    if (!m_graphPointsProvider) {
-        qDebug() << "No data provider set";
+    if (m_scheduler)
+        m_scheduler->unschedule(this);
+}
+
+QSGNode *GraphItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    Q_UNUSED(data)
+
+    m_dirty |= m_appliedDirty;
+    m_appliedDirty = 0;
+    if (!m_graphPointsProvider || width() <= 0 || height() <= 0) {
+        delete oldNode;
+        m_dirty = AllDirty;
+        return nullptr;
+    }
+
+    GraphNode *node = static_cast<GraphNode *>(oldNode);
+    if (!node) {
+        node = new GraphNode(window());
+        m_dirty = AllDirty;
+    }
+
+    if (m_dirty & (GeometryDirty | DataDirty | EnvelopeDirty))
+        updateEnvelopePixels();
+
+    if (node->isSoftware()) {
+        updateSoftwareLayers(node, m_dirty);
+    } else {
+        if (m_dirty & (GeometryDirty | ThemeDirty | LabelsDirty))
+            updateChromeNodes(node);
+        if (m_dirty & (GeometryDirty | ThemeDirty | DataDirty))
+            updateDataNodes(node, 0);
+        else if (m_dirty & AppendDirty)
+            updateDataNodes(node, m_pixelDirtyFrom);
+        if (m_dirty & (GeometryDirty | ThemeDirty | DataDirty | EnvelopeDirty))
+            node->setEnvelope(m_envelopeLower, m_envelopeMedian, m_envelopeUpper,
+                              m_renderer.envelopeBandColor(), m_renderer.envelopeLineColor());
+    }
+    if (m_dirty)
+        updateOverlayNodes(node);
+
+    m_dirty = m_unmappedDirty;
+    m_pixelDirtyFrom = m_pixelPoints.size();
+    return node;
+}
+
+void GraphItem::updatePolish()
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    updateGeometry(m_threadedGeometry && window());
+}
+
+void GraphItem::updateGeometry(bool threaded)
+{
+    if (!(m_dirty & (GeometryDirty | DataDirty | AppendDirty)))
+        return;
+    m_unmappedDirty = 0;
+    if (m_geometryBusy) {
+        m_pendingDirty |= m_dirty & (GeometryDirty | DataDirty | AppendDirty);
         return;
     }
 
+    QElapsedTimer timer;
+    timer.start();
+
+    // The snapshot taken here is what the render thread reads during the
+    // next sync, independent of what the provider does in the meantime.
+    const DataSnapshot raw = m_graphPointsProvider ? m_graphPointsProvider->snapshot() : DataSnapshot();
+    DataSnapshot history;
+    if (m_graphPointsProvider) {
+        const DataProvider::Resolution resolution = historyResolution(raw);
+        if (resolution != m_historyResolution) {
+            m_historyResolution = resolution;
+            m_mappedGeneration = InvalidGeneration;
+            m_dirty |= DataDirty;
+        }
+        history = m_graphPointsProvider->historySnapshot(resolution);
+    }
+    const DataSnapshot snapshot = raw.prepended(history);
+    double peakPower = m_graphPointsProvider ? m_graphPointsProvider->getPeakPower() : 0.0;
+    if (m_envelope)
+        peakPower = qMax(peakPower, m_envelope->getPeakPower());
+
+    if (!(m_dirty & GeometryDirty) && snapshot.generation() == m_mappedGeneration
+        && peakPower == m_mappedPeakPower) {
+        // Nothing the curve depends on changed since it was last mapped.
+        m_dirty &= ~(DataDirty | AppendDirty);
+        m_snapshot = snapshot;
+        m_historyCount = history.size();
+        m_appendFrom = -1;
+        updateHoverIndex();
+    } else {
+        GeometryWorker::Job job;
+        job.snapshot = snapshot;
+        job.historyCount = history.size();
+        job.peakPower = peakPower;
+        job.transform = m_renderer.pixelTransform(peakPower);
+        m_renderer.visibleRange(snapshot, &job.first, &job.end);
+        job.zoomed = m_renderer.isZoomed();
+        // Coarser decimation under load is a lower effective pixel ratio.
+        job.devicePixelRatio = (window() ? window()->effectiveDevicePixelRatio() : 1.0) / m_decimationColumnWidth;
+        job.decimate = m_decimationEnabled;
+        if (!(m_dirty & (GeometryDirty | DataDirty)) && peakPower == m_mappedPeakPower && m_appendFrom >= 0)
+            job.appendFrom = job.historyCount + m_appendFrom;
+        job.decimator = std::move(m_decimator);
+        job.mapped = std::move(m_mappedPoints);
+        job.mappedSourceCount = m_mappedSourceCount;
+        job.mappedExactFrom = m_mappedExactFrom;
+        m_appendFrom = -1;
+
+        if (threaded) {
+            // The render thread keeps syncing from the current pixels until
+            // the result is back.
+            job.pixels = m_pixelPoints;
+            m_geometryBusy = true;
+            GeometryWorker::start(std::move(job), this,
+                                  [this](GeometryWorker::Job &result) { onGeometryReady(result); });
+        } else {
+            job.pixels = std::move(m_pixelPoints);
+            GeometryWorker::run(job);
+            applyGeometry(job);
+        }
+    }
+
+    if (m_scheduler)
+        m_scheduler->addPolishTime(timer.nsecsElapsed());
+}
+
+void GraphItem::applyGeometry(GeometryWorker::Job &job)
+{
+    m_snapshot = job.snapshot;
+    m_historyCount = job.historyCount;
+    m_mappedGeneration = job.snapshot.generation();
+    m_mappedPeakPower = job.peakPower;
+    m_decimator = std::move(job.decimator);
+    m_mappedPoints = std::move(job.mapped);
+    m_pixelPoints = std::move(job.pixels);
+    m_mappedSourceCount = job.mappedSourceCount;
+    m_mappedExactFrom = job.mappedExactFrom;
+    m_pixelDirtyFrom = qMin(m_pixelDirtyFrom, job.pixelDirtyFrom);
+    setDecimationStats(job.visibleCount, m_pixelPoints.size());
+    updateHoverIndex();
+}
+
+void GraphItem::onGeometryReady(GeometryWorker::Job &job)
+{
+    m_geometryBusy = false;
+    applyGeometry(job);
+
+    // The sync after the submitting polish has consumed its node flags.
+    m_appliedDirty |= job.pixelDirtyFrom == 0 ? DataDirty : AppendDirty;
+    if (!m_pendingDirty) {
+        update();
+        return;
+    }
+    // A forced remap requested meanwhile was overwritten by the result.
+    if (m_pendingDirty & DataDirty)
+        m_mappedGeneration = InvalidGeneration;
+    const int pending = m_pendingDirty;
+    m_pendingDirty = 0;
+    markDirty(pending);
+}
+
+void GraphItem::paint(QPainter *painter)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    if (!m_graphPointsProvider || width() <= 0 || height() <= 0)
+        return;
+
+    // Mapped right here: the caller wants the current data drawn now.
+    updateGeometry(false);
+    // Without a window there is no scene graph to consume the geometry flag,
+    // and keeping it would remap every point on each call.
+    if (!window())
+        m_dirty &= ~GeometryDirty;
+
+    painter->save();
     painter->setRenderHint(QPainter::Antialiasing, true);
+    // Raster targets get the cached chrome blitted; vector ones (SVG, PDF)
+    // need the real drawing calls.
+    if (painter->paintEngine()->type() == QPaintEngine::Raster)
+        painter->drawImage(QPointF(0, 0), m_renderer.chromeLayer(painter->device()->devicePixelRatioF()));
+    else
+        m_renderer.drawChrome(painter);
+    updateEnvelopePixels();
+    m_renderer.drawEnvelope(painter, m_envelopeLower, m_envelopeMedian, m_envelopeUpper);
+    m_renderer.drawData(painter, m_snapshot, peakPower(), m_pixelPoints);
+    painter->restore();
+}
 
-    drawBackground(painter);
-    drawTitle(painter);
-    drawAxes(painter);
-    drawAxisLabels(painter);
-    drawAxisValues(painter);
-    drawGraph(painter);
-    drawEndPoints(painter);
-    drawArrows(painter);
+void GraphItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size()) {
+        m_renderer.setSize(newGeometry.size());
+        markDirty(GeometryDirty);
+    }
 }
 
 void GraphItem::onDataChanged()
 {
+    markDirty(DataDirty);
+}
+
+void GraphItem::onPointsAppended(int first, int count)
+{
+    Q_UNUSED(count)
+    m_appendFrom = m_appendFrom < 0 ? first : qMin(m_appendFrom, first);
+    markDirty(AppendDirty);
+}
+
+void GraphItem::onProviderDestroyed()
+{
+    // The QPointer is already null here; the last snapshot still holds the
+    // chunks, but nothing must be drawn from a provider that is gone.
+    m_graphPointsProvider = nullptr;
+    emit graphPointsProviderChanged();
+    markDirty(AllDirty);
+}
+
+void GraphItem::onThemeChanged()
+{
+    markDirty(ThemeDirty);
+}
+
+void GraphItem::onLabelsChanged()
+{
+    markDirty(LabelsDirty);
+}
+
+void GraphItem::onQualityChanged()
+{
+    const FrameScheduler::Quality quality = m_scheduler ? m_scheduler->getQuality() : FrameScheduler::HighQuality;
+    m_renderer.setAntialiasing(quality < FrameScheduler::NoAntialiasing);
+    m_renderer.setFillEnabled(quality < FrameScheduler::NoFill);
+
+    const qreal columnWidth = quality < FrameScheduler::CoarseDecimation ? 1.0 : 2.0;
+    if (columnWidth != m_decimationColumnWidth) {
+        m_decimationColumnWidth = columnWidth;
+        m_mappedGeneration = InvalidGeneration;
+        markDirty(DataDirty);
+    }
+    markDirty(ThemeDirty);
+}
+
+void GraphItem::onEnvelopeChanged()
+{
+    // DataDirty has the next polish pick up a changed power scale.
+    markDirty(EnvelopeDirty | DataDirty);
+}
+
+void GraphItem::markDirty(int flags)
+{
+    m_dirty |= flags;
+    m_unmappedDirty |= flags & (GeometryDirty | DataDirty | AppendDirty);
+    if (flags & (ThemeDirty | LabelsDirty))
+        m_renderer.setStyle(rendererStyle());
+    // The overlay follows everything it is drawn over.
+    m_dirty |= OverlayDirty;
+    // Bursts of provider notifications collapse into one polish and one
+    // render per frame.
+    if (m_scheduler) {
+        m_scheduler->schedule(this);
+        return;
+    }
+    if (flags & (GeometryDirty | DataDirty | AppendDirty))
+        polish();
     update();
 }
 
+void GraphItem::setDecimationStats(int inputCount, int outputCount)
+{
+    if (m_decimationInputCount == inputCount && m_decimationOutputCount == outputCount)
+        return;
+    m_decimationInputCount = inputCount;
+    m_decimationOutputCount = outputCount;
+    GRAPH_TRACE_COUNTER(TraceRender, "decimationOutputCount", outputCount);
+    emit decimationStatsChanged();
+}
+
+void GraphItem::updateChromeNodes(GraphNode *node)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    node->setBackground(boundingRect(), m_backgroundColor);
+    node->setAxes(m_renderer.plotArea(), m_textColor);
+
+    updateLabel(node, GraphNode::TitleLabel, m_title, m_titleFont, m_textColor, m_renderer.titleOrigin());
+    updateLabel(node, GraphNode::XAxisLabel, m_xAxisLabel, m_labelFont, m_textColor, m_renderer.xAxisLabelOrigin());
+    updateLabel(node, GraphNode::YAxisLabel, m_yAxisLabel, m_labelFont, m_textColor,
+                m_renderer.yAxisLabelOrigin(), true);
+}
+
+void GraphItem::updateDataNodes(GraphNode *node, int dirtyFrom)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    const QRectF plotArea = m_renderer.plotArea();
+    node->setDataClip(m_renderer.isZoomed() ? plotArea : boundingRect());
+    node->setFill(m_renderer.fillEnabled() ? m_pixelPoints : QVector<QPointF>(), dirtyFrom, plotArea, m_lineColor);
+    node->setCurve(m_pixelPoints, dirtyFrom, m_lineColor, GraphRenderer::LINE_WIDTH, m_renderer.antialiasing());
+
+    const double maxPower = peakPower();
+    QVector<QPointF> markers;
+    QPointF pixel;
+    if (m_renderer.endPointPixel(m_snapshot, maxPower, false, &pixel))
+        markers.append(pixel);
+    if (m_renderer.endPointPixel(m_snapshot, maxPower, true, &pixel))
+        markers.append(pixel);
+    node->setMarkers(markers, GraphRenderer::POINT_RADIUS, m_lineColor);
+
+    GraphRenderer::ValueText texts[GraphRenderer::ValueLabelCount];
+    m_renderer.valueTexts(m_snapshot, maxPower, texts);
+    const GraphNode::Label labels[GraphRenderer::ValueLabelCount] = {
+        GraphNode::FirstSocLabel, GraphNode::LastSocLabel, GraphNode::MaxPowerLabel,
+        GraphNode::FirstPowerLabel, GraphNode::LastPowerLabel
+    };
+    for (int value = 0; value < GraphRenderer::ValueLabelCount; ++value) {
+        const GraphRenderer::ValueText &text = texts[value];
+        if (!text.visible) {
+            node->hideLabel(labels[value]);
+            continue;
+        }
+        const bool powerLabel = value == GraphRenderer::FirstPowerValue || value == GraphRenderer::LastPowerValue;
+        updateLabel(node, labels[value], text.text, powerLabel ? m_labelFont : m_axisFont,
+                    powerLabel ? m_lineColor : m_textColor, text.origin);
+    }
+}
+
+void GraphItem::updateOverlayNodes(GraphNode *node)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    const QRectF plotArea = m_renderer.plotArea();
+    const QPointF pixel = m_renderer.mapDataToPixel(m_hoverPoint.getSocPercentage(), m_hoverPoint.getPower(),
+                                                    peakPower());
+    if (m_hoverIndex < 0 || pixel.x() < plotArea.left() || pixel.x() > plotArea.right()) {
+        node->hideCrosshair();
+        node->hideLabel(GraphNode::HoverLabel);
+        return;
+    }
+
+    node->setCrosshair(plotArea, pixel, m_textColor);
+
+    // Above and right of the point, flipped left near the right edge.
+    const QString text = GraphRenderer::formatHoverValue(m_hoverPoint);
+    const int width = m_renderer.textWidth(GraphRenderer::LabelText, text);
+    const qreal x = pixel.x() + 8 + width > plotArea.right() ? pixel.x() - 8 - width : pixel.x() + 8;
+    updateLabel(node, GraphNode::HoverLabel, text, m_labelFont, m_textColor, QPointF(x, pixel.y() - 8));
+}
+
+void GraphItem::updateEnvelopePixels()
+{
+    if (m_envelope && !m_envelope->envelope().isEmpty()) {
+        m_renderer.mapEnvelope(m_envelope->envelope(), peakPower(), m_envelopeLower, m_envelopeMedian,
+                               m_envelopeUpper);
+    } else {
+        m_envelopeLower.resize(0);
+        m_envelopeMedian.resize(0);
+        m_envelopeUpper.resize(0);
+    }
+}
+
+void GraphItem::updateSoftwareLayers(GraphNode *node, int dirty)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    const QRectF rect = boundingRect();
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+
+    if (dirty & (GeometryDirty | ThemeDirty | LabelsDirty)) {
+        node->setLayerImage(GraphNode::ChromeLayer, m_renderer.chromeLayer(dpr), rect);
+    }
+
+    if (!(dirty & (GeometryDirty | ThemeDirty | DataDirty | AppendDirty | EnvelopeDirty)))
+        return;
+
+    const bool full = (dirty & (GeometryDirty | ThemeDirty | DataDirty | EnvelopeDirty)) || m_pixelDirtyFrom == 0
+                      || m_dataLayer.isNull() || m_dataLayer.devicePixelRatio() != dpr;
+    const QRectF lastPointRect = m_renderer.lastPointRect(m_snapshot, peakPower());
+
+    if (full) {
+        // Same size and ratio: clear and repaint in place instead of
+        // allocating a new layer.
+        if (m_dataLayer.isNull() || m_dataLayer.devicePixelRatio() != dpr
+            || m_dataLayer.size() != (size() * dpr).toSize())
+            m_dataLayer = createLayerImage();
+        else
+            m_dataLayer.fill(Qt::transparent);
+        QPainter painter(&m_dataLayer);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        m_renderer.drawEnvelope(&painter, m_envelopeLower, m_envelopeMedian, m_envelopeUpper);
+        m_renderer.drawData(&painter, m_snapshot, peakPower(), m_pixelPoints);
+        painter.end();
+        node->setLayerImage(GraphNode::DataLayer, m_dataLayer, rect);
+    } else {
+        // Appends under an unchanged Y scale only touch the new tail of the
+        // curve and the last point's marker and labels, old and new. The
+        // region is widened to whole pixels before it is cleared.
+        // Replaced points keep their SOC range but not their power, so the
+        // region spans the plot's full height.
+        QRectF curveRect = m_renderer.curveRect(m_pixelPoints, m_pixelDirtyFrom);
+        if (!curveRect.isNull())
+            curveRect.setTop(m_renderer.plotArea().top() - GraphRenderer::LINE_WIDTH);
+        const QRectF region = QRectF((curveRect | m_lastPointRect | lastPointRect).toAlignedRect()) & rect;
+        if (!region.isEmpty()) {
+            // Restart the curve far enough left of the region that strokes
+            // and fill crossing its edge are redrawn too.
+            const qreal left = region.left() - GraphRenderer::LINE_WIDTH;
+            int firstPixel = qMin(m_pixelDirtyFrom, m_pixelPoints.size()) - 1;
+            while (firstPixel > 0 && m_pixelPoints.at(firstPixel).x() >= left)
+                --firstPixel;
+
+            QPainter painter(&m_dataLayer);
+            painter.setClipRect(region);
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.fillRect(region, Qt::transparent);
+            painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+            painter.setRenderHint(QPainter::Antialiasing, true);
+            m_renderer.drawEnvelope(&painter, m_envelopeLower, m_envelopeMedian, m_envelopeUpper);
+            m_renderer.drawData(&painter, m_snapshot, peakPower(), m_pixelPoints, qMax(0, firstPixel));
+            painter.end();
+            node->updateLayerImage(GraphNode::DataLayer, m_dataLayer, rect, region);
+        }
+    }
+    m_lastPointRect = lastPointRect;
+}
+
+void GraphItem::updateLabel(GraphNode *node, GraphNode::Label label, const QString &text,
+                            const QFont &font, const QColor &color, const QPointF &origin,
+                            bool rotated)
+{
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    const QString key = QStringLiteral("label|%1|%2|%3|%4|%5")
+                            .arg(text, color.name(QColor::HexArgb), font.key())
+                            .arg(dpr)
+                            .arg(int(rotated));
+
+    if (!node->hasLabel(label, key)) {
+        QImage image;
+        QRectF bounds;
+        if (!text.isEmpty()) {
+            const QRect textRect = QFontMetrics(font).boundingRect(text);
+            // Rotating by -90 degrees maps (x, y) to (y, -x) around the baseline origin.
+            bounds = rotated ? QRectF(textRect.top(), -textRect.right() - 1, textRect.height(), textRect.width())
+                             : QRectF(textRect);
+            // Graphs of the same window showing the same label share the image.
+            image = m_renderer.cache()->image(key);
+        }
+        if (!text.isEmpty() && image.isNull()) {
+            image = QImage((bounds.size() * dpr).toSize(), QImage::Format_ARGB32_Premultiplied);
+            image.setDevicePixelRatio(dpr);
+            image.fill(Qt::transparent);
+
+            QPainter painter(&image);
+            painter.setRenderHint(QPainter::TextAntialiasing, true);
+            painter.setPen(color);
+            painter.setFont(font);
+            painter.translate(-bounds.left(), -bounds.top());
+            if (rotated)
+                painter.rotate(-90);
+            painter.drawText(0, 0, text);
+            painter.end();
+            m_renderer.cache()->insertImage(key, image);
+        }
+        node->setLabel(label, key, image, bounds);
+    }
+
+    node->moveLabel(label, origin);
+}
+
+QImage GraphItem::createLayerImage() const
+{
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    QImage image((size() * dpr).toSize(), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(dpr);
+    image.fill(Qt::transparent);
+    return image;
+}
+
 DataProvider *GraphItem::getGraphPointsProvider() const
 {
     return m_graphPointsProvider;
@@ -40,7 +534,7 @@ DataProvider *GraphItem::getGraphPointsProvider() const
 
 void GraphItem::setGraphPointsProvider(DataProvider *newGraphPointsProvider)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_graphPointsProvider == newGraphPointsProvider)
         return;
 
@@ -51,14 +545,24 @@ void GraphItem::setGraphPointsProvider(DataProvider *newGraphPointsProvider)
     m_graphPointsProvider = newGraphPointsProvider;
 
     if (m_graphPointsProvider) {
-        connect(m_graphPointsProvider, &DataProvider::dataPointsChanged,
+        connect(m_graphPointsProvider, &DataProvider::pointsAppended,
+                this, &GraphItem::onPointsAppended);
+        // Under the same Y scale replaced points are remapped from the
+        // first of them on, like appended ones; a new peak remaps anyway.
+        connect(m_graphPointsProvider, &DataProvider::pointsReplaced,
+                this, &GraphItem::onPointsAppended);
+        connect(m_graphPointsProvider, &DataProvider::pointsReset,
+                this, &GraphItem::onDataChanged);
+        connect(m_graphPointsProvider, &DataProvider::pointsTrimmed,
                 this, &GraphItem::onDataChanged);
         connect(m_graphPointsProvider, &DataProvider::peakPowerChanged,
                 this, &GraphItem::onDataChanged);
+        connect(m_graphPointsProvider, &QObject::destroyed,
+                this, &GraphItem::onProviderDestroyed);
     }
 
     emit graphPointsProviderChanged();
-    update();
+    markDirty(AllDirty);
 }
 
 QColor GraphItem::getBackgroundColor() const
@@ -68,12 +572,11 @@ QColor GraphItem::getBackgroundColor() const
 
 void GraphItem::setBackgroundColor(const QColor &newBackgroundColor)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_backgroundColor == newBackgroundColor)
         return;
     m_backgroundColor = newBackgroundColor;
     emit backgroundColorChanged();
-    update();
 }
 
 QColor GraphItem::getTextColor() const
@@ -83,12 +586,11 @@ QColor GraphItem::getTextColor() const
 
 void GraphItem::setTextColor(const QColor &newTextColor)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_textColor == newTextColor)
         return;
     m_textColor = newTextColor;
     emit textColorChanged();
-    update();
 }
 
 QColor GraphItem::getLineColor() const
@@ -98,12 +600,11 @@ QColor GraphItem::getLineColor() const
 
 void GraphItem::setLineColor(const QColor &newLineColor)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_lineColor == newLineColor)
         return;
     m_lineColor = newLineColor;
     emit lineColorChanged();
-    update();
 }
 
 QString GraphItem::getTitle() const
@@ -113,12 +614,11 @@ QString GraphItem::getTitle() const
 
 void GraphItem::setTitle(const QString &newTitle)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_title == newTitle)
         return;
     m_title = newTitle;
     emit titleChanged();
-    update();
 }
 
 QString GraphItem::getXAxisLabel() const
@@ -128,12 +628,11 @@ QString GraphItem::getXAxisLabel() const
 
 void GraphItem::setXAxisLabel(const QString &newXAxisLabel)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_xAxisLabel == newXAxisLabel)
         return;
     m_xAxisLabel = newXAxisLabel;
     emit xAxisLabelChanged();
-    update();
 }
 
 QString GraphItem::getYAxisLabel() const
@@ -143,235 +642,330 @@ QString GraphItem::getYAxisLabel() const
 
 void GraphItem::setYAxisLabel(const QString &newYAxisLabel)
 {
-    qDebug() << Q_FUNC_INFO;
+    GRAPH_TRACE_FUNCTION(TraceUi);
     if (m_yAxisLabel == newYAxisLabel)
         return;
     m_yAxisLabel = newYAxisLabel;
     emit yAxisLabelChanged();
-    update();
 }
 
-void GraphItem::initializeDefaults()
+bool GraphItem::isDecimationEnabled() const
 {
-    m_backgroundColor = QColor("#1e1e1e");
-    m_textColor = QColor("#ffffff");
-    m_lineColor = QColor("#00AEEF");
-
-    m_title = "Peak Power Delivered";
-    m_xAxisLabel = "SOC (%)";
-    m_yAxisLabel = "Power (kW)";
-
-    m_titleFont = QFont("Arial", 24, QFont::Bold);
-    m_axisFont = QFont("Arial", 12);
-    m_labelFont = QFont("Arial", 14);
+    return m_decimationEnabled;
 }
 
-QRectF GraphItem::getPlotArea() const
+void GraphItem::setDecimationEnabled(bool newDecimationEnabled)
 {
-    return QRectF(LEFT_MARGIN, TOP_MARGIN,
-                  width() - LEFT_MARGIN - RIGHT_MARGIN,
-                  height() - TOP_MARGIN - BOTTOM_MARGIN);
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    if (m_decimationEnabled == newDecimationEnabled)
+        return;
+    m_decimationEnabled = newDecimationEnabled;
+    m_mappedGeneration = InvalidGeneration;
+    emit decimationEnabledChanged();
+    markDirty(DataDirty);
 }
 
-QPointF GraphItem::mapDataToPixel(double soc, double power) const
+int GraphItem::getDecimationInputCount() const
 {
-    QRectF plotArea = getPlotArea();
-
-    if (!m_graphPointsProvider) {
-        return QPointF(0, 0);
-    }
-
-    double minSoc = 0.0;
-    double maxSoc = 100.0;
-    double minPower = 0.0;
-    double maxPower = qMax(300.0, m_graphPointsProvider->getPeakPower() * 1.2);
-
-    double x = plotArea.left() + ((soc - minSoc) / (maxSoc - minSoc)) * plotArea.width();
-    double y = plotArea.bottom() - ((power - minPower) / (maxPower - minPower)) * plotArea.height();
-
-    return QPointF(x, y);
+    return m_decimationInputCount;
 }
 
-void GraphItem::drawBackground(QPainter *painter)
+int GraphItem::getDecimationOutputCount() const
 {
-    painter->fillRect(0, 0, width(), height(), m_backgroundColor);
+    return m_decimationOutputCount;
 }
 
-void GraphItem::drawTitle(QPainter *painter)
+double GraphItem::getViewMinSoc() const
 {
-    painter->setPen(m_textColor);
-    painter->setFont(m_titleFont);
+    return m_renderer.minSoc();
+}
 
-    QFontMetrics fm(m_titleFont);
-    QRect titleRect = fm.boundingRect(m_title);
-    QPointF titlePos((width() - titleRect.width()) / 2, TOP_MARGIN / 2);
-    painter->drawText(titlePos, m_title);
+void GraphItem::setViewMinSoc(double newViewMinSoc)
+{
+    setViewport(newViewMinSoc, m_renderer.maxSoc());
 }
 
-void GraphItem::drawAxes(QPainter *painter)
+double GraphItem::getViewMaxSoc() const
 {
-    QRectF plotArea = getPlotArea();
-    painter->setPen(QPen(m_textColor, 1));
+    return m_renderer.maxSoc();
+}
 
-    painter->drawLine(plotArea.bottomLeft(), plotArea.bottomRight());
-    painter->drawLine(plotArea.topLeft(), plotArea.bottomLeft());
+void GraphItem::setViewMaxSoc(double newViewMaxSoc)
+{
+    setViewport(m_renderer.minSoc(), newViewMaxSoc);
 }
 
-void GraphItem::drawAxisLabels(QPainter *painter)
+bool GraphItem::isZoomed() const
 {
-    QRectF plotArea = getPlotArea();
-    painter->setPen(m_textColor);
-    painter->setFont(m_labelFont);
+    return m_renderer.isZoomed();
+}
 
-    painter->save();
-    painter->translate(LEFT_MARGIN / 2, plotArea.center().y());
-    painter->rotate(-90);
-    painter->drawText(0, 0, m_yAxisLabel);
-    painter->restore();
+void GraphItem::setViewport(double minSoc, double maxSoc)
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    // Keep the span, then slide the range back inside 0-100 %.
+    const double span = qBound(GraphRenderer::MinSocSpan, maxSoc - minSoc,
+                               GraphRenderer::FullMaxSoc - GraphRenderer::FullMinSoc);
+    minSoc = qBound(GraphRenderer::FullMinSoc, minSoc, GraphRenderer::FullMaxSoc - span);
+    maxSoc = minSoc + span;
+    if (minSoc == m_renderer.minSoc() && maxSoc == m_renderer.maxSoc())
+        return;
 
-    QFontMetrics fm(m_labelFont);
-    QRect xLabelRect = fm.boundingRect(m_xAxisLabel);
-    QPointF xLabelPos(plotArea.center().x() - xLabelRect.width() / 2, height() - BOTTOM_MARGIN / 2);
-    painter->drawText(xLabelPos, m_xAxisLabel);
+    m_renderer.setSocRange(minSoc, maxSoc);
+    m_mappedGeneration = InvalidGeneration;
+    emit viewportChanged();
+    markDirty(DataDirty);
 }
 
-void GraphItem::drawAxisValues(QPainter *painter)
+void GraphItem::zoomAt(qreal factor, qreal x)
 {
-    painter->setFont(m_axisFont);
-    painter->setPen(m_textColor);
-    QRectF plotArea = getPlotArea();
+    if (factor <= 0)
+        return;
+    const QRectF plotArea = m_renderer.plotArea();
+    if (plotArea.width() <= 0)
+        return;
 
-    if (!m_graphPointsProvider) return;
+    const double minSoc = m_renderer.minSoc();
+    const double span = m_renderer.maxSoc() - minSoc;
+    const double anchor = minSoc + qBound(0.0, (x - plotArea.left()) / plotArea.width(), 1.0) * span;
+    const double newSpan = span / factor;
+    // The SOC under x stays under x.
+    const double newMinSoc = anchor - (anchor - minSoc) * newSpan / span;
+    setViewport(newMinSoc, newMinSoc + newSpan);
+}
 
-    QVector<DataPoint> dataPoints = m_graphPointsProvider->getDataPoints();
-    if (dataPoints.isEmpty()) return;
+void GraphItem::panBy(qreal dx)
+{
+    const QRectF plotArea = m_renderer.plotArea();
+    if (plotArea.width() <= 0)
+        return;
+    const double shift = -dx / plotArea.width() * (m_renderer.maxSoc() - m_renderer.minSoc());
+    setViewport(m_renderer.minSoc() + shift, m_renderer.maxSoc() + shift);
+}
 
-    DataPoint firstPoint = dataPoints.first();
-    DataPoint lastPoint = dataPoints.last();
+void GraphItem::resetViewport()
+{
+    setViewport(GraphRenderer::FullMinSoc, GraphRenderer::FullMaxSoc);
+}
 
-    QPointF firstPixel = mapDataToPixel(firstPoint.getSocPercentage(), 0);
-    QPointF lastPixel = mapDataToPixel(lastPoint.getSocPercentage(), 0);
+void GraphItem::wheelEvent(QWheelEvent *event)
+{
+    // One notch (120 units) zooms by 2^(1/4).
+    const int delta = event->angleDelta().y();
+    if (delta == 0) {
+        event->ignore();
+        return;
+    }
+    zoomAt(qPow(2.0, delta / 480.0), event->position().x());
+    event->accept();
+}
 
-    QString firstText = QString::number(qRound(firstPoint.getSocPercentage())) + "%";
-    QString lastText = QString::number(qRound(lastPoint.getSocPercentage())) + "%";
+void GraphItem::mousePressEvent(QMouseEvent *event)
+{
+    // Touch input arrives as synthesized mouse events; a tap shows the
+    // crosshair just like hovering does.
+    m_dragX = event->position().x();
+    m_dragging = true;
+    setHoverPosition(event->position().x());
+    event->accept();
+}
 
-    QFontMetrics fm(m_axisFont);
-    QRect firstTextRect = fm.boundingRect(firstText);
-    QRect lastTextRect = fm.boundingRect(lastText);
+void GraphItem::mouseMoveEvent(QMouseEvent *event)
+{
+    if (!m_dragging)
+        return;
+    panBy(event->position().x() - m_dragX);
+    m_dragX = event->position().x();
+    setHoverPosition(event->position().x());
+    event->accept();
+}
 
-    painter->drawText(QPointF(firstPixel.x() - firstTextRect.width() / 2, plotArea.bottom() + 20), firstText);
-    painter->drawText(QPointF(lastPixel.x() - lastTextRect.width() / 2, plotArea.bottom() + 20), lastText);
+void GraphItem::mouseReleaseEvent(QMouseEvent *event)
+{
+    m_dragging = false;
+    event->accept();
+}
 
-    double maxPower = m_graphPointsProvider->getPeakPower();
-    QPointF maxPowerPixel = mapDataToPixel(0, maxPower);
-    QString maxPowerText = QString::number(qRound(maxPower)) + "kW";
-    QRect maxPowerTextRect = fm.boundingRect(maxPowerText);
-    painter->drawText(QPointF(plotArea.left() - maxPowerTextRect.width() - 10, maxPowerPixel.y() + 5), maxPowerText);
+void GraphItem::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    resetViewport();
+    event->accept();
 }
 
-void GraphItem::drawGraph(QPainter *painter)
+void GraphItem::itemChange(ItemChange change, const ItemChangeData &value)
 {
-    if (!m_graphPointsProvider || m_graphPointsProvider->getDataPoints().isEmpty()) {
+    QQuickItem::itemChange(change, value);
+    if (change != ItemSceneChange)
+        return;
+
+    FrameScheduler *scheduler = FrameScheduler::forWindow(value.window);
+    if (m_scheduler == scheduler)
         return;
+    if (m_scheduler) {
+        disconnect(m_scheduler, nullptr, this, nullptr);
+        m_scheduler->unschedule(this);
     }
+    m_scheduler = scheduler;
+    if (m_scheduler)
+        connect(m_scheduler, &FrameScheduler::qualityChanged, this, &GraphItem::onQualityChanged);
+    m_renderer.setCache(m_scheduler ? m_scheduler->renderCache() : QSharedPointer<RenderCache>());
+    emit frameSchedulerChanged();
+    onQualityChanged();
+}
 
-    QVector<DataPoint> dataPoints = m_graphPointsProvider->getDataPoints();
-    QVector<QPointF> pixelPoints;
+FrameScheduler *GraphItem::getFrameScheduler() const
+{
+    return m_scheduler;
+}
 
-    for (const DataPoint &dp : dataPoints) {
-        QPointF pixelPoint = mapDataToPixel(dp.getSocPercentage(), dp.getPower());
-        pixelPoints.append(pixelPoint);
-    }
+bool GraphItem::isThreadedGeometry() const
+{
+    return m_threadedGeometry;
+}
 
-    if (pixelPoints.size() < 2) {
+void GraphItem::setThreadedGeometry(bool newThreadedGeometry)
+{
+    if (m_threadedGeometry == newThreadedGeometry)
         return;
-    }
+    m_threadedGeometry = newThreadedGeometry;
+    emit threadedGeometryChanged();
+}
 
-    QPainterPath path;
-    path.moveTo(pixelPoints.first());
+FleetEnvelope *GraphItem::getEnvelope() const
+{
+    return m_envelope;
+}
 
-    for (int i = 1; i < pixelPoints.size(); ++i) {
-        path.lineTo(pixelPoints[i]);
+void GraphItem::setEnvelope(FleetEnvelope *newEnvelope)
+{
+    GRAPH_TRACE_FUNCTION(TraceUi);
+    if (m_envelope == newEnvelope)
+        return;
+    if (m_envelope)
+        disconnect(m_envelope, nullptr, this, nullptr);
+    m_envelope = newEnvelope;
+    if (m_envelope) {
+        connect(m_envelope, &FleetEnvelope::envelopeChanged, this, &GraphItem::onEnvelopeChanged);
+        connect(m_envelope, &QObject::destroyed, this, &GraphItem::onEnvelopeChanged);
     }
+    emit envelopeChanged();
+    onEnvelopeChanged();
+}
 
-    QRectF plotArea = getPlotArea();
+void GraphItem::hoverMoveEvent(QHoverEvent *event)
+{
+    setHoverPosition(event->position().x());
+}
 
-    QPainterPath fillPath = path;
-    fillPath.lineTo(pixelPoints.last().x(), plotArea.bottom());
-    fillPath.lineTo(pixelPoints.first().x(), plotArea.bottom());
-    fillPath.closeSubpath();
+void GraphItem::hoverLeaveEvent(QHoverEvent *event)
+{
+    Q_UNUSED(event)
+    m_hovering = false;
+    updateHoverIndex();
+}
 
-    QLinearGradient gradient(0, plotArea.top(), 0, plotArea.bottom());
-    gradient.setColorAt(0.0, m_lineColor.lighter(35));
-    gradient.setColorAt(0.5, m_lineColor.lighter(25));
-    gradient.setColorAt(0.9, QColor(m_lineColor.red(),
-                                    m_lineColor.green(),
-                                    m_lineColor.blue(),
-                                    0));
-    painter->fillPath(fillPath, gradient);
+int GraphItem::getHoverIndex() const
+{
+    return m_hoverIndex;
+}
 
-    painter->setRenderHint(QPainter::Antialiasing, true);
-    painter->setPen(QPen(m_lineColor, LINE_WIDTH));
-    painter->drawPath(path);
+double GraphItem::getHoverSoc() const
+{
+    return m_hoverIndex < 0 ? 0.0 : m_hoverPoint.getSocPercentage();
 }
 
+double GraphItem::getHoverPower() const
+{
+    return m_hoverIndex < 0 ? 0.0 : m_hoverPoint.getPower();
+}
 
+void GraphItem::setHoverPosition(qreal x)
+{
+    m_hoverX = x;
+    m_hovering = true;
+    updateHoverIndex();
+}
 
-void GraphItem::drawEndPoints(QPainter *painter)
+void GraphItem::updateHoverIndex()
 {
-    if (!m_graphPointsProvider || m_graphPointsProvider->getDataPoints().isEmpty()) {
+    // Inverts the X mapping and searches the SOC-sorted snapshot, so the
+    // cost does not depend on the session length.
+    int index = -1;
+    const QRectF plotArea = m_renderer.plotArea();
+    if (m_hovering && m_hoverX >= plotArea.left() && m_hoverX <= plotArea.right())
+        index = m_snapshot.nearestSoc(m_renderer.socAt(m_hoverX));
+    const DataPoint point = index < 0 ? DataPoint() : m_snapshot.at(index);
+    if (index == m_hoverIndex && point == m_hoverPoint)
         return;
-    }
-
-    QVector<DataPoint> dataPoints = m_graphPointsProvider->getDataPoints();
-    painter->setPen(QPen(m_lineColor, 2));
-    painter->setBrush(m_lineColor);
-
-    DataPoint firstPoint = dataPoints.first();
-    DataPoint lastPoint = dataPoints.last();
 
-    QPointF firstPixel = mapDataToPixel(firstPoint.getSocPercentage(), firstPoint.getPower());
-    QPointF lastPixel = mapDataToPixel(lastPoint.getSocPercentage(), lastPoint.getPower());
-
-    painter->drawEllipse(firstPixel, POINT_RADIUS, POINT_RADIUS);
-    painter->drawEllipse(lastPixel, POINT_RADIUS, POINT_RADIUS);
-
-    painter->setPen(m_lineColor);
-    painter->setFont(m_labelFont);
+    m_hoverIndex = index;
+    m_hoverPoint = point;
+    emit hoverChanged();
+    markDirty(OverlayDirty);
+}
 
-    QString firstPowerText = formatPowerValue(firstPoint.getPower());
-    QString lastPowerText = formatPowerValue(lastPoint.getPower());
+void GraphItem::initializeDefaults()
+{
+    const GraphRenderer::Style defaults;
+    m_backgroundColor = defaults.backgroundColor;
+    m_textColor = defaults.textColor;
+    m_lineColor = defaults.lineColor;
 
-    QFontMetrics fm(m_labelFont);
-    QRect firstTextRect = fm.boundingRect(firstPowerText);
-    QRect lastTextRect = fm.boundingRect(lastPowerText);
+    m_title = defaults.title;
+    m_xAxisLabel = defaults.xAxisLabel;
+    m_yAxisLabel = defaults.yAxisLabel;
 
-    QPointF firstTextPos(firstPixel.x() - firstTextRect.width() / 2, firstPixel.y() - 15);
-    QPointF lastTextPos(lastPixel.x() - lastTextRect.width() / 2, lastPixel.y() - 15);
+    m_titleFont = defaults.titleFont;
+    m_axisFont = defaults.axisFont;
+    m_labelFont = defaults.labelFont;
 
-    painter->drawText(firstTextPos, firstPowerText);
-    painter->drawText(lastTextPos, lastPowerText);
+    m_renderer.setStyle(rendererStyle());
 }
 
-void GraphItem::drawArrows(QPainter *painter)
+GraphRenderer::Style GraphItem::rendererStyle() const
 {
-    QRectF plotArea = getPlotArea();
-    painter->setPen(QPen(m_textColor, 1));
+    GraphRenderer::Style style;
+    style.backgroundColor = m_backgroundColor;
+    style.textColor = m_textColor;
+    style.lineColor = m_lineColor;
+    style.title = m_title;
+    style.xAxisLabel = m_xAxisLabel;
+    style.yAxisLabel = m_yAxisLabel;
+    style.titleFont = m_titleFont;
+    style.axisFont = m_axisFont;
+    style.labelFont = m_labelFont;
+    return style;
+}
 
-    QPointF xArrowEnd = plotArea.bottomRight();
-    QPointF xArrow1(xArrowEnd.x() - 10, xArrowEnd.y() - 5);
-    QPointF xArrow2(xArrowEnd.x() - 10, xArrowEnd.y() + 5);
-    painter->drawLine(xArrowEnd, xArrow1);
-    painter->drawLine(xArrowEnd, xArrow2);
+double GraphItem::peakPower() const
+{
+    // What the current pixels were mapped with, which can trail the
+    // provider by a frame.
+    return m_mappedPeakPower;
+}
 
-    QPointF yArrowEnd = plotArea.topLeft();
-    QPointF yArrow1(yArrowEnd.x() + 5, yArrowEnd.y() + 10);
-    QPointF yArrow2(yArrowEnd.x() - 5, yArrowEnd.y() + 10);
-    painter->drawLine(yArrowEnd, yArrow1);
-    painter->drawLine(yArrowEnd, yArrow2);
+PixelTransform GraphItem::pixelTransform() const
+{
+    return m_renderer.pixelTransform(peakPower());
 }
 
-QString GraphItem::formatPowerValue(double power) const
+DataProvider::Resolution GraphItem::historyResolution(const DataSnapshot &raw) const
 {
-    return QString("%1kW").arg(power, 0, 'f', 0);
+    // The 1 min tier once a pixel column spans a minute of the visible part
+    // of the session, the 1 s tier otherwise. SOC rises steadily while
+    // charging, so the visible share of the SOC range is the visible share
+    // of the time range.
+    const DataSnapshot coarse = m_graphPointsProvider->historySnapshot(DataProvider::MinuteResolution);
+    if (coarse.isEmpty() || raw.isEmpty())
+        return DataProvider::SecondResolution;
+
+    const DataPoint first = coarse.first();
+    const DataPoint last = raw.last();
+    const double socSpan = last.getSocPercentage() - first.getSocPercentage();
+    const double visible = socSpan > 0 ? qMin(1.0, (m_renderer.maxSoc() - m_renderer.minSoc()) / socSpan) : 1.0;
+    const qreal dpr = window() ? window()->effectiveDevicePixelRatio() : 1.0;
+    const double columns = qMax(1.0, m_renderer.plotArea().width() * dpr);
+    const double msPerColumn = (last.getTimestamp() - first.getTimestamp()) * visible / columns;
+    const qint64 minute = m_graphPointsProvider->tier(DataProvider::MinuteResolution).interval();
+    return msPerColumn >= minute ? DataProvider::MinuteResolution : DataProvider::SecondResolution;
 }
@@ -1,14 +1,25 @@
 #ifndef GRAPHITEM_H
 #define GRAPHITEM_H
 
-#include <QQuickPaintedItem>
+#include <QQuickItem>
 #include <QColor>
 #include <QString>
 #include <QFont>
 #include <QPainter>
+#include <QImage>
+#include <QVector>
+#include <QPointF>
 #include "DataProvider.h"
-
-class GraphItem : public QQuickPaintedItem
+#include "FleetEnvelope.h"
+#include "GraphNode.h"
+#include "GraphRenderer.h"
+#include "Decimator.h"
+#include "FrameScheduler.h"
+#include "GeometryWorker.h"
+#include "PointKernels.h"
+#include <QPointer>
+
+class GraphItem : public QQuickItem
 {
     Q_OBJECT
 
@@ -19,12 +30,23 @@ class GraphItem : public QQuickPaintedItem
     Q_PROPERTY(QString title READ getTitle WRITE setTitle NOTIFY titleChanged FINAL)
     Q_PROPERTY(QString xAxisLabel READ getXAxisLabel WRITE setXAxisLabel NOTIFY xAxisLabelChanged FINAL)
     Q_PROPERTY(QString yAxisLabel READ getYAxisLabel WRITE setYAxisLabel NOTIFY yAxisLabelChanged FINAL)
+    Q_PROPERTY(bool decimationEnabled READ isDecimationEnabled WRITE setDecimationEnabled NOTIFY decimationEnabledChanged FINAL)
+    Q_PROPERTY(int decimationInputCount READ getDecimationInputCount NOTIFY decimationStatsChanged FINAL)
+    Q_PROPERTY(int decimationOutputCount READ getDecimationOutputCount NOTIFY decimationStatsChanged FINAL)
+    Q_PROPERTY(double viewMinSoc READ getViewMinSoc WRITE setViewMinSoc NOTIFY viewportChanged FINAL)
+    Q_PROPERTY(double viewMaxSoc READ getViewMaxSoc WRITE setViewMaxSoc NOTIFY viewportChanged FINAL)
+    Q_PROPERTY(bool zoomed READ isZoomed NOTIFY viewportChanged FINAL)
+    Q_PROPERTY(int hoverIndex READ getHoverIndex NOTIFY hoverChanged FINAL)
+    Q_PROPERTY(double hoverSoc READ getHoverSoc NOTIFY hoverChanged FINAL)
+    Q_PROPERTY(double hoverPower READ getHoverPower NOTIFY hoverChanged FINAL)
+    Q_PROPERTY(FrameScheduler *frameScheduler READ getFrameScheduler NOTIFY frameSchedulerChanged FINAL)
+    Q_PROPERTY(bool threadedGeometry READ isThreadedGeometry WRITE setThreadedGeometry NOTIFY threadedGeometryChanged FINAL)
+    Q_PROPERTY(FleetEnvelope *envelope READ getEnvelope WRITE setEnvelope NOTIFY envelopeChanged FINAL)
 
 public:
     GraphItem();
-    ~GraphItem() = default;
+    ~GraphItem();
 
-    void paint(QPainter *painter) override;
 
     DataProvider *getGraphPointsProvider() const;
     void setGraphPointsProvider(DataProvider *newGraphPointsProvider);
@@ -47,6 +69,48 @@ public:
     QString getYAxisLabel() const;
     void setYAxisLabel(const QString &newYAxisLabel);
 
+    bool isDecimationEnabled() const;
+    void setDecimationEnabled(bool newDecimationEnabled);
+
+    int getDecimationInputCount() const;
+    int getDecimationOutputCount() const;
+
+    double getViewMinSoc() const;
+    void setViewMinSoc(double newViewMinSoc);
+    double getViewMaxSoc() const;
+    void setViewMaxSoc(double newViewMaxSoc);
+    bool isZoomed() const;
+
+    // Sample under the hover crosshair, -1 (and 0) while there is none.
+    int getHoverIndex() const;
+    double getHoverSoc() const;
+    double getHoverPower() const;
+
+    // Frame pacing and quality level of the window the item is in.
+    FrameScheduler *getFrameScheduler() const;
+
+    // Maps and decimates on the shared GeometryWorker pool instead of in
+    // updatePolish(). The curve then trails the data by a frame, which pays
+    // off once a window shows many graphs.
+    bool isThreadedGeometry() const;
+    void setThreadedGeometry(bool newThreadedGeometry);
+
+    // Fleet percentile band drawn behind the curve. Its P90 counts towards
+    // the power axis scale.
+    FleetEnvelope *getEnvelope() const;
+    void setEnvelope(FleetEnvelope *newEnvelope);
+
+    // Viewport control for wheel, drag and pinch input. factor > 1 zooms in
+    // around the SOC under item coordinate x; dx pans by item pixels.
+    Q_INVOKABLE void setViewport(double minSoc, double maxSoc);
+    Q_INVOKABLE void zoomAt(qreal factor, qreal x);
+    Q_INVOKABLE void panBy(qreal dx);
+    Q_INVOKABLE void resetViewport();
+
+    // Renders the whole graph with QPainter, e.g. into a QImage for export
+    // or offscreen benchmarks. Works without a window.
+    void paint(QPainter *painter);
+
 signals:
     void graphPointsProviderChanged();
     void backgroundColorChanged();
@@ -55,26 +119,75 @@ signals:
     void titleChanged();
     void xAxisLabelChanged();
     void yAxisLabelChanged();
+    void decimationEnabledChanged();
+    void decimationStatsChanged();
+    void viewportChanged();
+    void hoverChanged();
+    void frameSchedulerChanged();
+    void threadedGeometryChanged();
+    void envelopeChanged();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void updatePolish() override;
+    void geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void hoverMoveEvent(QHoverEvent *event) override;
+    void hoverLeaveEvent(QHoverEvent *event) override;
+    void itemChange(ItemChange change, const ItemChangeData &value) override;
 
 private slots:
     void onDataChanged();
+    void onPointsAppended(int first, int count);
+    void onProviderDestroyed();
+    void onThemeChanged();
+    void onLabelsChanged();
+    void onQualityChanged();
+    void onEnvelopeChanged();
 
 private:
+    enum DirtyFlag {
+        GeometryDirty = 0x1,
+        ThemeDirty = 0x2,
+        LabelsDirty = 0x4,
+        DataDirty = 0x8,
+        AppendDirty = 0x10,
+        OverlayDirty = 0x20,
+        EnvelopeDirty = 0x40,
+        AllDirty = GeometryDirty | ThemeDirty | LabelsDirty | DataDirty | OverlayDirty | EnvelopeDirty
+    };
+
+    void markDirty(int flags);
+    void updateGeometry(bool threaded);
+    void applyGeometry(GeometryWorker::Job &job);
+    void onGeometryReady(GeometryWorker::Job &job);
+    void setDecimationStats(int inputCount, int outputCount);
+    void updateChromeNodes(GraphNode *node);
+    void updateDataNodes(GraphNode *node, int dirtyFrom);
+    void updateSoftwareLayers(GraphNode *node, int dirty);
+    void updateOverlayNodes(GraphNode *node);
+    void updateEnvelopePixels();
+    void setHoverPosition(qreal x);
+    void updateHoverIndex();
+    void updateLabel(GraphNode *node, GraphNode::Label label, const QString &text,
+                     const QFont &font, const QColor &color, const QPointF &origin,
+                     bool rotated = false);
+    QImage createLayerImage() const;
+
     void initializeDefaults();
-    QRectF getPlotArea() const;
-    QPointF mapDataToPixel(double soc, double power) const;
-    void drawBackground(QPainter *painter);
-    void drawTitle(QPainter *painter);
-    void drawAxes(QPainter *painter);
-    void drawAxisLabels(QPainter *painter);
-    void drawAxisValues(QPainter *painter);
-    void drawGraph(QPainter *painter);
-    void drawEndPoints(QPainter *painter);
-    void drawArrows(QPainter *painter);
-    QString formatPowerValue(double power) const;
+    GraphRenderer::Style rendererStyle() const;
+    double peakPower() const;
+    PixelTransform pixelTransform() const;
+    DataProvider::Resolution historyResolution(const DataSnapshot &raw) const;
 
 private:
-    DataProvider *m_graphPointsProvider;
+    // Cleared when the provider is destroyed, e.g. by
+    // ProviderRegistry::removeProvider().
+    QPointer<DataProvider> m_graphPointsProvider;
     QColor m_backgroundColor;
     QColor m_textColor;
     QColor m_lineColor;
@@ -85,12 +198,52 @@ private:
     QFont m_titleFont;
     QFont m_axisFont;
     QFont m_labelFont;
-    static constexpr qreal TOP_MARGIN = 120;
-    static constexpr qreal BOTTOM_MARGIN = 80;
-    static constexpr qreal LEFT_MARGIN = 80;
-    static constexpr qreal RIGHT_MARGIN = 60;
-    static constexpr qreal LINE_WIDTH = 3.0;
-    static constexpr qreal POINT_RADIUS = 6.0;
+
+    int m_dirty;
+    bool m_decimationEnabled;
+    int m_decimationInputCount;
+    int m_decimationOutputCount;
+    static constexpr quint64 InvalidGeneration = ~quint64(0);
+
+    // Rolled-up history (if the provider dropped raw samples) followed by
+    // the raw samples; m_historyCount is where the raw ones start.
+    DataSnapshot m_snapshot;
+    DataProvider::Resolution m_historyResolution;
+    int m_historyCount;
+    quint64 m_mappedGeneration;
+    double m_mappedPeakPower;
+    int m_appendFrom;
+    int m_mappedSourceCount;
+    int m_mappedExactFrom;
+    int m_pixelDirtyFrom;
+    Decimator m_decimator;
+    QVector<QPointF> m_mappedPoints;
+    QVector<QPointF> m_pixelPoints;
+    bool m_threadedGeometry;
+    // While a job is in flight it holds the mapping state; changes arriving
+    // meanwhile are collected in m_pendingDirty and mapped afterwards.
+    bool m_geometryBusy;
+    int m_pendingDirty;
+    // Node updates for a job result applied since the last sync.
+    int m_appliedDirty;
+    // Geometry flags raised since the last updateGeometry(). A sync keeps
+    // them, so a change arriving between polish and sync is still mapped.
+    int m_unmappedDirty;
+    QPointer<FleetEnvelope> m_envelope;
+    QVector<QPointF> m_envelopeLower;
+    QVector<QPointF> m_envelopeMedian;
+    QVector<QPointF> m_envelopeUpper;
+    QImage m_dataLayer;
+    qreal m_dragX;
+    bool m_dragging;
+    qreal m_hoverX;
+    bool m_hovering;
+    int m_hoverIndex;
+    DataPoint m_hoverPoint;
+    QPointer<FrameScheduler> m_scheduler;
+    qreal m_decimationColumnWidth;
+    QRectF m_lastPointRect;
+    GraphRenderer m_renderer;
 };
 
 #endif // GRAPHITEM_H
@@ -0,0 +1,537 @@
+#include "GraphNode.h"
+#include <QQuickWindow>
+#include <QSGFlatColorMaterial>
+#include <QSGVertexColorMaterial>
+#include <QSGRendererInterface>
+#include <QSGTexture>
+#include <QtMath>
+
+namespace {
+
+constexpr int CircleSegments = 32;
+constexpr qreal MaxMiterScale = 4.0;
+
+QPointF normalized(const QPointF &v)
+{
+    const qreal length = qSqrt(v.x() * v.x() + v.y() * v.y());
+    if (qFuzzyIsNull(length))
+        return QPointF();
+    return v / length;
+}
+
+QColor gradientColorAt(const QColor &lineColor, qreal t)
+{
+    const QColor top = lineColor.lighter(35);
+    const QColor middle = lineColor.lighter(25);
+    const QColor bottom(lineColor.red(), lineColor.green(), lineColor.blue(), 0);
+
+    auto mix = [](const QColor &a, const QColor &b, qreal f) {
+        return QColor::fromRgbF(a.redF() + (b.redF() - a.redF()) * f,
+                                a.greenF() + (b.greenF() - a.greenF()) * f,
+                                a.blueF() + (b.blueF() - a.blueF()) * f,
+                                a.alphaF() + (b.alphaF() - a.alphaF()) * f);
+    };
+
+    if (t <= 0.0)
+        return top;
+    if (t < 0.5)
+        return mix(top, middle, t / 0.5);
+    if (t < 0.9)
+        return mix(middle, bottom, (t - 0.5) / 0.4);
+    return bottom;
+}
+
+} // namespace
+
+GraphNode::GraphNode(QQuickWindow *window)
+    : m_window(window)
+    , m_software(window->rendererInterface()->graphicsApi() == QSGRendererInterface::Software)
+{
+    if (m_software) {
+        for (int i = 0; i < LayerCount; ++i) {
+            m_layers[i] = new QSGNode;
+            appendChildNode(m_layers[i]);
+        }
+        return;
+    }
+
+    m_background = m_window->createRectangleNode();
+    appendChildNode(m_background);
+
+    m_axes = createGeometryNode(false);
+    m_axes->geometry()->setDrawingMode(QSGGeometry::DrawLines);
+    m_axes->geometry()->setLineWidth(1);
+    appendChildNode(m_axes);
+
+    m_dataClip = new QSGClipNode;
+    m_dataClip->setGeometry(new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 4));
+    m_dataClip->setFlag(QSGNode::OwnsGeometry);
+    m_dataClip->setIsRectangular(true);
+    appendChildNode(m_dataClip);
+
+    m_envelopeBand = createGeometryNode(false);
+    m_envelopeBand->geometry()->setDrawingMode(QSGGeometry::DrawTriangles);
+    m_dataClip->appendChildNode(m_envelopeBand);
+
+    m_envelopeLine = createGeometryNode(false);
+    m_envelopeLine->geometry()->setDrawingMode(QSGGeometry::DrawLines);
+    m_envelopeLine->geometry()->setLineWidth(1);
+    m_dataClip->appendChildNode(m_envelopeLine);
+
+    m_fill = new QSGNode;
+    m_dataClip->appendChildNode(m_fill);
+
+    m_curve = new QSGNode;
+    m_dataClip->appendChildNode(m_curve);
+
+    m_markers = createGeometryNode(true);
+    appendChildNode(m_markers);
+}
+
+bool GraphNode::isSoftware() const
+{
+    return m_software;
+}
+
+void GraphNode::setBackground(const QRectF &rect, const QColor &color)
+{
+    if (!m_background)
+        return;
+    m_background->setRect(rect);
+    m_background->setColor(color);
+}
+
+void GraphNode::setAxes(const QRectF &plotArea, const QColor &color)
+{
+    if (!m_axes)
+        return;
+
+    const QPointF xEnd = plotArea.bottomRight();
+    const QPointF yEnd = plotArea.topLeft();
+    const QPointF lines[] = {
+        plotArea.bottomLeft(), plotArea.bottomRight(),
+        plotArea.topLeft(), plotArea.bottomLeft(),
+        xEnd, QPointF(xEnd.x() - 10, xEnd.y() - 5),
+        xEnd, QPointF(xEnd.x() - 10, xEnd.y() + 5),
+        yEnd, QPointF(yEnd.x() + 5, yEnd.y() + 10),
+        yEnd, QPointF(yEnd.x() - 5, yEnd.y() + 10),
+    };
+    const int count = int(sizeof(lines) / sizeof(lines[0]));
+
+    QSGGeometry *geometry = m_axes->geometry();
+    geometry->allocate(count);
+    QSGGeometry::Point2D *vertices = geometry->vertexDataAsPoint2D();
+    for (int i = 0; i < count; ++i)
+        vertices[i].set(float(lines[i].x()), float(lines[i].y()));
+
+    static_cast<QSGFlatColorMaterial *>(m_axes->material())->setColor(color);
+    m_axes->markDirty(QSGNode::DirtyGeometry | QSGNode::DirtyMaterial);
+}
+
+void GraphNode::setCurve(const QVector<QPointF> &points, int dirtyFrom,
+                         const QColor &color, qreal lineWidth, bool antialiasing)
+{
+    if (!m_curve)
+        return;
+
+    const int count = points.size();
+    const int segments = segmentCount(count);
+    resizeSegments(m_curve, segments);
+
+    // Each point becomes a column of vertices across the stroke: the solid
+    // core, plus a transparent one pixel fringe on both sides when
+    // antialiasing so the edges fade out instead of aliasing.
+    const int rows = antialiasing ? 4 : 2;
+    const qreal halfWidth = lineWidth / 2.0;
+    const qreal inner = antialiasing ? qMax<qreal>(halfWidth - 0.5, 0.0) : halfWidth;
+    const qreal outer = halfWidth + 0.5;
+    const QColor transparent(color.red(), color.green(), color.blue(), 0);
+    const QPointF *data = points.constData();
+
+    QSGNode *child = m_curve->firstChild();
+    for (int segment = 0; segment < segments; ++segment, child = child->nextSibling()) {
+        if (segment < firstDirtySegment(dirtyFrom))
+            continue;
+
+        QSGGeometryNode *node = static_cast<QSGGeometryNode *>(child);
+        const int start = segment * SegmentPoints;
+        const int end = qMin(start + SegmentPoints, count - 1);
+        const int columns = end - start + 1;
+
+        QSGGeometry *geometry = node->geometry();
+        geometry->allocate(columns * rows, (columns - 1) * (rows - 1) * 6);
+        QSGGeometry::ColoredPoint2D *vertices = geometry->vertexDataAsColoredPoint2D();
+
+        for (int i = start; i <= end; ++i) {
+            QPointF in = i > 0 ? normalized(data[i] - data[i - 1]) : QPointF();
+            QPointF out = i + 1 < count ? normalized(data[i + 1] - data[i]) : QPointF();
+            if (in.isNull())
+                in = out.isNull() ? QPointF(1, 0) : out;
+            if (out.isNull())
+                out = in;
+
+            const QPointF segmentNormal(-out.y(), out.x());
+            QPointF normal = normalized(QPointF(-(in.y() + out.y()), in.x() + out.x()));
+            if (normal.isNull())
+                normal = segmentNormal;
+            const qreal cosine = QPointF::dotProduct(normal, segmentNormal);
+            const qreal miter = qFuzzyIsNull(cosine) ? MaxMiterScale : qMin(1.0 / qAbs(cosine), MaxMiterScale);
+            normal *= miter;
+
+            QSGGeometry::ColoredPoint2D *column = vertices + (i - start) * rows;
+            if (antialiasing) {
+                column[0] = coloredPoint(data[i] - normal * outer, transparent);
+                column[1] = coloredPoint(data[i] - normal * inner, color);
+                column[2] = coloredPoint(data[i] + normal * inner, color);
+                column[3] = coloredPoint(data[i] + normal * outer, transparent);
+            } else {
+                column[0] = coloredPoint(data[i] - normal * inner, color);
+                column[1] = coloredPoint(data[i] + normal * inner, color);
+            }
+        }
+
+        writeBandIndices(geometry->indexDataAsUInt(), columns, rows);
+        node->markDirty(QSGNode::DirtyGeometry);
+    }
+}
+
+void GraphNode::setFill(const QVector<QPointF> &points, int dirtyFrom,
+                        const QRectF &plotArea, const QColor &lineColor)
+{
+    if (!m_fill)
+        return;
+
+    const int count = points.size();
+    const int segments = plotArea.height() > 0 ? segmentCount(count) : 0;
+    resizeSegments(m_fill, segments);
+
+    // The vertical gradient has stops at 0, 0.5 and 0.9 of the plot height.
+    // Splitting every column at those stops keeps the per-vertex colour
+    // interpolation faithful to the QLinearGradient of the painted version.
+    constexpr int rows = 4;
+    const qreal top = plotArea.top();
+    const qreal height = plotArea.height();
+    const qreal bottom = plotArea.bottom();
+    const QPointF *data = points.constData();
+
+    QSGNode *child = m_fill->firstChild();
+    for (int segment = 0; segment < segments; ++segment, child = child->nextSibling()) {
+        if (segment < firstDirtySegment(dirtyFrom))
+            continue;
+
+        QSGGeometryNode *node = static_cast<QSGGeometryNode *>(child);
+        const int start = segment * SegmentPoints;
+        const int end = qMin(start + SegmentPoints, count - 1);
+        const int columns = end - start + 1;
+
+        QSGGeometry *geometry = node->geometry();
+        geometry->allocate(columns * rows, (columns - 1) * (rows - 1) * 6);
+        QSGGeometry::ColoredPoint2D *vertices = geometry->vertexDataAsColoredPoint2D();
+
+        for (int i = start; i <= end; ++i) {
+            const qreal x = data[i].x();
+            const qreal y = qBound(top, data[i].y(), bottom);
+            const qreal levels[rows] = {
+                y,
+                qMax(y, top + height * 0.5),
+                qMax(y, top + height * 0.9),
+                bottom,
+            };
+            for (int row = 0; row < rows; ++row) {
+                const QColor color = gradientColorAt(lineColor, (levels[row] - top) / height);
+                vertices[(i - start) * rows + row] = coloredPoint(QPointF(x, levels[row]), color);
+            }
+        }
+
+        writeBandIndices(geometry->indexDataAsUInt(), columns, rows);
+        node->markDirty(QSGNode::DirtyGeometry);
+    }
+}
+
+void GraphNode::setEnvelope(const QVector<QPointF> &lower, const QVector<QPointF> &median,
+                            const QVector<QPointF> &upper, const QColor &bandColor, const QColor &lineColor)
+{
+    if (!m_envelopeBand)
+        return;
+
+    // A quad (two triangles) and a line segment between every two
+    // neighbouring covered bins.
+    int pairs = 0;
+    for (int i = 0; i + 1 < lower.size(); ++i) {
+        if (!qIsNaN(lower.at(i).y()) && !qIsNaN(lower.at(i + 1).y()))
+            ++pairs;
+    }
+
+    QSGGeometry *band = m_envelopeBand->geometry();
+    QSGGeometry *line = m_envelopeLine->geometry();
+    band->allocate(pairs * 6);
+    line->allocate(pairs * 2);
+    QSGGeometry::Point2D *quad = band->vertexDataAsPoint2D();
+    QSGGeometry::Point2D *segment = line->vertexDataAsPoint2D();
+    for (int i = 0; i + 1 < lower.size(); ++i) {
+        if (qIsNaN(lower.at(i).y()) || qIsNaN(lower.at(i + 1).y()))
+            continue;
+        const QPointF corners[6] = { upper.at(i), lower.at(i), upper.at(i + 1),
+                                     upper.at(i + 1), lower.at(i), lower.at(i + 1) };
+        for (const QPointF &corner : corners)
+            (quad++)->set(float(corner.x()), float(corner.y()));
+        (segment++)->set(float(median.at(i).x()), float(median.at(i).y()));
+        (segment++)->set(float(median.at(i + 1).x()), float(median.at(i + 1).y()));
+    }
+
+    static_cast<QSGFlatColorMaterial *>(m_envelopeBand->material())->setColor(bandColor);
+    static_cast<QSGFlatColorMaterial *>(m_envelopeLine->material())->setColor(lineColor);
+    m_envelopeBand->markDirty(QSGNode::DirtyGeometry | QSGNode::DirtyMaterial);
+    m_envelopeLine->markDirty(QSGNode::DirtyGeometry | QSGNode::DirtyMaterial);
+}
+
+void GraphNode::setMarkers(const QVector<QPointF> &centers, qreal radius, const QColor &color)
+{
+    if (!m_markers)
+        return;
+
+    // Centre + inner rim + transparent outer rim per circle: a solid fan with
+    // a one pixel antialiasing ring around it.
+    constexpr int verticesPerCircle = 1 + CircleSegments * 2;
+    constexpr int indicesPerCircle = CircleSegments * 3 + CircleSegments * 6;
+    const QColor transparent(color.red(), color.green(), color.blue(), 0);
+
+    QSGGeometry *geometry = m_markers->geometry();
+    geometry->allocate(centers.size() * verticesPerCircle, centers.size() * indicesPerCircle);
+    QSGGeometry::ColoredPoint2D *vertices = geometry->vertexDataAsColoredPoint2D();
+    quint32 *indices = geometry->indexDataAsUInt();
+
+    for (int c = 0; c < centers.size(); ++c) {
+        const QPointF center = centers[c];
+        const quint32 base = quint32(c * verticesPerCircle);
+        QSGGeometry::ColoredPoint2D *v = vertices + base;
+        v[0] = coloredPoint(center, color);
+        for (int s = 0; s < CircleSegments; ++s) {
+            const qreal angle = 2 * M_PI * s / CircleSegments;
+            const QPointF direction(qCos(angle), qSin(angle));
+            v[1 + s] = coloredPoint(center + direction * (radius - 0.5), color);
+            v[1 + CircleSegments + s] = coloredPoint(center + direction * (radius + 0.5), transparent);
+        }
+
+        quint32 *idx = indices + c * indicesPerCircle;
+        for (int s = 0; s < CircleSegments; ++s) {
+            const quint32 next = quint32((s + 1) % CircleSegments);
+            const quint32 innerA = base + 1 + quint32(s);
+            const quint32 innerB = base + 1 + next;
+            const quint32 outerA = base + 1 + CircleSegments + quint32(s);
+            const quint32 outerB = base + 1 + CircleSegments + next;
+            *idx++ = base;
+            *idx++ = innerA;
+            *idx++ = innerB;
+            *idx++ = innerA;
+            *idx++ = outerA;
+            *idx++ = innerB;
+            *idx++ = innerB;
+            *idx++ = outerA;
+            *idx++ = outerB;
+        }
+    }
+
+    m_markers->markDirty(QSGNode::DirtyGeometry);
+}
+
+void GraphNode::setDataClip(const QRectF &rect)
+{
+    if (!m_dataClip || m_dataClip->clipRect() == rect)
+        return;
+    m_dataClip->setClipRect(rect);
+    QSGGeometry::updateRectGeometry(m_dataClip->geometry(), rect);
+    m_dataClip->markDirty(QSGNode::DirtyGeometry);
+}
+
+void GraphNode::setCrosshair(const QRectF &plotArea, const QPointF &point, const QColor &color)
+{
+    if (!m_crosshair[0]) {
+        for (QSGRectangleNode *&line : m_crosshair) {
+            line = m_window->createRectangleNode();
+            appendChildNode(line);
+        }
+    }
+    m_crosshair[0]->setRect(QRectF(point.x() - 0.5, plotArea.top(), 1, plotArea.height()));
+    m_crosshair[1]->setRect(QRectF(plotArea.left(), point.y() - 0.5, plotArea.width(), 1));
+    for (QSGRectangleNode *line : m_crosshair)
+        line->setColor(color);
+}
+
+void GraphNode::hideCrosshair()
+{
+    for (QSGRectangleNode *line : m_crosshair) {
+        if (line)
+            line->setRect(QRectF());
+    }
+}
+
+void GraphNode::setLayerImage(Layer layer, const QImage &image, const QRectF &rect)
+{
+    updateLayerImage(layer, image, rect, rect);
+}
+
+void GraphNode::updateLayerImage(Layer layer, const QImage &image, const QRectF &rect, const QRectF &dirty)
+{
+    QSGNode *tiles = m_layers[layer];
+    if (!tiles || image.isNull())
+        return;
+
+    QRectF changed = dirty;
+    const int count = rect.isEmpty() ? 0 : qCeil(rect.width() / TileWidth);
+    if (rect != m_layerRects[layer] || tiles->childCount() != count) {
+        resizeTiles(tiles, count);
+        m_layerRects[layer] = rect;
+        changed = rect;
+    }
+
+    // Each tile gets its own copy so that the caller can keep painting into
+    // image without detaching it from the textures.
+    const qreal dpr = image.devicePixelRatio();
+    int column = 0;
+    for (QSGNode *child = tiles->firstChild(); child; child = child->nextSibling(), ++column) {
+        const QRectF tileRect = QRectF(rect.x() + column * TileWidth, rect.y(), TileWidth, rect.height()) & rect;
+        if (!tileRect.intersects(changed))
+            continue;
+        const QRect source = QRectF((tileRect.topLeft() - rect.topLeft()) * dpr, tileRect.size() * dpr)
+                                 .toAlignedRect() & image.rect();
+        if (source.isEmpty())
+            continue;
+        QImage tile = image.copy(source);
+        tile.setDevicePixelRatio(dpr);
+        QSGImageNode *node = static_cast<QSGImageNode *>(child);
+        node->setTexture(m_window->createTextureFromImage(tile));
+        node->setRect(tileRect);
+    }
+}
+
+void GraphNode::resizeTiles(QSGNode *root, int count)
+{
+    while (QSGNode *last = root->lastChild()) {
+        root->removeChildNode(last);
+        delete last;
+    }
+    for (int i = 0; i < count; ++i) {
+        QSGImageNode *node = m_window->createImageNode();
+        node->setOwnsTexture(true);
+        root->appendChildNode(node);
+    }
+}
+
+bool GraphNode::hasLabel(Label label, const QString &key) const
+{
+    return m_labels[label].node && m_labels[label].key == key;
+}
+
+void GraphNode::setLabel(Label label, const QString &key, const QImage &image, const QRectF &bounds)
+{
+    LabelNode &entry = m_labels[label];
+    if (image.isNull()) {
+        hideLabel(label);
+        entry.key = key;
+        return;
+    }
+
+    if (!entry.node) {
+        entry.node = m_window->createImageNode();
+        entry.node->setOwnsTexture(true);
+        entry.node->setFiltering(QSGTexture::Linear);
+        appendChildNode(entry.node);
+    }
+
+    entry.node->setTexture(m_window->createTextureFromImage(image));
+    entry.key = key;
+    entry.bounds = bounds;
+}
+
+void GraphNode::moveLabel(Label label, const QPointF &origin)
+{
+    LabelNode &entry = m_labels[label];
+    if (entry.node)
+        entry.node->setRect(entry.bounds.translated(origin));
+}
+
+void GraphNode::hideLabel(Label label)
+{
+    LabelNode &entry = m_labels[label];
+    if (entry.node)
+        entry.node->setRect(QRectF());
+}
+
+QSGGeometryNode *GraphNode::createGeometryNode(bool vertexColors)
+{
+    QSGGeometryNode *node = new QSGGeometryNode;
+    QSGGeometry *geometry = nullptr;
+    if (vertexColors) {
+        geometry = new QSGGeometry(QSGGeometry::defaultAttributes_ColoredPoint2D(), 0, 0,
+                                   QSGGeometry::UnsignedIntType);
+        geometry->setDrawingMode(QSGGeometry::DrawTriangles);
+        node->setMaterial(new QSGVertexColorMaterial);
+    } else {
+        geometry = new QSGGeometry(QSGGeometry::defaultAttributes_Point2D(), 0);
+        node->setMaterial(new QSGFlatColorMaterial);
+    }
+    node->setGeometry(geometry);
+    node->setFlag(QSGNode::OwnsGeometry);
+    node->setFlag(QSGNode::OwnsMaterial);
+    return node;
+}
+
+int GraphNode::segmentCount(int pointCount)
+{
+    if (pointCount < 2)
+        return 0;
+    return (pointCount - 2) / SegmentPoints + 1;
+}
+
+int GraphNode::firstDirtySegment(int dirtyFrom)
+{
+    // A point's vertices depend on its neighbours, so a change at dirtyFrom
+    // also invalidates the point before it. Segment k spans points
+    // [k * SegmentPoints, (k + 1) * SegmentPoints], sharing its last point
+    // with the next segment.
+    const int firstAffected = dirtyFrom - 1;
+    return firstAffected <= 0 ? 0 : (firstAffected - 1) / SegmentPoints;
+}
+
+void GraphNode::resizeSegments(QSGNode *root, int count)
+{
+    while (root->childCount() > count) {
+        QSGNode *last = root->lastChild();
+        root->removeChildNode(last);
+        delete last;
+    }
+    while (root->childCount() < count)
+        root->appendChildNode(createGeometryNode(true));
+}
+
+QSGGeometry::ColoredPoint2D GraphNode::coloredPoint(const QPointF &pos, const QColor &color)
+{
+    // QSGVertexColorMaterial expects premultiplied colours.
+    const qreal alpha = color.alphaF();
+    QSGGeometry::ColoredPoint2D point;
+    point.set(float(pos.x()), float(pos.y()),
+              uchar(qRound(color.red() * alpha)),
+              uchar(qRound(color.green() * alpha)),
+              uchar(qRound(color.blue() * alpha)),
+              uchar(color.alpha()));
+    return point;
+}
+
+void GraphNode::writeBandIndices(quint32 *indices, int columns, int rows)
+{
+    for (int column = 0; column + 1 < columns; ++column) {
+        for (int row = 0; row + 1 < rows; ++row) {
+            const quint32 a = quint32(column * rows + row);
+            const quint32 b = a + 1;
+            const quint32 c = a + quint32(rows);
+            const quint32 d = c + 1;
+            *indices++ = a;
+            *indices++ = c;
+            *indices++ = b;
+            *indices++ = b;
+            *indices++ = c;
+            *indices++ = d;
+        }
+    }
+}
@@ -0,0 +1,118 @@
+#ifndef GRAPHNODE_H
+#define GRAPHNODE_H
+
+#include <QSGNode>
+#include <QSGClipNode>
+#include <QSGGeometryNode>
+#include <QSGImageNode>
+#include <QSGRectangleNode>
+#include <QColor>
+#include <QImage>
+#include <QVector>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+
+class QQuickWindow;
+
+// Retained scene graph subtree for one GraphItem. On hardware backends the
+// curve, fill, axes and end point markers are geometry nodes whose vertex
+// buffers are only rewritten when the caller pushes new data. Curve and fill
+// are split into fixed-size segments so that appending points only rebuilds
+// the tail segment instead of the whole vertex buffer. The software
+// backend cannot draw custom geometry, so there the chrome and data layers are
+// QPainter-rendered images that are likewise only replaced on change. Layers
+// are uploaded as columns of tiles, so a change confined to a small region
+// (an appended sample) only re-uploads and repaints the tiles it touches.
+class GraphNode : public QSGNode
+{
+public:
+    enum Label {
+        TitleLabel,
+        XAxisLabel,
+        YAxisLabel,
+        FirstSocLabel,
+        LastSocLabel,
+        MaxPowerLabel,
+        FirstPowerLabel,
+        LastPowerLabel,
+        HoverLabel,
+        LabelCount
+    };
+
+    enum Layer {
+        ChromeLayer,
+        DataLayer,
+        LayerCount
+    };
+
+    explicit GraphNode(QQuickWindow *window);
+
+    bool isSoftware() const;
+
+    void setBackground(const QRectF &rect, const QColor &color);
+    void setAxes(const QRectF &plotArea, const QColor &color);
+    // dirtyFrom is the first index of points that changed since the last call;
+    // pass 0 to rebuild everything.
+    void setCurve(const QVector<QPointF> &points, int dirtyFrom,
+                  const QColor &color, qreal lineWidth, bool antialiasing);
+    void setFill(const QVector<QPointF> &points, int dirtyFrom,
+                 const QRectF &plotArea, const QColor &lineColor);
+    // Fleet envelope behind the fill: the band between lower and upper and
+    // the median line, skipping bins whose y is NaN.
+    void setEnvelope(const QVector<QPointF> &lower, const QVector<QPointF> &median,
+                     const QVector<QPointF> &upper, const QColor &bandColor, const QColor &lineColor);
+    void setMarkers(const QVector<QPointF> &centers, qreal radius, const QColor &color);
+    // Rectangle the curve and fill are clipped to.
+    void setDataClip(const QRectF &rect);
+    // Hover crosshair: one pixel lines through point across plotArea. Plain
+    // rectangle nodes on every backend, so moving it never touches the
+    // curve or the layers.
+    void setCrosshair(const QRectF &plotArea, const QPointF &point, const QColor &color);
+    void hideCrosshair();
+
+    void setLayerImage(Layer layer, const QImage &image, const QRectF &rect);
+    // Only the tiles intersecting dirty are taken from image.
+    void updateLayerImage(Layer layer, const QImage &image, const QRectF &rect, const QRectF &dirty);
+
+    bool hasLabel(Label label, const QString &key) const;
+    void setLabel(Label label, const QString &key, const QImage &image, const QRectF &bounds);
+    void moveLabel(Label label, const QPointF &origin);
+    void hideLabel(Label label);
+
+private:
+    static constexpr int SegmentPoints = 1024;
+    static constexpr int TileWidth = 256;
+
+    static QSGGeometryNode *createGeometryNode(bool vertexColors);
+    static int segmentCount(int pointCount);
+    static int firstDirtySegment(int dirtyFrom);
+    static void resizeSegments(QSGNode *root, int count);
+    void resizeTiles(QSGNode *root, int count);
+    static QSGGeometry::ColoredPoint2D coloredPoint(const QPointF &pos, const QColor &color);
+    static void writeBandIndices(quint32 *indices, int columns, int rows);
+
+    struct LabelNode {
+        QSGImageNode *node = nullptr;
+        QString key;
+        QRectF bounds;
+    };
+
+    QQuickWindow *m_window;
+    bool m_software;
+
+    QSGRectangleNode *m_background = nullptr;
+    QSGGeometryNode *m_axes = nullptr;
+    QSGClipNode *m_dataClip = nullptr;
+    QSGGeometryNode *m_envelopeBand = nullptr;
+    QSGGeometryNode *m_envelopeLine = nullptr;
+    QSGNode *m_fill = nullptr;
+    QSGNode *m_curve = nullptr;
+    QSGGeometryNode *m_markers = nullptr;
+    QSGRectangleNode *m_crosshair[2] = {};
+    QSGNode *m_layers[LayerCount] = {};
+    QRectF m_layerRects[LayerCount];
+    LabelNode m_labels[LabelCount];
+};
+
+#endif // GRAPHNODE_H
@@ -0,0 +1,664 @@
+#include "GraphRenderer.h"
+#include "Trace.h"
+#include <QLinearGradient>
+#include <QtMath>
+#include <algorithm>
+
+GraphRenderer::GraphRenderer()
+    : m_minSoc(FullMinSoc)
+    , m_maxSoc(FullMaxSoc)
+    , m_antialiasing(true)
+    , m_fillEnabled(true)
+    , m_cache(QSharedPointer<RenderCache>::create())
+    , m_valueTextsValid(false)
+{
+    updatePens();
+    updateFontKeys();
+}
+
+void GraphRenderer::setCache(const QSharedPointer<RenderCache> &cache)
+{
+    // The chrome layer already taken from the old cache stays valid.
+    m_cache = cache ? cache : QSharedPointer<RenderCache>::create();
+}
+
+void GraphRenderer::setStyle(const Style &style)
+{
+    const bool fontsChanged = style.titleFont != m_style.titleFont || style.axisFont != m_style.axisFont
+                              || style.labelFont != m_style.labelFont;
+
+    if (style.backgroundColor != m_style.backgroundColor || style.textColor != m_style.textColor
+        || style.title != m_style.title || style.xAxisLabel != m_style.xAxisLabel
+        || style.yAxisLabel != m_style.yAxisLabel || style.titleFont != m_style.titleFont
+        || style.labelFont != m_style.labelFont)
+        m_chromeLayer = QImage();
+
+    const bool penChanged = style.lineColor != m_style.lineColor || style.textColor != m_style.textColor;
+    m_style = style;
+    m_valueTextsValid = false;
+    if (penChanged)
+        updatePens();
+    if (fontsChanged)
+        updateFontKeys();
+}
+
+void GraphRenderer::updateFontKeys()
+{
+    for (int role = 0; role < TextRoleCount; ++role)
+        m_fontKeys[role] = font(TextRole(role)).key();
+}
+
+void GraphRenderer::setSize(const QSizeF &size)
+{
+    if (size == m_size)
+        return;
+    m_chromeLayer = QImage();
+    m_size = size;
+    updatePens();
+}
+
+void GraphRenderer::updatePens()
+{
+    const QColor &lineColor = m_style.lineColor;
+    m_curvePen = QPen(lineColor, LINE_WIDTH);
+    m_markerPen = QPen(lineColor, 2);
+    m_linePen = QPen(lineColor);
+    m_textPen = QPen(m_style.textColor, 1);
+    m_markerBrush = QBrush(lineColor);
+
+    const QRectF plotArea = this->plotArea();
+    QLinearGradient gradient(0, plotArea.top(), 0, plotArea.bottom());
+    gradient.setColorAt(0.0, lineColor.lighter(35));
+    gradient.setColorAt(0.5, lineColor.lighter(25));
+    gradient.setColorAt(0.9, QColor(lineColor.red(),
+                                    lineColor.green(),
+                                    lineColor.blue(),
+                                    0));
+    m_fillBrush = QBrush(gradient);
+
+    m_envelopePen = QPen(envelopeLineColor(), 1.5);
+    m_envelopeBrush = QBrush(envelopeBandColor());
+}
+
+void GraphRenderer::setSocRange(double minSoc, double maxSoc)
+{
+    m_minSoc = minSoc;
+    m_maxSoc = qMax(maxSoc, minSoc + MinSocSpan);
+}
+
+bool GraphRenderer::isZoomed() const
+{
+    return m_minSoc > FullMinSoc || m_maxSoc < FullMaxSoc;
+}
+
+void GraphRenderer::visibleRange(const DataSnapshot &snapshot, int *first, int *end) const
+{
+    if (!isZoomed()) {
+        *first = 0;
+        *end = snapshot.size();
+        return;
+    }
+    *first = qMax(0, snapshot.lowerBoundSoc(m_minSoc) - 1);
+    *end = qMin(snapshot.size(), snapshot.lowerBoundSoc(m_maxSoc) + 1);
+}
+
+QRectF GraphRenderer::plotArea() const
+{
+    return QRectF(LEFT_MARGIN, TOP_MARGIN,
+                  m_size.width() - LEFT_MARGIN - RIGHT_MARGIN,
+                  m_size.height() - TOP_MARGIN - BOTTOM_MARGIN);
+}
+
+PixelTransform GraphRenderer::pixelTransform(double peakPower) const
+{
+    QRectF plotArea = this->plotArea();
+
+    double minSoc = m_minSoc;
+    double maxSoc = m_maxSoc;
+    double minPower = 0.0;
+    double maxPower = qMax(300.0, peakPower * 1.2);
+
+    PixelTransform transform;
+    transform.xScale = plotArea.width() / (maxSoc - minSoc);
+    transform.xOffset = plotArea.left() - minSoc * transform.xScale;
+    transform.yScale = -plotArea.height() / (maxPower - minPower);
+    transform.yOffset = plotArea.bottom() - minPower * transform.yScale;
+    return transform;
+}
+
+QPointF GraphRenderer::mapDataToPixel(double soc, double power, double peakPower) const
+{
+    const PixelTransform transform = pixelTransform(peakPower);
+    return QPointF(soc * transform.xScale + transform.xOffset,
+                   power * transform.yScale + transform.yOffset);
+}
+
+double GraphRenderer::socAt(qreal x) const
+{
+    const QRectF plotArea = this->plotArea();
+    if (plotArea.width() <= 0)
+        return m_minSoc;
+    return m_minSoc + (x - plotArea.left()) / plotArea.width() * (m_maxSoc - m_minSoc);
+}
+
+QString GraphRenderer::formatPowerValue(double power)
+{
+    return QString("%1kW").arg(power, 0, 'f', 0);
+}
+
+QString GraphRenderer::formatHoverValue(const DataPoint &point)
+{
+    return QString("%1% / %2kW").arg(point.getSocPercentage(), 0, 'f', 1).arg(point.getPower(), 0, 'f', 1);
+}
+
+int GraphRenderer::textWidth(TextRole role, const QString &text) const
+{
+    return cachedText(role, text).bounds.width();
+}
+
+QRect GraphRenderer::textBounds(TextRole role, const QString &text) const
+{
+    return cachedText(role, text).bounds;
+}
+
+void GraphRenderer::drawText(QPainter *painter, TextRole role, const QPointF &origin, const QString &text) const
+{
+    // QStaticText is positioned by its top-left corner, not its baseline.
+    const RenderCache::TextLayout &cached = cachedText(role, text);
+    painter->drawStaticText(QPointF(origin.x(), origin.y() - cached.ascent), cached.text);
+}
+
+const RenderCache::TextLayout &GraphRenderer::cachedText(TextRole role, const QString &text) const
+{
+    return m_cache->textLayout(m_fontKeys[role], font(role), text);
+}
+
+const QFont &GraphRenderer::font(TextRole role) const
+{
+    switch (role) {
+    case TitleText:
+        return m_style.titleFont;
+    case AxisText:
+        return m_style.axisFont;
+    default:
+        return m_style.labelFont;
+    }
+}
+
+QPointF GraphRenderer::titleOrigin() const
+{
+    return QPointF((m_size.width() - textWidth(TitleText, m_style.title)) / 2, TOP_MARGIN / 2);
+}
+
+QPointF GraphRenderer::xAxisLabelOrigin() const
+{
+    return QPointF(plotArea().center().x() - textWidth(LabelText, m_style.xAxisLabel) / 2,
+                   m_size.height() - BOTTOM_MARGIN / 2);
+}
+
+QPointF GraphRenderer::yAxisLabelOrigin() const
+{
+    return QPointF(LEFT_MARGIN / 2, plotArea().center().y());
+}
+
+int GraphRenderer::mapPoints(const DataSnapshot &snapshot, double peakPower, qreal devicePixelRatio,
+                             bool decimate, Decimator &decimator,
+                             QVector<QPointF> &mapped, QVector<QPointF> &pixels) const
+{
+    int first = 0;
+    int end = 0;
+    visibleRange(snapshot, &first, &end);
+    mapRange(snapshot, first, end, pixelTransform(peakPower), devicePixelRatio, decimate, decimator,
+             mapped, pixels);
+    return end - first;
+}
+
+void GraphRenderer::mapRange(const DataSnapshot &snapshot, int first, int end, const PixelTransform &transform,
+                             qreal devicePixelRatio, bool decimate, Decimator &decimator,
+                             QVector<QPointF> &mapped, QVector<QPointF> &pixels, int *exactFrom)
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    // resize() rather than clear() so that reused buffers keep their capacity.
+    pixels.resize(0);
+    if (exactFrom)
+        *exactFrom = first;
+
+    QVector<QPointF> &target = decimate ? mapped : pixels;
+    target.resize(end - first);
+    QPointF *begin = target.data();
+    QPointF *out = begin;
+    for (int chunk = snapshot.chunkIndex(first); chunk < snapshot.chunkCount() && snapshot.chunkStart(chunk) < end;
+         ++chunk) {
+        const int chunkStart = snapshot.chunkStart(chunk);
+        const int from = qMax(first, chunkStart) - chunkStart;
+        const int to = qMin(end, chunkStart + snapshot.chunkSize(chunk)) - chunkStart;
+        if (decimate && from == 0 && to == snapshot.chunkSize(chunk)
+            && mapChunkSummary(snapshot, chunk, transform, devicePixelRatio, out)) {
+            out += 4;
+            if (exactFrom)
+                *exactFrom = chunkStart + snapshot.chunkSize(chunk);
+            continue;
+        }
+        const DataSnapshot::Columns columns = snapshot.columns(chunk);
+        PointKernels::mapToPixel(columns.soc + from, columns.power + from, to - from, transform, out);
+        out += to - from;
+    }
+    target.resize(int(out - begin));
+
+    if (decimate) {
+        decimator.reset(1.0 / devicePixelRatio);
+        decimator.append(mapped, 0, pixels);
+    }
+}
+
+bool GraphRenderer::mapChunkSummary(const DataSnapshot &snapshot, int chunk, const PixelTransform &transform,
+                                    qreal devicePixelRatio, QPointF *out)
+{
+    // When zoomed out far enough that a whole chunk falls into one pixel
+    // column, its M4 reduction is its first and last sample plus its power
+    // extremes. The summary has the extremes, so only two samples are read
+    // and the pages in between (possibly a mapped session) stay untouched;
+    // compressed chunks keep both end points and are not decoded.
+    const int count = snapshot.chunkSize(chunk);
+    if (count <= 4)
+        return false;
+
+    const ChunkSummary &summary = snapshot.chunkSummary(chunk);
+    const double left = summary.minSoc * transform.xScale + transform.xOffset;
+    const double right = summary.maxSoc * transform.xScale + transform.xOffset;
+    if (qFloor(left * devicePixelRatio) != qFloor(right * devicePixelRatio))
+        return false;
+
+    const DataPoint first = snapshot.chunkFirst(chunk);
+    const DataPoint last = snapshot.chunkLast(chunk);
+    out[0] = QPointF(first.getSocPercentage() * transform.xScale + transform.xOffset,
+                     first.getPower() * transform.yScale + transform.yOffset);
+    out[1] = QPointF(left, summary.minPower * transform.yScale + transform.yOffset);
+    out[2] = QPointF(right, summary.maxPower * transform.yScale + transform.yOffset);
+    out[3] = QPointF(last.getSocPercentage() * transform.xScale + transform.xOffset,
+                     last.getPower() * transform.yScale + transform.yOffset);
+    return true;
+}
+
+const QImage &GraphRenderer::chromeLayer(qreal devicePixelRatio) const
+{
+    if (!m_chromeLayer.isNull() && m_chromeLayer.devicePixelRatio() == devicePixelRatio)
+        return m_chromeLayer;
+
+    const QString key = chromeKey(devicePixelRatio);
+    m_chromeLayer = m_cache->image(key);
+    if (m_chromeLayer.isNull()) {
+        GRAPH_TRACE_SCOPE(TraceRender, "renderChromeLayer");
+        m_chromeLayer = QImage((m_size * devicePixelRatio).toSize(), QImage::Format_ARGB32_Premultiplied);
+        m_chromeLayer.setDevicePixelRatio(devicePixelRatio);
+        m_chromeLayer.fill(Qt::transparent);
+        QPainter painter(&m_chromeLayer);
+        painter.setRenderHint(QPainter::Antialiasing, true);
+        drawChrome(&painter);
+        painter.end();
+        m_cache->insertImage(key, m_chromeLayer);
+    }
+    return m_chromeLayer;
+}
+
+QString GraphRenderer::chromeKey(qreal devicePixelRatio) const
+{
+    // Everything drawChrome() depends on.
+    return QStringLiteral("chrome|%1x%2@%3|%4|%5|%6|%7|%8|%9")
+        .arg(m_size.width())
+        .arg(m_size.height())
+        .arg(devicePixelRatio)
+        .arg(m_style.backgroundColor.name(QColor::HexArgb), m_style.textColor.name(QColor::HexArgb),
+             m_style.lineColor.name(QColor::HexArgb), m_style.title, m_style.xAxisLabel, m_style.yAxisLabel)
+        + QLatin1Char('|') + m_fontKeys[TitleText] + QLatin1Char('|') + m_fontKeys[AxisText]
+        + QLatin1Char('|') + m_fontKeys[LabelText];
+}
+
+void GraphRenderer::drawChrome(QPainter *painter) const
+{
+    drawBackground(painter);
+    drawTitle(painter);
+    drawAxes(painter);
+    drawAxisLabels(painter);
+    drawArrows(painter);
+}
+
+void GraphRenderer::drawData(QPainter *painter, const DataSnapshot &snapshot, double peakPower,
+                             const QVector<QPointF> &pixelPoints, int firstPixel) const
+{
+    painter->setRenderHint(QPainter::Antialiasing, m_antialiasing);
+    drawAxisValues(painter, snapshot, peakPower);
+    drawGraph(painter, pixelPoints, firstPixel);
+    drawEndPoints(painter, snapshot, peakPower);
+}
+
+void GraphRenderer::valueTexts(const DataSnapshot &snapshot, double peakPower, ValueText *texts) const
+{
+    // The labels only depend on the end points, so keying on them (rather
+    // than on the snapshot generation) also holds across providers.
+    ValueTextsKey key;
+    key.empty = snapshot.isEmpty();
+    if (!key.empty) {
+        const DataPoint first = snapshot.first();
+        const DataPoint last = snapshot.last();
+        key.firstSoc = first.getSocPercentage();
+        key.firstPower = first.getPower();
+        key.lastSoc = last.getSocPercentage();
+        key.lastPower = last.getPower();
+    }
+    key.peakPower = peakPower;
+    key.minSoc = m_minSoc;
+    key.maxSoc = m_maxSoc;
+    key.size = m_size;
+
+    if (!m_valueTextsValid || !(key == m_valueTextsKey)) {
+        computeValueTexts(snapshot, peakPower, m_valueTexts);
+        m_valueTextsKey = key;
+        m_valueTextsValid = true;
+    }
+    std::copy(m_valueTexts, m_valueTexts + ValueLabelCount, texts);
+}
+
+void GraphRenderer::computeValueTexts(const DataSnapshot &snapshot, double peakPower, ValueText *texts) const
+{
+    for (int label = 0; label < ValueLabelCount; ++label)
+        texts[label] = ValueText();
+    if (snapshot.isEmpty())
+        return;
+
+    const QRectF plotArea = this->plotArea();
+    auto place = [this, texts](ValueLabel label, TextRole role, const QString &text, qreal centerX, qreal baseline) {
+        texts[label].text = text;
+        texts[label].origin = QPointF(centerX - textWidth(role, text) / 2, baseline);
+        texts[label].visible = true;
+    };
+
+    if (isZoomed()) {
+        // The end points are usually off screen; label the range instead.
+        const double span = m_maxSoc - m_minSoc;
+        const int decimals = span >= 10.0 ? 0 : span >= 1.0 ? 1 : 2;
+        place(FirstSocValue, AxisText, QString::number(m_minSoc, 'f', decimals) + "%", plotArea.left(),
+              plotArea.bottom() + 20);
+        place(LastSocValue, AxisText, QString::number(m_maxSoc, 'f', decimals) + "%", plotArea.right(),
+              plotArea.bottom() + 20);
+    } else {
+        const double firstSoc = snapshot.first().getSocPercentage();
+        const double lastSoc = snapshot.last().getSocPercentage();
+        place(FirstSocValue, AxisText, QString::number(qRound(firstSoc)) + "%",
+              mapDataToPixel(firstSoc, 0, peakPower).x(), plotArea.bottom() + 20);
+        place(LastSocValue, AxisText, QString::number(qRound(lastSoc)) + "%",
+              mapDataToPixel(lastSoc, 0, peakPower).x(), plotArea.bottom() + 20);
+    }
+
+    const QString maxPowerText = QString::number(qRound(peakPower)) + "kW";
+    texts[MaxPowerValue].text = maxPowerText;
+    texts[MaxPowerValue].origin = QPointF(plotArea.left() - textWidth(AxisText, maxPowerText) - 10,
+                                          mapDataToPixel(0, peakPower, peakPower).y() + 5);
+    texts[MaxPowerValue].visible = true;
+
+    QPointF pixel;
+    if (endPointPixel(snapshot, peakPower, false, &pixel))
+        place(FirstPowerValue, LabelText, formatPowerValue(snapshot.first().getPower()), pixel.x(), pixel.y() - 15);
+    if (endPointPixel(snapshot, peakPower, true, &pixel))
+        place(LastPowerValue, LabelText, formatPowerValue(snapshot.last().getPower()), pixel.x(), pixel.y() - 15);
+}
+
+bool GraphRenderer::endPointPixel(const DataSnapshot &snapshot, double peakPower, bool last, QPointF *pixel) const
+{
+    if (snapshot.isEmpty())
+        return false;
+    const DataPoint point = last ? snapshot.last() : snapshot.first();
+    if (isZoomed() && (point.getSocPercentage() < m_minSoc || point.getSocPercentage() > m_maxSoc))
+        return false;
+    *pixel = mapDataToPixel(point.getSocPercentage(), point.getPower(), peakPower);
+    return true;
+}
+
+QRectF GraphRenderer::lastPointRect(const DataSnapshot &snapshot, double peakPower) const
+{
+    QPointF pixel;
+    if (!endPointPixel(snapshot, peakPower, true, &pixel))
+        return QRectF();
+
+    // Marker outline is a 2 px pen around POINT_RADIUS.
+    const qreal markerRadius = POINT_RADIUS + 1;
+    QRectF rect(pixel.x() - markerRadius, pixel.y() - markerRadius, 2 * markerRadius, 2 * markerRadius);
+
+    ValueText texts[ValueLabelCount];
+    valueTexts(snapshot, peakPower, texts);
+    rect |= QRectF(textBounds(LabelText, texts[LastPowerValue].text)).translated(texts[LastPowerValue].origin);
+    rect |= QRectF(textBounds(AxisText, texts[LastSocValue].text)).translated(texts[LastSocValue].origin);
+
+    // Antialiased edges bleed into the next pixel.
+    return rect.adjusted(-1, -1, 1, 1);
+}
+
+QRectF GraphRenderer::curveRect(const QVector<QPointF> &pixelPoints, int from) const
+{
+    if (from >= pixelPoints.size())
+        return QRectF();
+
+    // The segment into pixelPoints[from] changes as well.
+    from = qMax(0, from - 1);
+    qreal left = pixelPoints.at(from).x();
+    qreal right = left;
+    qreal top = pixelPoints.at(from).y();
+    for (int i = from + 1; i < pixelPoints.size(); ++i) {
+        const QPointF &point = pixelPoints.at(i);
+        left = qMin(left, point.x());
+        right = qMax(right, point.x());
+        top = qMin(top, point.y());
+    }
+
+    const qreal pen = LINE_WIDTH / 2 + 1;
+    return QRectF(QPointF(left - pen, top - pen), QPointF(right + pen, plotArea().bottom() + 1));
+}
+
+void GraphRenderer::drawBackground(QPainter *painter) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    painter->fillRect(QRectF(QPointF(0, 0), m_size), m_style.backgroundColor);
+}
+
+void GraphRenderer::drawTitle(QPainter *painter) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    painter->setPen(m_textPen);
+    painter->setFont(m_style.titleFont);
+    drawText(painter, TitleText, titleOrigin(), m_style.title);
+}
+
+void GraphRenderer::drawAxes(QPainter *painter) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    QRectF plotArea = this->plotArea();
+    painter->setPen(m_textPen);
+
+    painter->drawLine(plotArea.bottomLeft(), plotArea.bottomRight());
+    painter->drawLine(plotArea.topLeft(), plotArea.bottomLeft());
+}
+
+void GraphRenderer::drawAxisLabels(QPainter *painter) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    painter->setPen(m_textPen);
+    painter->setFont(m_style.labelFont);
+
+    painter->save();
+    painter->translate(yAxisLabelOrigin());
+    painter->rotate(-90);
+    drawText(painter, LabelText, QPointF(0, 0), m_style.yAxisLabel);
+    painter->restore();
+
+    drawText(painter, LabelText, xAxisLabelOrigin(), m_style.xAxisLabel);
+}
+
+void GraphRenderer::drawAxisValues(QPainter *painter, const DataSnapshot &snapshot, double peakPower) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    painter->setFont(m_style.axisFont);
+    painter->setPen(m_textPen);
+
+    ValueText texts[ValueLabelCount];
+    valueTexts(snapshot, peakPower, texts);
+    for (ValueLabel label : { FirstSocValue, LastSocValue, MaxPowerValue }) {
+        if (texts[label].visible)
+            drawText(painter, AxisText, texts[label].origin, texts[label].text);
+    }
+}
+
+void GraphRenderer::drawGraph(QPainter *painter, const QVector<QPointF> &pixelPoints, int first) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    first = qMax(0, first);
+    const int count = pixelPoints.size() - first;
+    if (count < 2) {
+        return;
+    }
+
+    // Polylines straight from the caller's buffer; only the fill needs the
+    // two closing points, and those go into scratch memory.
+    m_scratch.reset();
+    const QPointF *points = pixelPoints.constData() + first;
+    QRectF plotArea = this->plotArea();
+
+    // While zoomed the neighbours just outside the SOC range lie outside
+    // the plot area.
+    const bool clip = isZoomed();
+    if (clip) {
+        painter->save();
+        painter->setClipRect(plotArea, Qt::IntersectClip);
+    }
+
+    if (m_fillEnabled) {
+        QPointF *polygon = m_scratch.allocate<QPointF>(count + 2);
+        std::copy(points, points + count, polygon);
+        polygon[count] = QPointF(points[count - 1].x(), plotArea.bottom());
+        polygon[count + 1] = QPointF(points[0].x(), plotArea.bottom());
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(m_fillBrush);
+        painter->drawPolygon(polygon, count + 2);
+    }
+
+    painter->setRenderHint(QPainter::Antialiasing, m_antialiasing);
+    painter->setPen(m_curvePen);
+    painter->setBrush(Qt::NoBrush);
+    painter->drawPolyline(points, count);
+    if (clip)
+        painter->restore();
+}
+
+void GraphRenderer::mapEnvelope(const PowerEnvelope &envelope, double peakPower, QVector<QPointF> &lower,
+                                QVector<QPointF> &median, QVector<QPointF> &upper) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    const int count = envelope.binCount();
+    lower.resize(count);
+    median.resize(count);
+    upper.resize(count);
+    const PixelTransform transform = pixelTransform(peakPower);
+    for (int bin = 0; bin < count; ++bin) {
+        // NaN power stays NaN through the mapping and marks the gaps.
+        const qreal x = bin * envelope.socStep * transform.xScale + transform.xOffset;
+        lower[bin] = QPointF(x, envelope.lower.at(bin) * transform.yScale + transform.yOffset);
+        median[bin] = QPointF(x, envelope.median.at(bin) * transform.yScale + transform.yOffset);
+        upper[bin] = QPointF(x, envelope.upper.at(bin) * transform.yScale + transform.yOffset);
+    }
+}
+
+void GraphRenderer::drawEnvelope(QPainter *painter, const QVector<QPointF> &lower, const QVector<QPointF> &median,
+                                 const QVector<QPointF> &upper) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    const int count = lower.size();
+    if (count < 2)
+        return;
+
+    painter->save();
+    painter->setClipRect(plotArea(), Qt::IntersectClip);
+    m_scratch.reset();
+    QPointF *polygon = m_scratch.allocate<QPointF>(2 * count);
+    int run = 0;
+    while (run < count) {
+        if (qIsNaN(lower.at(run).y())) {
+            ++run;
+            continue;
+        }
+        int end = run + 1;
+        while (end < count && !qIsNaN(lower.at(end).y()))
+            ++end;
+
+        // Upper edge left to right, lower edge back.
+        const int length = end - run;
+        std::copy(upper.constData() + run, upper.constData() + end, polygon);
+        std::reverse_copy(lower.constData() + run, lower.constData() + end, polygon + length);
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(m_envelopeBrush);
+        painter->drawPolygon(polygon, 2 * length);
+        painter->setPen(m_envelopePen);
+        painter->setBrush(Qt::NoBrush);
+        painter->drawPolyline(median.constData() + run, length);
+        run = end;
+    }
+    painter->restore();
+}
+
+QColor GraphRenderer::envelopeBandColor() const
+{
+    QColor color = m_style.textColor;
+    color.setAlpha(40);
+    return color;
+}
+
+QColor GraphRenderer::envelopeLineColor() const
+{
+    QColor color = m_style.textColor;
+    color.setAlpha(110);
+    return color;
+}
+
+void GraphRenderer::drawEndPoints(QPainter *painter, const DataSnapshot &snapshot, double peakPower) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    if (snapshot.isEmpty()) {
+        return;
+    }
+
+    painter->setPen(m_markerPen);
+    painter->setBrush(m_markerBrush);
+
+    QPointF pixel;
+    if (endPointPixel(snapshot, peakPower, false, &pixel))
+        painter->drawEllipse(pixel, POINT_RADIUS, POINT_RADIUS);
+    if (endPointPixel(snapshot, peakPower, true, &pixel))
+        painter->drawEllipse(pixel, POINT_RADIUS, POINT_RADIUS);
+
+    painter->setPen(m_linePen);
+    painter->setFont(m_style.labelFont);
+
+    ValueText texts[ValueLabelCount];
+    valueTexts(snapshot, peakPower, texts);
+    for (ValueLabel label : { FirstPowerValue, LastPowerValue }) {
+        if (texts[label].visible)
+            drawText(painter, LabelText, texts[label].origin, texts[label].text);
+    }
+}
+
+void GraphRenderer::drawArrows(QPainter *painter) const
+{
+    GRAPH_TRACE_FUNCTION(TraceRender);
+    QRectF plotArea = this->plotArea();
+    painter->setPen(m_textPen);
+
+    QPointF xArrowEnd = plotArea.bottomRight();
+    QPointF xArrow1(xArrowEnd.x() - 10, xArrowEnd.y() - 5);
+    QPointF xArrow2(xArrowEnd.x() - 10, xArrowEnd.y() + 5);
+    painter->drawLine(xArrowEnd, xArrow1);
+    painter->drawLine(xArrowEnd, xArrow2);
+
+    QPointF yArrowEnd = plotArea.topLeft();
+    QPointF yArrow1(yArrowEnd.x() + 5, yArrowEnd.y() + 10);
+    QPointF yArrow2(yArrowEnd.x() - 5, yArrowEnd.y() + 10);
+    painter->drawLine(yArrowEnd, yArrow1);
+    painter->drawLine(yArrowEnd, yArrow2);
+}
@@ -0,0 +1,250 @@
+#ifndef GRAPHRENDERER_H
+#define GRAPHRENDERER_H
+
+#include <QBrush>
+#include <QColor>
+#include <QFont>
+#include <QImage>
+#include <QPainter>
+#include <QPen>
+#include <QPointF>
+#include <QSharedPointer>
+#include <QRectF>
+#include <QSizeF>
+#include <QString>
+#include <QVector>
+#include "DataSnapshot.h"
+#include "Decimator.h"
+#include "PointKernels.h"
+#include "PowerEnvelope.h"
+#include "RenderCache.h"
+#include "ScratchArena.h"
+
+// QPainter drawing of a graph, independent of QQuickItem. It only holds the
+// style, the size and caches derived from them; the data is passed in per
+// call. An instance can be used from any thread, one at a time, and against
+// any paint device (QImage, QSvgGenerator, ...), which is what the software
+// scene graph path, GraphItem::paint() and the headless BatchRenderer share.
+//
+// Text is laid out once as QStaticText together with its metrics, and the
+// chrome (everything but the data) is kept as a pre-rendered layer. Both
+// live in a RenderCache, private by default; renderers that are never used
+// concurrently can share one with setCache() and then reuse each other's
+// layouts and layers.
+//
+// Pens, brushes and the value labels are cached as well, and the curve is
+// drawn straight from the caller's pixel buffer with the fill polygon in a
+// per-frame scratch arena, so repainting unchanged data does not touch the
+// heap.
+class GraphRenderer
+{
+public:
+    struct Style {
+        QColor backgroundColor = QColor("#1e1e1e");
+        QColor textColor = QColor("#ffffff");
+        QColor lineColor = QColor("#00AEEF");
+        QString title = QStringLiteral("Peak Power Delivered");
+        QString xAxisLabel = QStringLiteral("SOC (%)");
+        QString yAxisLabel = QStringLiteral("Power (kW)");
+        QFont titleFont = QFont("Arial", 24, QFont::Bold);
+        QFont axisFont = QFont("Arial", 12);
+        QFont labelFont = QFont("Arial", 14);
+    };
+
+    static constexpr qreal TOP_MARGIN = 120;
+    static constexpr qreal BOTTOM_MARGIN = 80;
+    static constexpr qreal LEFT_MARGIN = 80;
+    static constexpr qreal RIGHT_MARGIN = 60;
+    static constexpr qreal LINE_WIDTH = 3.0;
+    static constexpr qreal POINT_RADIUS = 6.0;
+
+    static constexpr double FullMinSoc = 0.0;
+    static constexpr double FullMaxSoc = 100.0;
+    static constexpr double MinSocSpan = 0.01;
+
+    enum TextRole {
+        TitleText,
+        AxisText,
+        LabelText,
+        TextRoleCount
+    };
+
+    // Value labels of the data layer: SOC of the first and last point (the
+    // viewport bounds while zoomed), the power axis maximum, and the power
+    // of the first and last point.
+    enum ValueLabel {
+        FirstSocValue,
+        LastSocValue,
+        MaxPowerValue,
+        FirstPowerValue,
+        LastPowerValue,
+        ValueLabelCount
+    };
+
+    struct ValueText {
+        QString text;
+        QPointF origin;
+        bool visible = false;
+    };
+
+    GraphRenderer();
+
+    const QSharedPointer<RenderCache> &cache() const { return m_cache; }
+    void setCache(const QSharedPointer<RenderCache> &cache);
+
+    const Style &style() const { return m_style; }
+    void setStyle(const Style &style);
+
+    QSizeF size() const { return m_size; }
+    void setSize(const QSizeF &size);
+
+    // Quality switches of the data layer, turned off under load.
+    bool antialiasing() const { return m_antialiasing; }
+    void setAntialiasing(bool antialiasing) { m_antialiasing = antialiasing; }
+    bool fillEnabled() const { return m_fillEnabled; }
+    void setFillEnabled(bool fillEnabled) { m_fillEnabled = fillEnabled; }
+
+    // Visible SOC range. Anything narrower than the full 0-100 % range only
+    // maps the points inside it, found by binary search on the SOC-sorted
+    // snapshot, and clips the curve to the plot area.
+    double minSoc() const { return m_minSoc; }
+    double maxSoc() const { return m_maxSoc; }
+    void setSocRange(double minSoc, double maxSoc);
+    bool isZoomed() const;
+    // Index range [first, end) of the points inside the SOC range plus one
+    // neighbour on each side, so the curve reaches the plot edges.
+    void visibleRange(const DataSnapshot &snapshot, int *first, int *end) const;
+
+    QRectF plotArea() const;
+    PixelTransform pixelTransform(double peakPower) const;
+    QPointF mapDataToPixel(double soc, double power, double peakPower) const;
+    // Inverse of the X mapping: SOC under item coordinate x.
+    double socAt(qreal x) const;
+    static QString formatPowerValue(double power);
+    // Readout of the hover crosshair.
+    static QString formatHoverValue(const DataPoint &point);
+
+    // Ink width and bounds (relative to the baseline origin) of text in the
+    // font of role, from the layout cache.
+    int textWidth(TextRole role, const QString &text) const;
+    QRect textBounds(TextRole role, const QString &text) const;
+    // Draws text with its baseline starting at origin.
+    void drawText(QPainter *painter, TextRole role, const QPointF &origin, const QString &text) const;
+
+    // Baseline origins of the static labels.
+    QPointF titleOrigin() const;
+    QPointF xAxisLabelOrigin() const;
+    QPointF yAxisLabelOrigin() const;
+
+    // Maps the visible points of snapshot to item coordinates into pixels
+    // and returns how many points that was. With decimate set the points go
+    // through mapped and the M4 decimator, and chunks that fall into a single
+    // pixel column are taken from their summaries.
+    int mapPoints(const DataSnapshot &snapshot, double peakPower, qreal devicePixelRatio,
+                   bool decimate, Decimator &decimator,
+                   QVector<QPointF> &mapped, QVector<QPointF> &pixels) const;
+    // The same for the index range [first, end) under transform. It touches
+    // no renderer state, so geometry workers call it off the GUI thread.
+    // exactFrom receives the index from which every point has a mapped
+    // point of its own, after the last chunk taken from its summary.
+    static void mapRange(const DataSnapshot &snapshot, int first, int end, const PixelTransform &transform,
+                         qreal devicePixelRatio, bool decimate, Decimator &decimator,
+                         QVector<QPointF> &mapped, QVector<QPointF> &pixels, int *exactFrom = nullptr);
+
+    // Everything that depends only on size and style, rendered once per
+    // size/style/device pixel ratio and reused until one of them changes.
+    const QImage &chromeLayer(qreal devicePixelRatio) const;
+    void drawChrome(QPainter *painter) const;
+    // Everything that depends on the data. The curve and its fill start at
+    // pixelPoints[firstPixel]; callers repainting a clipped region pass the
+    // first point that can reach into it.
+    void drawData(QPainter *painter, const DataSnapshot &snapshot, double peakPower,
+                  const QVector<QPointF> &pixelPoints, int firstPixel = 0) const;
+    // Recomputed only when the end points, peak power, range, size or style
+    // changed since the last call.
+    void valueTexts(const DataSnapshot &snapshot, double peakPower, ValueText *texts) const;
+    // Pixel position of the first or last point; false while it is outside
+    // the SOC range.
+    bool endPointPixel(const DataSnapshot &snapshot, double peakPower, bool last, QPointF *pixel) const;
+    // Area covered by the marker and labels of the last point, which move
+    // with every appended sample.
+    QRectF lastPointRect(const DataSnapshot &snapshot, double peakPower) const;
+    // Area covered by the curve and fill from pixelPoints[from] on.
+    QRectF curveRect(const QVector<QPointF> &pixelPoints, int from) const;
+
+    // Fleet envelope behind the curve. mapEnvelope() gives the pixel
+    // positions of every bin's P10, P50 and P90 power, NaN y where no
+    // session covers the bin; drawEnvelope() fills the P10-P90 band and
+    // strokes the P50 line over each run of covered bins.
+    void mapEnvelope(const PowerEnvelope &envelope, double peakPower, QVector<QPointF> &lower,
+                     QVector<QPointF> &median, QVector<QPointF> &upper) const;
+    void drawEnvelope(QPainter *painter, const QVector<QPointF> &lower, const QVector<QPointF> &median,
+                      const QVector<QPointF> &upper) const;
+    QColor envelopeBandColor() const;
+    QColor envelopeLineColor() const;
+
+    void drawBackground(QPainter *painter) const;
+    void drawTitle(QPainter *painter) const;
+    void drawAxes(QPainter *painter) const;
+    void drawAxisLabels(QPainter *painter) const;
+    void drawArrows(QPainter *painter) const;
+    void drawAxisValues(QPainter *painter, const DataSnapshot &snapshot, double peakPower) const;
+    void drawGraph(QPainter *painter, const QVector<QPointF> &pixelPoints, int first = 0) const;
+    void drawEndPoints(QPainter *painter, const DataSnapshot &snapshot, double peakPower) const;
+
+private:
+    // Exact compare on purpose: any change of the inputs changes the text.
+    struct ValueTextsKey {
+        bool empty = true;
+        double firstSoc = 0.0;
+        double firstPower = 0.0;
+        double lastSoc = 0.0;
+        double lastPower = 0.0;
+        double peakPower = 0.0;
+        double minSoc = 0.0;
+        double maxSoc = 0.0;
+        QSizeF size;
+
+        bool operator==(const ValueTextsKey &other) const
+        {
+            return empty == other.empty && firstSoc == other.firstSoc && firstPower == other.firstPower
+                   && lastSoc == other.lastSoc && lastPower == other.lastPower && peakPower == other.peakPower
+                   && minSoc == other.minSoc && maxSoc == other.maxSoc && size == other.size;
+        }
+    };
+
+    const RenderCache::TextLayout &cachedText(TextRole role, const QString &text) const;
+    void computeValueTexts(const DataSnapshot &snapshot, double peakPower, ValueText *texts) const;
+    void updatePens();
+    void updateFontKeys();
+    const QFont &font(TextRole role) const;
+    QString chromeKey(qreal devicePixelRatio) const;
+
+    static bool mapChunkSummary(const DataSnapshot &snapshot, int chunk, const PixelTransform &transform,
+                                qreal devicePixelRatio, QPointF *out);
+
+    Style m_style;
+    QSizeF m_size;
+    double m_minSoc;
+    double m_maxSoc;
+    bool m_antialiasing;
+    bool m_fillEnabled;
+    QSharedPointer<RenderCache> m_cache;
+    QString m_fontKeys[TextRoleCount];
+    mutable QImage m_chromeLayer;
+
+    QPen m_curvePen;
+    QPen m_markerPen;
+    QPen m_linePen;
+    QPen m_textPen;
+    QBrush m_markerBrush;
+    QBrush m_fillBrush;
+    QPen m_envelopePen;
+    QBrush m_envelopeBrush;
+    mutable ScratchArena m_scratch;
+    mutable ValueTextsKey m_valueTextsKey;
+    mutable bool m_valueTextsValid;
+    mutable ValueText m_valueTexts[ValueLabelCount];
+};
+
+#endif // GRAPHRENDERER_H
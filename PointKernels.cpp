@@ -0,0 +1,241 @@
+#include "PointKernels.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POINTKERNELS_SSE2
+#endif
+
+static_assert(sizeof(QPointF) == 2 * sizeof(double), "mapToPixel writes QPointF as packed doubles");
+
+namespace {
+
+constexpr int LinearSearchThreshold = 32;
+constexpr int ResampleBlock = 256;
+
+#ifdef POINTKERNELS_SSE2
+
+template <typename T>
+struct Simd;
+
+template <>
+struct Simd<double>
+{
+    typedef __m128d Vector;
+    static constexpr int Lanes = 2;
+    static Vector load(const double *p) { return _mm_loadu_pd(p); }
+    static Vector splat(double v) { return _mm_set1_pd(v); }
+    static Vector min(Vector a, Vector b) { return _mm_min_pd(a, b); }
+    static Vector max(Vector a, Vector b) { return _mm_max_pd(a, b); }
+    static int lessMask(Vector a, Vector b) { return _mm_movemask_pd(_mm_cmplt_pd(a, b)); }
+    static void store(double *p, Vector v) { _mm_storeu_pd(p, v); }
+    static __m128d loadPair(const double *p) { return _mm_loadu_pd(p); }
+};
+
+template <>
+struct Simd<float>
+{
+    typedef __m128 Vector;
+    static constexpr int Lanes = 4;
+    static Vector load(const float *p) { return _mm_loadu_ps(p); }
+    static Vector splat(float v) { return _mm_set1_ps(v); }
+    static Vector min(Vector a, Vector b) { return _mm_min_ps(a, b); }
+    static Vector max(Vector a, Vector b) { return _mm_max_ps(a, b); }
+    static int lessMask(Vector a, Vector b) { return _mm_movemask_ps(_mm_cmplt_ps(a, b)); }
+    static void store(float *p, Vector v) { _mm_storeu_ps(p, v); }
+    static __m128d loadPair(const float *p)
+    {
+        return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p))));
+    }
+};
+
+typedef Simd<Sample> SampleSimd;
+
+int popCount(int mask)
+{
+    int count = 0;
+    for (; mask; mask &= mask - 1)
+        ++count;
+    return count;
+}
+
+#endif
+
+} // namespace
+
+void PointKernels::minMax(const Sample *values, int count, Sample *min, Sample *max)
+{
+    if (count <= 0)
+        return;
+
+    Sample lo = values[0];
+    Sample hi = values[0];
+    int i = 0;
+
+#ifdef POINTKERNELS_SSE2
+    constexpr int lanes = SampleSimd::Lanes;
+    if (count >= lanes) {
+        SampleSimd::Vector vmin = SampleSimd::splat(values[0]);
+        SampleSimd::Vector vmax = vmin;
+        for (; i + lanes <= count; i += lanes) {
+            const SampleSimd::Vector v = SampleSimd::load(values + i);
+            vmin = SampleSimd::min(vmin, v);
+            vmax = SampleSimd::max(vmax, v);
+        }
+        Sample lanesMin[lanes];
+        Sample lanesMax[lanes];
+        SampleSimd::store(lanesMin, vmin);
+        SampleSimd::store(lanesMax, vmax);
+        for (int lane = 0; lane < lanes; ++lane) {
+            lo = std::min(lo, lanesMin[lane]);
+            hi = std::max(hi, lanesMax[lane]);
+        }
+    }
+#endif
+
+    for (; i < count; ++i) {
+        lo = std::min(lo, values[i]);
+        hi = std::max(hi, values[i]);
+    }
+
+    *min = lo;
+    *max = hi;
+}
+
+int PointKernels::peakIndex(const Sample *values, int count)
+{
+    if (count <= 0)
+        return -1;
+
+    // A vectorized max pass followed by a search that stops at the first
+    // hit is cheaper than tracking the index in the hot loop.
+    Sample lo;
+    Sample hi;
+    minMax(values, count, &lo, &hi);
+    return int(std::find(values, values + count, hi) - values);
+}
+
+int PointKernels::lowerBound(const Sample *values, int count, double value)
+{
+    int first = 0;
+    int length = count;
+    while (length > LinearSearchThreshold) {
+        const int half = length / 2;
+        if (values[first + half] < value) {
+            first += half + 1;
+            length -= half + 1;
+        } else {
+            length = half;
+        }
+    }
+
+    // The remaining window is small enough to count the smaller elements
+    // directly, which avoids the unpredictable branches of the last steps.
+    int i = first;
+    const int end = first + length;
+#ifdef POINTKERNELS_SSE2
+    constexpr int lanes = SampleSimd::Lanes;
+    // Round the needle up to the storage type so the comparison keeps
+    // matching the double-precision one below for float samples.
+    Sample needleValue = Sample(value);
+    if (needleValue < value)
+        needleValue = std::nextafter(needleValue, std::numeric_limits<Sample>::infinity());
+    const SampleSimd::Vector needle = SampleSimd::splat(needleValue);
+    for (; i + lanes <= end; i += lanes) {
+        const int mask = SampleSimd::lessMask(SampleSimd::load(values + i), needle);
+        if (mask != (1 << lanes) - 1)
+            return i + popCount(mask);
+    }
+#endif
+    for (; i < end; ++i) {
+        if (!(values[i] < value))
+            return i;
+    }
+    return end;
+}
+
+void PointKernels::mapToPixel(const Sample *x, const Sample *y, int count,
+                              const PixelTransform &transform, QPointF *out)
+{
+    double *dst = reinterpret_cast<double *>(out);
+    int i = 0;
+
+#ifdef POINTKERNELS_SSE2
+    const __m128d xScale = _mm_set1_pd(transform.xScale);
+    const __m128d xOffset = _mm_set1_pd(transform.xOffset);
+    const __m128d yScale = _mm_set1_pd(transform.yScale);
+    const __m128d yOffset = _mm_set1_pd(transform.yOffset);
+    for (; i + 2 <= count; i += 2) {
+        const __m128d px = _mm_add_pd(_mm_mul_pd(SampleSimd::loadPair(x + i), xScale), xOffset);
+        const __m128d py = _mm_add_pd(_mm_mul_pd(SampleSimd::loadPair(y + i), yScale), yOffset);
+        _mm_storeu_pd(dst + 2 * i, _mm_unpacklo_pd(px, py));
+        _mm_storeu_pd(dst + 2 * i + 2, _mm_unpackhi_pd(px, py));
+    }
+#endif
+
+    for (; i < count; ++i) {
+        dst[2 * i] = x[i] * transform.xScale + transform.xOffset;
+        dst[2 * i + 1] = y[i] * transform.yScale + transform.yOffset;
+    }
+}
+
+void PointKernels::resample(const Sample *x, const Sample *y, int count, double start, double step,
+                            int gridCount, double *out, int *first, int *end)
+{
+    *first = 0;
+    *end = 0;
+    if (count <= 0 || gridCount <= 0 || !(step > 0))
+        return;
+
+    const double begin = std::ceil((x[0] - start) / step);
+    const double stop = std::floor((x[count - 1] - start) / step) + 1;
+    *first = int(qBound(0.0, begin, double(gridCount)));
+    *end = qMax(*first, int(qBound(0.0, stop, double(gridCount))));
+
+    // Per block, a merge walk (both sides are sorted) gathers the segment
+    // under each grid point, and a branch-free pass interpolates them.
+    double x0[ResampleBlock];
+    double y0[ResampleBlock];
+    double dx[ResampleBlock];
+    double dy[ResampleBlock];
+    int segment = 0;
+    for (int blockStart = *first; blockStart < *end; blockStart += ResampleBlock) {
+        const int n = qMin(ResampleBlock, *end - blockStart);
+        for (int i = 0; i < n; ++i) {
+            const double g = start + (blockStart + i) * step;
+            while (segment + 2 < count && x[segment + 1] <= g)
+                ++segment;
+            const int next = qMin(segment + 1, count - 1);
+            x0[i] = x[segment];
+            y0[i] = y[segment];
+            dx[i] = double(x[next]) - double(x[segment]);
+            dy[i] = double(y[next]) - double(y[segment]);
+        }
+
+        double *dst = out + blockStart;
+        int i = 0;
+#ifdef POINTKERNELS_SSE2
+        const __m128d vstart = _mm_set1_pd(start);
+        const __m128d vstep = _mm_set1_pd(step);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d one = _mm_set1_pd(1.0);
+        for (; i + 2 <= n; i += 2) {
+            const __m128d index = _mm_set_pd(double(blockStart + i + 1), double(blockStart + i));
+            const __m128d g = _mm_add_pd(vstart, _mm_mul_pd(index, vstep));
+            const __m128d width = _mm_loadu_pd(dx + i);
+            // Zero-width segments (repeated SOC) take their first value.
+            __m128d t = _mm_and_pd(_mm_cmpgt_pd(width, zero),
+                                   _mm_div_pd(_mm_sub_pd(g, _mm_loadu_pd(x0 + i)), width));
+            t = _mm_min_pd(_mm_max_pd(t, zero), one);
+            _mm_storeu_pd(dst + i, _mm_add_pd(_mm_loadu_pd(y0 + i), _mm_mul_pd(_mm_loadu_pd(dy + i), t)));
+        }
+#endif
+        for (; i < n; ++i) {
+            const double g = start + (blockStart + i) * step;
+            const double t = dx[i] > 0 ? qBound(0.0, (g - x0[i]) / dx[i], 1.0) : 0.0;
+            dst[i] = y0[i] + dy[i] * t;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef POINTKERNELS_H
+#define POINTKERNELS_H
+
+#include <QPointF>
+
+// Storage type of the columnar point store. Building with
+// GRAPH_FLOAT_SAMPLES halves the memory of stored sessions at the cost of
+// float precision (about 7 significant digits).
+#ifdef GRAPH_FLOAT_SAMPLES
+typedef float Sample;
+#else
+typedef double Sample;
+#endif
+
+// Affine data-to-pixel mapping: pixel = value * scale + offset per axis.
+struct PixelTransform
+{
+    double xScale;
+    double xOffset;
+    double yScale;
+    double yOffset;
+};
+
+// Scan kernels over contiguous sample columns. They use SSE2 where the
+// compiler targets it and plain loops written for auto-vectorization
+// elsewhere.
+namespace PointKernels
+{
+    void minMax(const Sample *values, int count, Sample *min, Sample *max);
+    int peakIndex(const Sample *values, int count);
+    // First index whose value is not less than value; values must be sorted.
+    int lowerBound(const Sample *values, int count, double value);
+    void mapToPixel(const Sample *x, const Sample *y, int count,
+                    const PixelTransform &transform, QPointF *out);
+    // Linear interpolation of the polyline through (x[i], y[i]), x sorted,
+    // at the grid points start + k * step for k in [0, gridCount). Only the
+    // grid points within [x[0], x[count - 1]] are written; their range
+    // [*first, *end) is returned.
+    void resample(const Sample *x, const Sample *y, int count, double start, double step,
+                  int gridCount, double *out, int *first, int *end);
+}
+
+#endif // POINTKERNELS_H
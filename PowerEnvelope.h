@@ -0,0 +1,22 @@
+#ifndef POWERENVELOPE_H
+#define POWERENVELOPE_H
+
+#include <QVector>
+
+// Percentile band of power over a fixed SOC grid: bin i stands for SOC
+// i * socStep. lower, median and upper are the P10, P50 and P90 power of
+// the sessions covering a bin, NaN where none does.
+struct PowerEnvelope
+{
+    double socStep = 0.0;
+    int sessionCount = 0;
+    double peakPower = 0.0;
+    QVector<double> lower;
+    QVector<double> median;
+    QVector<double> upper;
+
+    bool isEmpty() const { return lower.isEmpty(); }
+    int binCount() const { return lower.size(); }
+};
+
+#endif // POWERENVELOPE_H
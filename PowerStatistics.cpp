@@ -0,0 +1,107 @@
+#include "PowerStatistics.h"
+
+namespace {
+
+constexpr double MillisecondsPerHour = 3600.0 * 1000.0;
+
+} // namespace
+
+PowerStatistics::PowerStatistics(int window)
+    : m_window(qMax(1, window))
+{
+    reset();
+}
+
+void PowerStatistics::reset()
+{
+    m_count = 0;
+    m_maxWindow.clear();
+    m_minWindow.clear();
+    m_energyKWh = 0.0;
+    m_lastPower = 0.0;
+    m_lastTimestamp = 0;
+    m_meanSoc = 0.0;
+    m_meanPower = 0.0;
+    m_socVariance = 0.0;
+    m_socPowerCovariance = 0.0;
+    for (int band = 0; band < BandCount; ++band) {
+        m_bandCounts[band] = 0;
+        m_bandPowerSums[band] = 0.0;
+    }
+}
+
+void PowerStatistics::rebuild(const DataSnapshot &snapshot)
+{
+    reset();
+    for (int chunk = 0; chunk < snapshot.chunkCount(); ++chunk) {
+        const DataSnapshot::Columns columns = snapshot.columns(chunk);
+        for (int i = 0; i < snapshot.chunkSize(chunk); ++i)
+            append(columns.soc[i], columns.power[i], columns.timestamp[i]);
+    }
+}
+
+void PowerStatistics::setWindow(int window)
+{
+    m_window = qMax(1, window);
+}
+
+void PowerStatistics::append(double soc, double power, qint64 timestamp)
+{
+    const qint64 index = m_count++;
+
+    // Entries dominated by the new sample can never be the extreme again.
+    while (!m_maxWindow.empty() && m_maxWindow.back().power <= power)
+        m_maxWindow.pop_back();
+    m_maxWindow.push_back(WindowEntry{ index, power });
+    while (!m_minWindow.empty() && m_minWindow.back().power >= power)
+        m_minWindow.pop_back();
+    m_minWindow.push_back(WindowEntry{ index, power });
+
+    const qint64 oldest = index - m_window + 1;
+    while (m_maxWindow.front().index < oldest)
+        m_maxWindow.pop_front();
+    while (m_minWindow.front().index < oldest)
+        m_minWindow.pop_front();
+
+    // Samples without a usable time step (no timestamps, out of order) add
+    // no energy rather than a bogus one.
+    if (index > 0 && m_lastTimestamp > 0 && timestamp > m_lastTimestamp)
+        m_energyKWh += (m_lastPower + power) / 2 * (timestamp - m_lastTimestamp) / MillisecondsPerHour;
+    m_lastPower = power;
+    m_lastTimestamp = timestamp;
+
+    const double socDelta = soc - m_meanSoc;
+    m_meanSoc += socDelta / m_count;
+    m_meanPower += (power - m_meanPower) / m_count;
+    m_socVariance += socDelta * (soc - m_meanSoc);
+    m_socPowerCovariance += socDelta * (power - m_meanPower);
+
+    const int socBand = band(soc);
+    ++m_bandCounts[socBand];
+    m_bandPowerSums[socBand] += power;
+}
+
+double PowerStatistics::windowMaxPower() const
+{
+    return m_maxWindow.empty() ? 0.0 : m_maxWindow.front().power;
+}
+
+double PowerStatistics::windowMinPower() const
+{
+    return m_minWindow.empty() ? 0.0 : m_minWindow.front().power;
+}
+
+double PowerStatistics::powerSocSlope() const
+{
+    return m_socVariance > 0.0 ? m_socPowerCovariance / m_socVariance : 0.0;
+}
+
+int PowerStatistics::band(double soc)
+{
+    return qBound(0, int(soc * BandCount / 100.0), BandCount - 1);
+}
+
+double PowerStatistics::bandMeanPower(int band) const
+{
+    return m_bandCounts[band] > 0 ? m_bandPowerSums[band] / m_bandCounts[band] : 0.0;
+}
@@ -0,0 +1,75 @@
+#ifndef POWERSTATISTICS_H
+#define POWERSTATISTICS_H
+
+#include <QtGlobal>
+#include <deque>
+#include "DataSnapshot.h"
+
+// Aggregates of a charging session that are kept up to date sample by sample,
+// so that appends cost O(1) amortized no matter how long the session is:
+//
+//  - maximum and minimum power over the last window() samples, from
+//    monotonic deques (every sample is pushed and popped at most once)
+//  - delivered energy as the trapezoidal integral of power over the sample
+//    timestamps, in kWh
+//  - mean power and the least-squares slope of power over SOC, from running
+//    co-moments (Welford), which stay accurate over long sessions
+//  - a histogram over BandCount equal SOC bands with the sample count and
+//    mean power of each band
+//
+// Anything but an append (replacing or clearing points) goes through
+// rebuild(), which is a single pass over the snapshot.
+class PowerStatistics
+{
+public:
+    static constexpr int BandCount = 10;
+    static constexpr int DefaultWindow = 600;
+
+    explicit PowerStatistics(int window = DefaultWindow);
+
+    void reset();
+    void rebuild(const DataSnapshot &snapshot);
+    void append(double soc, double power, qint64 timestamp);
+
+    int window() const { return m_window; }
+    // Takes effect for the samples appended afterwards; callers that want the
+    // current window re-evaluated rebuild().
+    void setWindow(int window);
+
+    int count() const { return int(m_count); }
+    double windowMaxPower() const;
+    double windowMinPower() const;
+    double energyKWh() const { return m_energyKWh; }
+    double meanPower() const { return m_meanPower; }
+    // kW per percent of SOC; 0 until at least two distinct SOC values exist.
+    double powerSocSlope() const;
+
+    static int band(double soc);
+    int bandCount(int band) const { return m_bandCounts[band]; }
+    double bandMeanPower(int band) const;
+
+private:
+    struct WindowEntry {
+        qint64 index;
+        double power;
+    };
+
+    int m_window;
+    qint64 m_count;
+    std::deque<WindowEntry> m_maxWindow;
+    std::deque<WindowEntry> m_minWindow;
+
+    double m_energyKWh;
+    double m_lastPower;
+    qint64 m_lastTimestamp;
+
+    double m_meanSoc;
+    double m_meanPower;
+    double m_socVariance;
+    double m_socPowerCovariance;
+
+    int m_bandCounts[BandCount];
+    double m_bandPowerSums[BandCount];
+};
+
+#endif // POWERSTATISTICS_H
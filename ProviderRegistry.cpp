@@ -0,0 +1,47 @@
+#include "ProviderRegistry.h"
+#include "DataProvider.h"
+#include <QQmlEngine>
+
+ProviderRegistry::ProviderRegistry(QObject *parent)
+    : QObject{parent}
+{
+}
+
+QStringList ProviderRegistry::getChargerIds() const
+{
+    return m_providers.keys();
+}
+
+int ProviderRegistry::getCount() const
+{
+    return m_providers.size();
+}
+
+DataProvider *ProviderRegistry::provider(const QString &chargerId) const
+{
+    return m_providers.value(chargerId, nullptr);
+}
+
+DataProvider *ProviderRegistry::ensureProvider(const QString &chargerId)
+{
+    DataProvider *&provider = m_providers[chargerId];
+    if (provider)
+        return provider;
+
+    provider = new DataProvider(this);
+    provider->setObjectName(chargerId);
+    // Handed out to QML through invokables, which would otherwise give the
+    // engine ownership.
+    QQmlEngine::setObjectOwnership(provider, QQmlEngine::CppOwnership);
+    emit chargersChanged();
+    return provider;
+}
+
+void ProviderRegistry::removeProvider(const QString &chargerId)
+{
+    DataProvider *provider = m_providers.take(chargerId);
+    if (!provider)
+        return;
+    provider->deleteLater();
+    emit chargersChanged();
+}
@@ -0,0 +1,38 @@
+#ifndef PROVIDERREGISTRY_H
+#define PROVIDERREGISTRY_H
+
+#include <QObject>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+class DataProvider;
+
+// DataProviders of a multi-bay site keyed by charger ID, for the dashboard
+// grid. The registry owns the providers it creates.
+class ProviderRegistry : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QStringList chargerIds READ getChargerIds NOTIFY chargersChanged FINAL)
+    Q_PROPERTY(int count READ getCount NOTIFY chargersChanged FINAL)
+
+public:
+    explicit ProviderRegistry(QObject *parent = nullptr);
+
+    QStringList getChargerIds() const;
+    int getCount() const;
+
+    // Null if there is no provider for chargerId.
+    Q_INVOKABLE DataProvider *provider(const QString &chargerId) const;
+    // Returns the provider of chargerId, creating it on first use.
+    Q_INVOKABLE DataProvider *ensureProvider(const QString &chargerId);
+    Q_INVOKABLE void removeProvider(const QString &chargerId);
+
+signals:
+    void chargersChanged();
+
+private:
+    QMap<QString, DataProvider *> m_providers;
+};
+
+#endif // PROVIDERREGISTRY_H
@@ -0,0 +1,55 @@
+#include "QuantileSketch.h"
+#include <limits>
+
+QuantileSketch::QuantileSketch(int seriesCount, double min, double max)
+    : m_seriesCount(qMax(0, seriesCount))
+    , m_min(min)
+    , m_max(max > min ? max : min + 1.0)
+    , m_bucketsPerUnit(Buckets / (m_max - m_min))
+    , m_counts(m_seriesCount * Buckets, 0)
+    , m_totals(m_seriesCount, 0)
+{
+}
+
+void QuantileSketch::add(int series, double value)
+{
+    Q_ASSERT(series >= 0 && series < m_seriesCount);
+    // NaN lands in the first bucket rather than out of bounds.
+    const double position = (value - m_min) * m_bucketsPerUnit;
+    const int bucket = position >= 0 ? int(qMin(position, double(Buckets - 1))) : 0;
+    ++m_counts[series * Buckets + bucket];
+    ++m_totals[series];
+}
+
+void QuantileSketch::merge(const QuantileSketch &other)
+{
+    Q_ASSERT(other.m_seriesCount == m_seriesCount && other.m_min == m_min && other.m_max == m_max);
+    quint32 *counts = m_counts.data();
+    const quint32 *otherCounts = other.m_counts.constData();
+    for (int i = 0; i < m_counts.size(); ++i)
+        counts[i] += otherCounts[i];
+    quint32 *totals = m_totals.data();
+    const quint32 *otherTotals = other.m_totals.constData();
+    for (int i = 0; i < m_seriesCount; ++i)
+        totals[i] += otherTotals[i];
+}
+
+double QuantileSketch::quantile(int series, double q) const
+{
+    const quint32 total = m_totals.at(series);
+    if (total == 0)
+        return std::numeric_limits<double>::quiet_NaN();
+
+    // Values are taken as spread evenly over their bucket.
+    const double target = qBound(0.0, q, 1.0) * total;
+    const quint32 *counts = m_counts.constData() + series * Buckets;
+    double below = 0.0;
+    int bucket = 0;
+    for (; bucket < Buckets - 1; ++bucket) {
+        if (counts[bucket] > 0 && below + counts[bucket] >= target)
+            break;
+        below += counts[bucket];
+    }
+    const double fraction = counts[bucket] > 0 ? (target - below) / counts[bucket] : 1.0;
+    return m_min + (bucket + qBound(0.0, fraction, 1.0)) / m_bucketsPerUnit;
+}
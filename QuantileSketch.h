@@ -0,0 +1,42 @@
+#ifndef QUANTILESKETCH_H
+#define QUANTILESKETCH_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Streaming quantiles of many series at once (one per SOC bin of a fleet
+// envelope) as a fixed-range histogram of Buckets buckets per series. Adding
+// a value is one increment, and sketches over the same range merge by adding
+// their counts, so worker threads fill one each and combine them at the end.
+// A quantile is interpolated inside its bucket and is off by at most one
+// bucket width, (max - min) / Buckets; values outside the range count in the
+// first or last bucket.
+class QuantileSketch
+{
+public:
+    static constexpr int Buckets = 256;
+
+    QuantileSketch(int seriesCount, double min, double max);
+
+    int seriesCount() const { return m_seriesCount; }
+    double minimum() const { return m_min; }
+    double maximum() const { return m_max; }
+
+    void add(int series, double value);
+    // other must have the same series count and range.
+    void merge(const QuantileSketch &other);
+
+    quint32 count(int series) const { return m_totals.at(series); }
+    // q in [0, 1]; NaN for a series without values.
+    double quantile(int series, double q) const;
+
+private:
+    int m_seriesCount;
+    double m_min;
+    double m_max;
+    double m_bucketsPerUnit;
+    QVector<quint32> m_counts;
+    QVector<quint32> m_totals;
+};
+
+#endif // QUANTILESKETCH_H
@@ -0,0 +1,45 @@
+#include "RenderCache.h"
+#include <QFontMetrics>
+
+RenderCache::RenderCache()
+    : m_images(MaxImageKiB)
+{
+}
+
+const RenderCache::TextLayout &RenderCache::textLayout(const QString &fontKey, const QFont &font,
+                                                       const QString &text)
+{
+    QHash<QString, TextLayout> &layouts = m_textLayouts[fontKey];
+    auto it = layouts.constFind(text);
+    if (it != layouts.constEnd())
+        return *it;
+
+    if (layouts.size() >= MaxTextLayoutsPerFont)
+        layouts.clear();
+
+    const QFontMetrics metrics(font);
+    TextLayout layout;
+    layout.text.setText(text);
+    layout.text.setTextFormat(Qt::PlainText);
+    layout.text.prepare(QTransform(), font);
+    layout.ascent = metrics.ascent();
+    layout.bounds = metrics.boundingRect(text);
+    return *layouts.insert(text, layout);
+}
+
+QImage RenderCache::image(const QString &key) const
+{
+    const QImage *image = m_images.object(key);
+    return image ? *image : QImage();
+}
+
+void RenderCache::insertImage(const QString &key, const QImage &image)
+{
+    m_images.insert(key, new QImage(image), qMax<qsizetype>(1, image.sizeInBytes() / 1024));
+}
+
+void RenderCache::clear()
+{
+    m_textLayouts.clear();
+    m_images.clear();
+}
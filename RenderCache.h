@@ -0,0 +1,49 @@
+#ifndef RENDERCACHE_H
+#define RENDERCACHE_H
+
+#include <QCache>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <QStaticText>
+#include <QString>
+
+// Text layouts and rendered images shared by the GraphRenderers of one
+// window (FrameScheduler::renderCache()). Layouts are keyed by font and
+// text, images by everything that went into them, so a dashboard of
+// identically styled graphs lays out and rasterizes each string and chrome
+// layer once instead of once per graph.
+//
+// Not locked: its users must never run concurrently, which holds for the
+// items of one window (polish on the GUI thread, sync while it is blocked).
+class RenderCache
+{
+public:
+    struct TextLayout {
+        QStaticText text;
+        qreal ascent;
+        QRect bounds;
+    };
+
+    // Value labels change with the data, so both caches are bounded.
+    static constexpr int MaxTextLayoutsPerFont = 1024;
+    static constexpr int MaxImageKiB = 64 * 1024;
+
+    RenderCache();
+
+    // fontKey is QFont::key() of font, computed once by the caller.
+    const TextLayout &textLayout(const QString &fontKey, const QFont &font, const QString &text);
+
+    // Null if key is not cached.
+    QImage image(const QString &key) const;
+    void insertImage(const QString &key, const QImage &image);
+
+    void clear();
+
+private:
+    QHash<QString, QHash<QString, TextLayout>> m_textLayouts;
+    QCache<QString, QImage> m_images;
+};
+
+#endif // RENDERCACHE_H
@@ -0,0 +1,280 @@
+#include "ReplayController.h"
+#include "ReplaySource.h"
+#include "DataProvider.h"
+#include "Trace.h"
+#include <limits>
+
+namespace {
+
+constexpr qint64 ThroughputWindowMs = 500;
+constexpr qint64 Unbounded = std::numeric_limits<qint64>::max();
+
+} // namespace
+
+ReplayController::ReplayController(DataProvider *provider, QObject *parent)
+    : QObject{parent}
+    , m_provider(provider)
+    , m_bufferPos(0)
+    , m_position(0)
+    , m_rate(1.0)
+    , m_samplePeriod(1000)
+    , m_finished(false)
+    , m_anchorTime(0)
+    , m_throughputSamples(0)
+    , m_samplesPerSecond(0.0)
+{
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, &QTimer::timeout, this, &ReplayController::tick);
+}
+
+ReplayController::~ReplayController()
+{
+    close();
+}
+
+QString ReplayController::getSource() const
+{
+    return m_source;
+}
+
+bool ReplayController::isPlaying() const
+{
+    return m_timer.isActive();
+}
+
+bool ReplayController::isFinished() const
+{
+    return m_finished;
+}
+
+double ReplayController::getRate() const
+{
+    return m_rate;
+}
+
+void ReplayController::setRate(double newRate)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    newRate = qMax(0.0, newRate);
+    if (qFuzzyCompare(m_rate, newRate))
+        return;
+    m_rate = newRate;
+    if (isPlaying()) {
+        restartClock();
+        m_timer.start(m_rate > 0.0 ? TickIntervalMs : 0);
+    }
+    emit rateChanged();
+}
+
+int ReplayController::getSamplePeriod() const
+{
+    return m_samplePeriod;
+}
+
+void ReplayController::setSamplePeriod(int newSamplePeriod)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    newSamplePeriod = qMax(1, newSamplePeriod);
+    if (m_samplePeriod == newSamplePeriod)
+        return;
+    m_samplePeriod = newSamplePeriod;
+    if (isPlaying())
+        restartClock();
+    emit samplePeriodChanged();
+}
+
+int ReplayController::getPosition() const
+{
+    return m_position;
+}
+
+int ReplayController::getSampleCount() const
+{
+    return m_reader ? m_reader->size() : 0;
+}
+
+double ReplayController::getSamplesPerSecond() const
+{
+    return m_samplesPerSecond;
+}
+
+bool ReplayController::open(const QString &path)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    close();
+
+    QString errorString;
+    m_reader.reset(ReplaySource::open(path, &errorString));
+    if (!m_reader) {
+        emit errorOccurred(errorString);
+        return false;
+    }
+
+    m_source = path;
+    m_provider->stopRandomGeneration();
+    m_provider->clearData();
+    emit sourceChanged();
+    emit positionChanged();
+    return true;
+}
+
+void ReplayController::close()
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    pause();
+    if (!m_reader)
+        return;
+    m_reader.reset();
+    m_buffer.clear();
+    m_bufferPos = 0;
+    m_position = 0;
+    m_finished = false;
+    m_source.clear();
+    emit sourceChanged();
+    emit positionChanged();
+}
+
+void ReplayController::play()
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    if (!m_reader || m_finished || isPlaying())
+        return;
+    restartClock();
+    m_throughputSamples = 0;
+    m_throughputClock.start();
+    m_timer.start(m_rate > 0.0 ? TickIntervalMs : 0);
+    emit playingChanged();
+}
+
+void ReplayController::pause()
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    if (!isPlaying())
+        return;
+    m_timer.stop();
+    emit playingChanged();
+}
+
+bool ReplayController::seek(int index)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    if (!m_reader || index < 0)
+        return false;
+
+    // The provider shows everything up to the position, so going back means
+    // rebuilding from the start; going forward appends the skipped samples
+    // in bulk.
+    if (index < m_position) {
+        if (!m_reader->seek(0))
+            return false;
+        m_provider->clearData();
+        m_buffer.clear();
+        m_bufferPos = 0;
+        m_position = 0;
+        m_finished = false;
+    }
+    appendBatch(index - m_position, Unbounded);
+
+    if (isPlaying())
+        restartClock();
+    emit positionChanged();
+    return m_position == index;
+}
+
+int ReplayController::step(int count)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    if (!m_reader || count <= 0)
+        return 0;
+    const int appended = appendBatch(count, Unbounded);
+    if (isPlaying())
+        restartClock();
+    emit positionChanged();
+    return appended;
+}
+
+void ReplayController::tick()
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    int appended = 0;
+    if (m_rate > 0.0) {
+        const qint64 until = m_anchorTime + qint64(double(m_clock.elapsed()) * m_rate);
+        appended = appendBatch(std::numeric_limits<int>::max(), until);
+    } else {
+        QElapsedTimer budget;
+        budget.start();
+        do {
+            appended += appendBatch(BatchSize, Unbounded);
+        } while (!m_finished && budget.elapsed() < FastBudgetMs);
+    }
+
+    if (appended > 0)
+        emit positionChanged();
+    if (m_finished) {
+        updateThroughput(true);
+        pause();
+    } else {
+        updateThroughput(false);
+    }
+}
+
+bool ReplayController::fillBuffer()
+{
+    if (m_bufferPos < m_buffer.size())
+        return true;
+    m_buffer.resize(BatchSize);
+    m_buffer.resize(m_reader->read(m_buffer.data(), BatchSize));
+    m_bufferPos = 0;
+    return !m_buffer.isEmpty();
+}
+
+qint64 ReplayController::sampleTime(const DataPoint &point, int index) const
+{
+    return point.getTimestamp() != 0 ? point.getTimestamp() : qint64(index) * m_samplePeriod;
+}
+
+int ReplayController::appendBatch(int max, qint64 untilTime)
+{
+    int appended = 0;
+    while (appended < max) {
+        if (!fillBuffer()) {
+            m_finished = true;
+            break;
+        }
+
+        // Hand over the longest due run of the buffer in one call.
+        const int available = qMin(m_buffer.size() - m_bufferPos, max - appended);
+        int due = 0;
+        while (due < available && sampleTime(m_buffer.at(m_bufferPos + due), m_position + due) <= untilTime)
+            ++due;
+        if (due == 0)
+            break;
+
+        m_provider->appendPoints(m_buffer.constData() + m_bufferPos, due);
+        m_bufferPos += due;
+        m_position += due;
+        appended += due;
+    }
+    m_throughputSamples += appended;
+    return appended;
+}
+
+void ReplayController::restartClock()
+{
+    // Replay time is anchored at the next pending sample, so pauses, seeks
+    // and rate changes never cause a catch-up burst.
+    m_anchorTime = fillBuffer() ? sampleTime(m_buffer.at(m_bufferPos), m_position) : 0;
+    m_clock.start();
+}
+
+void ReplayController::updateThroughput(bool force)
+{
+    const qint64 elapsed = m_throughputClock.elapsed();
+    if (elapsed <= 0 || (!force && elapsed < ThroughputWindowMs))
+        return;
+    m_samplesPerSecond = double(m_throughputSamples) * 1000.0 / double(elapsed);
+    m_throughputSamples = 0;
+    m_throughputClock.restart();
+    GRAPH_TRACE_COUNTER(TraceIngest, "replaySamplesPerSecond", qRound64(m_samplesPerSecond));
+    emit samplesPerSecondChanged();
+}
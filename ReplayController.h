@@ -0,0 +1,98 @@
+#ifndef REPLAYCONTROLLER_H
+#define REPLAYCONTROLLER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QScopedPointer>
+#include <QTimer>
+#include <QVector>
+#include "DataPoint.h"
+
+class DataProvider;
+class ReplaySource;
+
+// Streams a recorded session or CSV log into a DataProvider at a multiple of
+// its recorded speed, or as fast as the GUI thread can absorb it (rate 0).
+// Samples are handed over in batches through DataProvider::appendPoints();
+// in the as-fast-as-possible mode every tick appends for a fixed time budget
+// and then yields to the event loop, so the rendering path keeps running
+// under full load. Samples without a timestamp are spaced samplePeriod ms
+// apart.
+class ReplayController : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString source READ getSource NOTIFY sourceChanged FINAL)
+    Q_PROPERTY(bool playing READ isPlaying NOTIFY playingChanged FINAL)
+    Q_PROPERTY(bool finished READ isFinished NOTIFY positionChanged FINAL)
+    Q_PROPERTY(double rate READ getRate WRITE setRate NOTIFY rateChanged FINAL)
+    Q_PROPERTY(int samplePeriod READ getSamplePeriod WRITE setSamplePeriod NOTIFY samplePeriodChanged FINAL)
+    Q_PROPERTY(int position READ getPosition NOTIFY positionChanged FINAL)
+    Q_PROPERTY(int sampleCount READ getSampleCount NOTIFY positionChanged FINAL)
+    Q_PROPERTY(double samplesPerSecond READ getSamplesPerSecond NOTIFY samplesPerSecondChanged FINAL)
+
+public:
+    static constexpr int TickIntervalMs = 16;
+    static constexpr int FastBudgetMs = 8;
+    static constexpr int BatchSize = 4096;
+
+    explicit ReplayController(DataProvider *provider, QObject *parent = nullptr);
+    ~ReplayController();
+
+    QString getSource() const;
+    bool isPlaying() const;
+    bool isFinished() const;
+
+    double getRate() const;
+    void setRate(double newRate);
+
+    int getSamplePeriod() const;
+    void setSamplePeriod(int newSamplePeriod);
+
+    int getPosition() const;
+    int getSampleCount() const;
+    double getSamplesPerSecond() const;
+
+    Q_INVOKABLE bool open(const QString &path);
+    Q_INVOKABLE void close();
+    Q_INVOKABLE void play();
+    Q_INVOKABLE void pause();
+    Q_INVOKABLE bool seek(int index);
+    Q_INVOKABLE int step(int count = 1);
+
+signals:
+    void sourceChanged();
+    void playingChanged();
+    void rateChanged();
+    void samplePeriodChanged();
+    void positionChanged();
+    void samplesPerSecondChanged();
+    void errorOccurred(const QString &message);
+
+private slots:
+    void tick();
+
+private:
+    bool fillBuffer();
+    qint64 sampleTime(const DataPoint &point, int index) const;
+    int appendBatch(int max, qint64 untilTime);
+    void restartClock();
+    void updateThroughput(bool force);
+
+    DataProvider *m_provider;
+    QScopedPointer<ReplaySource> m_reader;
+    QString m_source;
+    QTimer m_timer;
+    QElapsedTimer m_clock;
+    QVector<DataPoint> m_buffer;
+    int m_bufferPos;
+    int m_position;
+    double m_rate;
+    int m_samplePeriod;
+    bool m_finished;
+    qint64 m_anchorTime;
+    QElapsedTimer m_throughputClock;
+    qint64 m_throughputSamples;
+    double m_samplesPerSecond;
+};
+
+#endif // REPLAYCONTROLLER_H
@@ -0,0 +1,113 @@
+#include "ReplaySource.h"
+#include "SessionFile.h"
+#include "TelemetryReader.h"
+#include "Trace.h"
+
+ReplaySource *ReplaySource::open(const QString &path, QString *errorString)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    if (SessionFile::isSessionFile(path)) {
+        const QSharedPointer<SessionFile> session = SessionFile::open(path, errorString);
+        return session ? new SessionReplaySource(session) : nullptr;
+    }
+
+    CsvReplaySource *source = new CsvReplaySource(path);
+    if (!source->isOpen()) {
+        if (errorString)
+            *errorString = source->errorString();
+        delete source;
+        return nullptr;
+    }
+    return source;
+}
+
+SessionReplaySource::SessionReplaySource(const QSharedPointer<SessionFile> &session)
+    : m_session(session)
+    , m_position(0)
+{
+}
+
+int SessionReplaySource::read(DataPoint *out, int max)
+{
+    int count = 0;
+    while (count < max && m_position < m_session->pointCount()) {
+        // Every chunk but the last is full, so the chunk index is a division.
+        const int chunk = m_position / DataChunk::Capacity;
+        const int offset = m_position % DataChunk::Capacity;
+        const int n = qMin(max - count, m_session->chunkSize(chunk) - offset);
+        const Sample *soc = m_session->socData(chunk) + offset;
+        const Sample *power = m_session->powerData(chunk) + offset;
+        const qint64 *timestamp = m_session->timestampData(chunk) + offset;
+        for (int i = 0; i < n; ++i)
+            out[count + i] = DataPoint(soc[i], power[i], timestamp[i]);
+        count += n;
+        m_position += n;
+    }
+    return count;
+}
+
+bool SessionReplaySource::seek(int index)
+{
+    if (index < 0 || index > m_session->pointCount())
+        return false;
+    m_position = index;
+    return true;
+}
+
+int SessionReplaySource::size() const
+{
+    return m_session->pointCount();
+}
+
+CsvReplaySource::CsvReplaySource(const QString &path)
+    : m_file(path)
+    , m_position(0)
+    , m_size(-1)
+{
+    if (m_file.open(QIODevice::ReadOnly | QIODevice::Text))
+        m_checkpoints.append(0);
+}
+
+int CsvReplaySource::read(DataPoint *out, int max)
+{
+    int count = 0;
+    while (count < max && readSample(out + count))
+        ++count;
+    return count;
+}
+
+bool CsvReplaySource::seek(int index)
+{
+    if (index < 0 || (m_size >= 0 && index > m_size))
+        return false;
+
+    const int checkpoint = qMin(index / CheckpointInterval, m_checkpoints.size() - 1);
+    if (index < m_position || checkpoint > m_position / CheckpointInterval) {
+        if (!m_file.seek(m_checkpoints.at(checkpoint)))
+            return false;
+        m_position = checkpoint * CheckpointInterval;
+    }
+
+    DataPoint skipped;
+    while (m_position < index) {
+        if (!readSample(&skipped))
+            return false;
+    }
+    return true;
+}
+
+bool CsvReplaySource::readSample(DataPoint *point)
+{
+    while (!m_file.atEnd()) {
+        const qint64 lineStart = m_file.pos();
+        const QByteArray line = m_file.readLine();
+        if (!TelemetryReader::parseLine(line, point))
+            continue;
+        if (m_position % CheckpointInterval == 0 && m_position / CheckpointInterval == m_checkpoints.size())
+            m_checkpoints.append(lineStart);
+        ++m_position;
+        return true;
+    }
+    m_size = m_position;
+    return false;
+}
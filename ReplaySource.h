@@ -0,0 +1,75 @@
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include "DataPoint.h"
+
+class SessionFile;
+
+// Sequential, seekable reader over a recorded log. Nothing is loaded up
+// front: binary sessions are read straight from the memory map, CSV logs a
+// line at a time through a buffered QFile.
+class ReplaySource
+{
+public:
+    virtual ~ReplaySource() = default;
+
+    // Opens a binary session (detected by its magic) or a CSV/text log.
+    static ReplaySource *open(const QString &path, QString *errorString = nullptr);
+
+    // Reads up to max samples; returns fewer only at the end of the log.
+    virtual int read(DataPoint *out, int max) = 0;
+    // Positions the reader so the next read() returns sample index.
+    virtual bool seek(int index) = 0;
+    virtual int position() const = 0;
+    // Total number of samples, or -1 while a text log has not been read to
+    // the end yet.
+    virtual int size() const = 0;
+};
+
+class SessionReplaySource : public ReplaySource
+{
+public:
+    explicit SessionReplaySource(const QSharedPointer<SessionFile> &session);
+
+    int read(DataPoint *out, int max) override;
+    bool seek(int index) override;
+    int position() const override { return m_position; }
+    int size() const override;
+
+private:
+    QSharedPointer<SessionFile> m_session;
+    int m_position;
+};
+
+// Lines are parsed with TelemetryReader::parseLine. The byte offset of every
+// CheckpointInterval-th sample is remembered while reading, so seeking back
+// jumps to the nearest checkpoint and only re-parses the lines after it.
+class CsvReplaySource : public ReplaySource
+{
+public:
+    static constexpr int CheckpointInterval = 4096;
+
+    explicit CsvReplaySource(const QString &path);
+
+    bool isOpen() const { return m_file.isOpen(); }
+    QString errorString() const { return m_file.errorString(); }
+
+    int read(DataPoint *out, int max) override;
+    bool seek(int index) override;
+    int position() const override { return m_position; }
+    int size() const override { return m_size; }
+
+private:
+    bool readSample(DataPoint *point);
+
+    QFile m_file;
+    QVector<qint64> m_checkpoints;
+    int m_position;
+    int m_size;
+};
+
+#endif // REPLAYSOURCE_H
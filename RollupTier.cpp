@@ -0,0 +1,82 @@
+#include "RollupTier.h"
+#include <algorithm>
+
+RollupTier::RollupTier(qint64 interval, int capacity)
+    : m_interval(qMax<qint64>(1, interval))
+    , m_capacity(qMax(1, capacity))
+    , m_head(0)
+    , m_count(0)
+{
+}
+
+void RollupTier::clear()
+{
+    m_buckets.clear();
+    m_head = 0;
+    m_count = 0;
+}
+
+const RollupTier::Bucket &RollupTier::at(int index) const
+{
+    Q_ASSERT(index >= 0 && index < m_count);
+    return m_buckets.at((m_head + index) % m_buckets.size());
+}
+
+qint64 RollupTier::oldestStart() const
+{
+    return m_count > 0 ? at(0).start : 0;
+}
+
+void RollupTier::append(const DataPoint &point)
+{
+    const qint64 timestamp = point.getTimestamp();
+    if (timestamp <= 0)
+        return;
+
+    const qint64 start = timestamp - timestamp % m_interval;
+    if (m_count == 0 || start > at(m_count - 1).start) {
+        const Bucket bucket{ start, 1, point.getPower(), point, point, point, point };
+        // Until the ring is full it is appended to in order; after that the
+        // oldest bucket is overwritten.
+        if (m_buckets.size() < m_capacity) {
+            m_buckets.append(bucket);
+            ++m_count;
+        } else {
+            m_buckets[m_head] = bucket;
+            m_head = (m_head + 1) % m_capacity;
+        }
+        return;
+    }
+
+    Bucket &bucket = m_buckets[(m_head + m_count - 1) % m_buckets.size()];
+    ++bucket.count;
+    bucket.powerSum += point.getPower();
+    bucket.last = point;
+    if (point.getPower() < bucket.min.getPower())
+        bucket.min = point;
+    if (point.getPower() > bucket.max.getPower())
+        bucket.max = point;
+}
+
+void RollupTier::appendPoints(qint64 end, QVector<DataPoint> &out) const
+{
+    for (int index = 0; index < m_count; ++index) {
+        const Bucket &bucket = at(index);
+        if (bucket.first.getTimestamp() >= end)
+            break;
+
+        const DataPoint *picks[4] = { &bucket.first, &bucket.min, &bucket.max, &bucket.last };
+        std::stable_sort(picks, picks + 4, [](const DataPoint *a, const DataPoint *b) {
+            return a->getTimestamp() < b->getTimestamp();
+        });
+        const DataPoint *previous = nullptr;
+        for (const DataPoint *pick : picks) {
+            if (pick->getTimestamp() >= end)
+                break;
+            if (!previous || pick->getTimestamp() != previous->getTimestamp()
+                || pick->getPower() != previous->getPower())
+                out.append(*pick);
+            previous = pick;
+        }
+    }
+}
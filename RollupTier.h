@@ -0,0 +1,62 @@
+#ifndef ROLLUPTIER_H
+#define ROLLUPTIER_H
+
+#include <QtGlobal>
+#include <QVector>
+#include "DataPoint.h"
+
+// Fixed-interval min/max/mean rollup of a sample stream, kept in a ring of
+// at most capacity() buckets so memory stays bounded however long the
+// stream runs; the oldest bucket is dropped when a new one would not fit.
+// The ring grows with the stream, so a short session does not pay for the
+// full capacity up front.
+//
+// Besides the aggregates every bucket keeps its first, last, lowest and
+// highest sample, which is the M4 reduction of its interval: drawn in time
+// order they give the same picture as the raw samples at a resolution of
+// one bucket per pixel column.
+class RollupTier
+{
+public:
+    struct Bucket {
+        qint64 start;
+        int count;
+        double powerSum;
+        DataPoint first;
+        DataPoint last;
+        DataPoint min;
+        DataPoint max;
+
+        double meanPower() const { return count > 0 ? powerSum / count : 0.0; }
+    };
+
+    RollupTier(qint64 interval, int capacity);
+
+    qint64 interval() const { return m_interval; }
+    int capacity() const { return m_capacity; }
+
+    void clear();
+    // Samples without a timestamp cannot be bucketed and are ignored; late
+    // samples are folded into the newest bucket.
+    void append(const DataPoint &point);
+
+    // Buckets from oldest (0) to newest.
+    int size() const { return m_count; }
+    bool isEmpty() const { return m_count == 0; }
+    const Bucket &at(int index) const;
+    // Start of the oldest bucket still kept, 0 when empty.
+    qint64 oldestStart() const;
+
+    // Appends the M4 points of every bucket with samples before end (in
+    // time) to out, in time order.
+    void appendPoints(qint64 end, QVector<DataPoint> &out) const;
+
+private:
+    qint64 m_interval;
+    int m_capacity;
+    QVector<Bucket> m_buckets;
+    int m_head;
+    int m_count;
+};
+
+#endif // ROLLUPTIER_H
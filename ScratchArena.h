@@ -0,0 +1,86 @@
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <QtGlobal>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for memory that lives for one frame. allocate() hands out
+// uninitialized storage for trivial types and reset() releases all of it at
+// once. The memory itself is kept: after a frame that needed more than one
+// block, reset() replaces them with a single block of the combined size, so
+// a steady state paint path allocates nothing.
+class ScratchArena
+{
+public:
+    explicit ScratchArena(std::size_t initialSize = 16 * 1024)
+        : m_blockSize(initialSize)
+        , m_used(0)
+        , m_spill(0)
+    {
+    }
+
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    template <typename T>
+    T *allocate(int count)
+    {
+        static_assert(std::is_trivially_copyable<T>::value && std::is_trivially_destructible<T>::value,
+                      "ScratchArena never runs destructors");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned type");
+        const std::size_t bytes = roundUp(sizeof(T) * std::size_t(qMax(0, count)));
+        return static_cast<T *>(allocateBytes(bytes));
+    }
+
+    void reset()
+    {
+        if (m_spill > 0) {
+            m_blockSize += m_spill;
+            m_spill = 0;
+            m_blocks.clear();
+        }
+        m_used = 0;
+    }
+
+    std::size_t capacity() const { return m_blockSize; }
+
+private:
+    static std::size_t roundUp(std::size_t bytes)
+    {
+        constexpr std::size_t Align = alignof(std::max_align_t);
+        return (bytes + Align - 1) & ~(Align - 1);
+    }
+
+    static std::unique_ptr<std::max_align_t[]> makeBlock(std::size_t bytes)
+    {
+        return std::unique_ptr<std::max_align_t[]>(
+            new std::max_align_t[(bytes + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t)]);
+    }
+
+    void *allocateBytes(std::size_t bytes)
+    {
+        if (m_blocks.empty())
+            m_blocks.push_back(makeBlock(m_blockSize));
+
+        if (m_blocks.size() == 1 && m_used + bytes <= m_blockSize) {
+            char *memory = reinterpret_cast<char *>(m_blocks.front().get()) + m_used;
+            m_used += bytes;
+            return memory;
+        }
+
+        // Overflow for this frame; folded into the main block by reset().
+        m_blocks.push_back(makeBlock(bytes));
+        m_spill += bytes;
+        return m_blocks.back().get();
+    }
+
+    std::vector<std::unique_ptr<std::max_align_t[]>> m_blocks;
+    std::size_t m_blockSize;
+    std::size_t m_used;
+    std::size_t m_spill;
+};
+
+#endif // SCRATCHARENA_H
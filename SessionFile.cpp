@@ -0,0 +1,165 @@
+#include "SessionFile.h"
+#include "Trace.h"
+#include <climits>
+#include <cstring>
+
+namespace {
+
+qint64 alignColumn(qint64 bytes)
+{
+    return (bytes + 15) & ~qint64(15);
+}
+
+void setError(QString *errorString, const QString &message)
+{
+    if (errorString)
+        *errorString = message;
+}
+
+} // namespace
+
+const char SessionFile::Magic[8] = { 'F', 'C', 'S', 'E', 'S', 'S', 'N', '\0' };
+
+SessionFile::SessionFile()
+    : m_data(nullptr)
+    , m_index(nullptr)
+    , m_chunkCount(0)
+    , m_pointCount(0)
+{
+}
+
+SessionFile::~SessionFile()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+}
+
+QSharedPointer<SessionFile> SessionFile::open(const QString &path, QString *errorString)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    QSharedPointer<SessionFile> session(new SessionFile);
+    session->m_file.setFileName(path);
+    if (!session->m_file.open(QIODevice::ReadOnly)) {
+        setError(errorString, session->m_file.errorString());
+        return QSharedPointer<SessionFile>();
+    }
+    if (!session->map(errorString))
+        return QSharedPointer<SessionFile>();
+    return session;
+}
+
+bool SessionFile::isSessionFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray magic = file.read(sizeof(Magic));
+    return magic.size() == int(sizeof(Magic)) && std::memcmp(magic.constData(), Magic, sizeof(Magic)) == 0;
+}
+
+qint64 SessionFile::powerColumnOffset(int count)
+{
+    return alignColumn(qint64(count) * qint64(sizeof(Sample)));
+}
+
+qint64 SessionFile::timestampColumnOffset(int count)
+{
+    return 2 * powerColumnOffset(count);
+}
+
+qint64 SessionFile::blockBytes(int count)
+{
+    return timestampColumnOffset(count) + qint64(count) * qint64(sizeof(qint64));
+}
+
+const Sample *SessionFile::socData(int chunk) const
+{
+    return reinterpret_cast<const Sample *>(m_data + m_index[chunk].offset);
+}
+
+const Sample *SessionFile::powerData(int chunk) const
+{
+    const SessionChunkEntry &entry = m_index[chunk];
+    return reinterpret_cast<const Sample *>(m_data + entry.offset + powerColumnOffset(int(entry.size)));
+}
+
+const qint64 *SessionFile::timestampData(int chunk) const
+{
+    const SessionChunkEntry &entry = m_index[chunk];
+    return reinterpret_cast<const qint64 *>(m_data + entry.offset + timestampColumnOffset(int(entry.size)));
+}
+
+ChunkSummary SessionFile::chunkSummary(int chunk) const
+{
+    const SessionChunkEntry &entry = m_index[chunk];
+    return ChunkSummary{ Sample(entry.minSoc), Sample(entry.maxSoc),
+                         Sample(entry.minPower), Sample(entry.maxPower), 0 };
+}
+
+bool SessionFile::map(QString *errorString)
+{
+    const qint64 fileSize = m_file.size();
+    if (fileSize < qint64(sizeof(SessionFileHeader))) {
+        setError(errorString, QStringLiteral("File is too small to be a session"));
+        return false;
+    }
+
+    // The whole file is mapped once; nothing is read until a page is touched.
+    m_data = m_file.map(0, fileSize);
+    if (!m_data) {
+        setError(errorString, m_file.errorString());
+        return false;
+    }
+
+    SessionFileHeader header;
+    std::memcpy(&header, m_data, sizeof(header));
+    if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+        setError(errorString, QStringLiteral("Not a session file"));
+        return false;
+    }
+    if (header.version != Version) {
+        setError(errorString, QStringLiteral("Unsupported session version %1").arg(header.version));
+        return false;
+    }
+    if (header.sampleBytes != sizeof(Sample) || header.chunkCapacity != quint32(DataChunk::Capacity)) {
+        setError(errorString, QStringLiteral("Session was written with a different sample layout"));
+        return false;
+    }
+    if (header.indexOffset == 0) {
+        setError(errorString, QStringLiteral("Session was not finalized"));
+        return false;
+    }
+    if (header.pointCount > quint64(INT_MAX) || header.chunkCount > quint32(INT_MAX)
+        || header.indexOffset % alignof(SessionChunkEntry) != 0
+        || header.indexOffset > quint64(fileSize)
+        || quint64(fileSize) - header.indexOffset < quint64(header.chunkCount) * sizeof(SessionChunkEntry)) {
+        setError(errorString, QStringLiteral("Session index is out of bounds"));
+        return false;
+    }
+
+    m_index = reinterpret_cast<const SessionChunkEntry *>(m_data + header.indexOffset);
+    m_chunkCount = int(header.chunkCount);
+
+    // Validating the index is O(chunks) and never touches sample pages.
+    quint64 points = 0;
+    for (int chunk = 0; chunk < m_chunkCount; ++chunk) {
+        const SessionChunkEntry &entry = m_index[chunk];
+        const bool last = chunk == m_chunkCount - 1;
+        if (entry.size == 0 || entry.size > header.chunkCapacity
+            || (!last && entry.size != header.chunkCapacity)
+            || entry.offset % 16 != 0
+            || entry.offset > header.indexOffset
+            || header.indexOffset - entry.offset < quint64(blockBytes(int(entry.size)))) {
+            setError(errorString, QStringLiteral("Session chunk %1 is corrupt").arg(chunk));
+            return false;
+        }
+        points += entry.size;
+    }
+    if (points != header.pointCount) {
+        setError(errorString, QStringLiteral("Session point count does not match its index"));
+        return false;
+    }
+
+    m_pointCount = int(points);
+    return true;
+}
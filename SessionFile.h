@@ -0,0 +1,93 @@
+#ifndef SESSIONFILE_H
+#define SESSIONFILE_H
+
+#include <QFile>
+#include <QSharedPointer>
+#include <QString>
+#include "DataChunk.h"
+
+// On-disk layout of a recorded charging session (native byte order):
+//
+//   SessionFileHeader                      64 bytes
+//   chunk blocks, each 64-byte aligned:
+//     Sample soc[size]                     padded to 16 bytes
+//     Sample power[size]                   padded to 16 bytes
+//     qint64 timestamp[size]
+//   SessionChunkEntry[chunkCount]          at header.indexOffset
+//
+// Blocks hold DataChunk::Capacity points each except the last one, so the
+// columns can be used in place as snapshot chunks. indexOffset stays 0 until
+// the writer finalizes the file.
+struct SessionFileHeader
+{
+    char magic[8];
+    quint32 version;
+    quint32 sampleBytes;
+    quint32 chunkCapacity;
+    quint32 chunkCount;
+    quint64 pointCount;
+    quint64 indexOffset;
+    quint8 reserved[24];
+};
+
+struct SessionChunkEntry
+{
+    quint64 offset;
+    quint32 size;
+    quint32 reserved;
+    double minSoc;
+    double maxSoc;
+    double minPower;
+    double maxPower;
+    qint64 firstTimestamp;
+    qint64 lastTimestamp;
+};
+
+static_assert(sizeof(SessionFileHeader) == 64, "session header layout changed");
+static_assert(sizeof(SessionChunkEntry) == 64, "session index layout changed");
+
+// Read-only, memory-mapped view of a session file. Opening only validates the
+// header and the chunk index; sample pages are faulted in by the OS when a
+// column is first read.
+class SessionFile
+{
+public:
+    static constexpr quint32 Version = 1;
+    static const char Magic[8];
+
+    ~SessionFile();
+
+    static QSharedPointer<SessionFile> open(const QString &path, QString *errorString = nullptr);
+    // True if path starts with the session magic; anything else is a text log.
+    static bool isSessionFile(const QString &path);
+
+    // Byte offsets of the columns inside a block of count points.
+    static qint64 powerColumnOffset(int count);
+    static qint64 timestampColumnOffset(int count);
+    static qint64 blockBytes(int count);
+
+    QString fileName() const { return m_file.fileName(); }
+    int pointCount() const { return m_pointCount; }
+    int chunkCount() const { return m_chunkCount; }
+
+    int chunkSize(int chunk) const { return int(m_index[chunk].size); }
+    const Sample *socData(int chunk) const;
+    const Sample *powerData(int chunk) const;
+    const qint64 *timestampData(int chunk) const;
+    ChunkSummary chunkSummary(int chunk) const;
+    const SessionChunkEntry &chunkEntry(int chunk) const { return m_index[chunk]; }
+
+private:
+    SessionFile();
+    Q_DISABLE_COPY(SessionFile)
+
+    bool map(QString *errorString);
+
+    QFile m_file;
+    const uchar *m_data;
+    const SessionChunkEntry *m_index;
+    int m_chunkCount;
+    int m_pointCount;
+};
+
+#endif // SESSIONFILE_H
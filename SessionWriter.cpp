@@ -0,0 +1,217 @@
+#include "SessionWriter.h"
+#include "DataProvider.h"
+#include "Trace.h"
+#include <cstring>
+
+namespace {
+
+constexpr qint64 BlockAlignment = 64;
+
+bool writePadded(QFile &file, const void *data, qint64 bytes, qint64 paddedBytes)
+{
+    static const char zeros[64] = {};
+    if (file.write(static_cast<const char *>(data), bytes) != bytes)
+        return false;
+    for (qint64 left = paddedBytes - bytes; left > 0; left -= qint64(sizeof(zeros))) {
+        const qint64 n = qMin(left, qint64(sizeof(zeros)));
+        if (file.write(zeros, n) != n)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+SessionWriter::SessionWriter(DataProvider *provider, QObject *parent)
+    : QObject{parent}
+    , m_provider(provider)
+    , m_recordedPoints(0)
+{
+}
+
+SessionWriter::~SessionWriter()
+{
+    stop();
+}
+
+bool SessionWriter::isRecording() const
+{
+    return m_file.isOpen();
+}
+
+QString SessionWriter::fileName() const
+{
+    return m_file.fileName();
+}
+
+QString SessionWriter::errorString() const
+{
+    return m_errorString;
+}
+
+bool SessionWriter::start(const QString &path)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    stop();
+
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Truncate))
+        return fail(m_file.errorString());
+
+    connect(m_provider, &DataProvider::pointsAppended, this, &SessionWriter::onPointsAppended);
+    connect(m_provider, &DataProvider::pointsReplaced, this, &SessionWriter::onPointsReplaced);
+    connect(m_provider, &DataProvider::pointsReset, this, &SessionWriter::onDataReset);
+    connect(m_provider, &DataProvider::pointsTrimmed, this, &SessionWriter::onPointsTrimmed);
+    emit recordingChanged();
+    return restart();
+}
+
+bool SessionWriter::stop()
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    if (!m_file.isOpen())
+        return true;
+
+    disconnect(m_provider, nullptr, this, nullptr);
+
+    bool ok = flushChunk();
+    if (ok) {
+        const qint64 indexOffset = m_file.size();
+        const qint64 indexBytes = qint64(m_index.size()) * qint64(sizeof(SessionChunkEntry));
+        ok = m_file.seek(indexOffset)
+             && m_file.write(reinterpret_cast<const char *>(m_index.constData()), indexBytes) == indexBytes
+             && writeHeader(quint64(indexOffset));
+    }
+    if (!ok)
+        m_errorString = m_file.errorString();
+
+    m_file.close();
+    m_pending.reset();
+    m_index.clear();
+    m_recordedPoints = 0;
+    emit recordingChanged();
+    return ok;
+}
+
+void SessionWriter::onPointsAppended(int first, int count)
+{
+    Q_UNUSED(count)
+    if (first != m_recordedPoints) {
+        restart();
+        return;
+    }
+    const DataSnapshot snapshot = m_provider->snapshot();
+    writeFrom(snapshot, first, snapshot.size());
+}
+
+void SessionWriter::onPointsReplaced(int first, int count)
+{
+    // Late samples land in the provider's newest chunks, which are usually
+    // still the pending block here. Points appended along with them follow
+    // in onPointsAppended().
+    const int pendingStart = m_recordedPoints - m_pending->size();
+    if (first < pendingStart || first + count != m_recordedPoints) {
+        restart();
+        return;
+    }
+    m_pending.reset(new DataChunk);
+    writeFrom(m_provider->snapshot(), pendingStart, m_recordedPoints);
+}
+
+void SessionWriter::onDataReset()
+{
+    restart();
+}
+
+void SessionWriter::onPointsTrimmed(int count)
+{
+    // The recording keeps the dropped samples; only the provider's indexes
+    // of the remaining ones moved.
+    m_recordedPoints -= count;
+}
+
+bool SessionWriter::restart()
+{
+    // Drop everything written so far and record the provider's current data
+    // again; the header stays unfinalized until stop().
+    m_index.clear();
+    m_pending.reset(new DataChunk);
+    m_recordedPoints = 0;
+    if (!m_file.resize(0) || !m_file.seek(0) || !writeHeader(0))
+        return fail(m_file.errorString());
+    const DataSnapshot snapshot = m_provider->snapshot();
+    return writeFrom(snapshot, 0, snapshot.size());
+}
+
+bool SessionWriter::writeFrom(const DataSnapshot &snapshot, int first, int end)
+{
+    GRAPH_TRACE_FUNCTION(TraceData);
+    for (int i = first; i < end; ++i) {
+        m_pending->append(snapshot.at(i));
+        if (m_pending->isFull() && !flushChunk())
+            return fail(m_file.errorString());
+    }
+    m_recordedPoints = end;
+    return true;
+}
+
+bool SessionWriter::flushChunk()
+{
+    const int count = m_pending ? m_pending->size() : 0;
+    if (count == 0)
+        return true;
+
+    const qint64 end = m_file.size();
+    const qint64 offset = (end + BlockAlignment - 1) / BlockAlignment * BlockAlignment;
+    const qint64 columnBytes = qint64(count) * qint64(sizeof(Sample));
+    const qint64 paddedColumnBytes = SessionFile::powerColumnOffset(count);
+    const qint64 timestampBytes = qint64(count) * qint64(sizeof(qint64));
+    if (!m_file.seek(end) || !writePadded(m_file, nullptr, 0, offset - end)
+        || !writePadded(m_file, m_pending->socData(), columnBytes, paddedColumnBytes)
+        || !writePadded(m_file, m_pending->powerData(), columnBytes, paddedColumnBytes)
+        || !writePadded(m_file, m_pending->timestampData(), timestampBytes, timestampBytes)) {
+        return false;
+    }
+
+    const ChunkSummary &summary = m_pending->summary();
+    SessionChunkEntry entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.offset = quint64(offset);
+    entry.size = quint32(count);
+    entry.minSoc = summary.minSoc;
+    entry.maxSoc = summary.maxSoc;
+    entry.minPower = summary.minPower;
+    entry.maxPower = summary.maxPower;
+    entry.firstTimestamp = m_pending->timestampData()[0];
+    entry.lastTimestamp = m_pending->timestampData()[count - 1];
+    m_index.append(entry);
+
+    m_pending.reset(new DataChunk);
+    return true;
+}
+
+bool SessionWriter::writeHeader(quint64 indexOffset)
+{
+    SessionFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SessionFile::Magic, sizeof(header.magic));
+    header.version = SessionFile::Version;
+    header.sampleBytes = sizeof(Sample);
+    header.chunkCapacity = DataChunk::Capacity;
+    header.chunkCount = quint32(m_index.size());
+    for (const SessionChunkEntry &entry : m_index)
+        header.pointCount += entry.size;
+    header.indexOffset = indexOffset;
+
+    const qint64 position = m_file.pos();
+    const bool ok = m_file.seek(0)
+                    && m_file.write(reinterpret_cast<const char *>(&header), sizeof(header)) == qint64(sizeof(header));
+    return m_file.seek(qMax(position, qint64(sizeof(header)))) && ok;
+}
+
+bool SessionWriter::fail(const QString &message)
+{
+    m_errorString = message;
+    emit errorOccurred(message);
+    return false;
+}
@@ -0,0 +1,61 @@
+#ifndef SESSIONWRITER_H
+#define SESSIONWRITER_H
+
+#include <QObject>
+#include <QFile>
+#include <QScopedPointer>
+#include <QVector>
+#include "DataChunk.h"
+#include "SessionFile.h"
+
+class DataProvider;
+class DataSnapshot;
+
+// Streams a live DataProvider into a SessionFile. Appends are buffered in a
+// DataChunk and written a full block at a time. Points replaced within that
+// block are rewritten in it; replacing written ones, or a reset, restarts the
+// recording from the provider's current contents. The file can be opened
+// once stop() has written the chunk index.
+class SessionWriter : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool recording READ isRecording NOTIFY recordingChanged FINAL)
+    Q_PROPERTY(QString fileName READ fileName NOTIFY recordingChanged FINAL)
+
+public:
+    explicit SessionWriter(DataProvider *provider, QObject *parent = nullptr);
+    ~SessionWriter();
+
+    bool isRecording() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    Q_INVOKABLE bool start(const QString &path);
+    Q_INVOKABLE bool stop();
+
+signals:
+    void recordingChanged();
+    void errorOccurred(const QString &message);
+
+private slots:
+    void onPointsAppended(int first, int count);
+    void onPointsReplaced(int first, int count);
+    void onDataReset();
+    void onPointsTrimmed(int count);
+
+private:
+    bool restart();
+    bool writeFrom(const DataSnapshot &snapshot, int first, int end);
+    bool flushChunk();
+    bool writeHeader(quint64 indexOffset);
+    bool fail(const QString &message);
+
+    DataProvider *m_provider;
+    QFile m_file;
+    QScopedPointer<DataChunk> m_pending;
+    QVector<SessionChunkEntry> m_index;
+    int m_recordedPoints;
+    QString m_errorString;
+};
+
+#endif // SESSIONWRITER_H
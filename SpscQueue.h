@@ -0,0 +1,75 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <QVector>
+#include <atomic>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Each side keeps a cached copy of the other side's index so the
+// shared atomics are only touched when the cache says the queue looks full
+// (producer) or empty (consumer).
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(int capacity)
+    {
+        int size = 2;
+        while (size < capacity)
+            size <<= 1;
+        m_buffer.resize(size);
+        m_mask = quint64(size - 1);
+    }
+
+    int capacity() const { return m_buffer.size(); }
+
+    // Producer side.
+    bool tryPush(const T &value)
+    {
+        const quint64 tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead > m_mask) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead > m_mask)
+                return false;
+        }
+        m_buffer[int(tail & m_mask)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Pops up to maxCount items into out and returns how many.
+    int popInto(T *out, int maxCount)
+    {
+        const quint64 head = m_head.load(std::memory_order_relaxed);
+        if (m_cachedTail == head)
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+
+        const int count = int(qMin<quint64>(m_cachedTail - head, quint64(maxCount)));
+        for (int i = 0; i < count; ++i)
+            out[i] = m_buffer.at(int((head + quint64(i)) & m_mask));
+        m_head.store(head + quint64(count), std::memory_order_release);
+        return count;
+    }
+
+    bool tryPop(T &value) { return popInto(&value, 1) == 1; }
+
+    // Approximate from either side; exact only on the consumer thread.
+    int sizeApprox() const
+    {
+        return int(m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire));
+    }
+
+private:
+    Q_DISABLE_COPY(SpscQueue)
+
+    QVector<T> m_buffer;
+    quint64 m_mask;
+
+    alignas(64) std::atomic<quint64> m_head { 0 };
+    quint64 m_cachedTail = 0;
+
+    alignas(64) std::atomic<quint64> m_tail { 0 };
+    quint64 m_cachedHead = 0;
+};
+
+#endif // SPSCQUEUE_H
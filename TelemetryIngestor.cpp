@@ -0,0 +1,145 @@
+#include "TelemetryIngestor.h"
+#include "TelemetryReader.h"
+#include "DataProvider.h"
+#include "Trace.h"
+#include <QQuickWindow>
+#include <QTimer>
+
+TelemetryIngestor::TelemetryIngestor(DataProvider *provider, QObject *parent)
+    : QObject{parent}
+    , m_provider(provider)
+    , m_queue(QueueCapacity)
+    , m_reader(nullptr)
+    , m_drainScheduled(false)
+    , m_drainedThisFrame(false)
+    , m_lastBatchSize(0)
+    , m_totalSamples(0)
+{
+    m_batch.resize(m_queue.capacity());
+}
+
+TelemetryIngestor::~TelemetryIngestor()
+{
+    stop();
+}
+
+void TelemetryIngestor::setFrameWindow(QQuickWindow *window)
+{
+    if (m_window == window)
+        return;
+    if (m_window)
+        disconnect(m_window, nullptr, this, nullptr);
+    m_window = window;
+    m_drainedThisFrame = false;
+    if (m_window)
+        connect(m_window, &QQuickWindow::afterAnimating, this, &TelemetryIngestor::onAfterAnimating);
+}
+
+bool TelemetryIngestor::isRunning() const
+{
+    return m_reader && m_reader->isRunning();
+}
+
+QString TelemetryIngestor::getSource() const
+{
+    return m_reader ? m_reader->source() : QString();
+}
+
+int TelemetryIngestor::getLastBatchSize() const
+{
+    return m_lastBatchSize;
+}
+
+qint64 TelemetryIngestor::getTotalSamples() const
+{
+    return m_totalSamples;
+}
+
+bool TelemetryIngestor::start(const QString &source)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    stop();
+    if (source.isEmpty() || !m_provider)
+        return false;
+
+    m_reader = new TelemetryReader(source, &m_queue, this);
+    connect(m_reader, &TelemetryReader::samplesAvailable,
+            this, &TelemetryIngestor::onSamplesAvailable, Qt::QueuedConnection);
+    connect(m_reader, &TelemetryReader::errorOccurred,
+            this, &TelemetryIngestor::errorOccurred, Qt::QueuedConnection);
+    connect(m_reader, &QThread::finished, this, &TelemetryIngestor::runningChanged);
+    m_reader->start();
+    emit runningChanged();
+    return true;
+}
+
+void TelemetryIngestor::stop()
+{
+    if (!m_reader)
+        return;
+
+    m_reader->requestInterruption();
+    m_reader->wait();
+    drain();
+    delete m_reader;
+    m_reader = nullptr;
+    emit runningChanged();
+}
+
+void TelemetryIngestor::onSamplesAvailable()
+{
+    if (m_drainScheduled)
+        return;
+    m_drainScheduled = true;
+
+    // Once per frame: after a drain the next one waits until the frame
+    // window has animated, and a frame is requested in case nothing else
+    // asks for one. Without a window (headless use) it runs once the event
+    // loop is idle.
+    if (m_drainedThisFrame && m_window && m_window->isVisible())
+        m_window->requestUpdate();
+    else
+        QTimer::singleShot(0, this, &TelemetryIngestor::drain);
+}
+
+void TelemetryIngestor::onAfterAnimating()
+{
+    // Items are polished by now, so the deferred drain goes through the
+    // event loop to land before the next frame's polish.
+    m_drainedThisFrame = false;
+    if (m_drainScheduled)
+        QTimer::singleShot(0, this, &TelemetryIngestor::drain);
+}
+
+void TelemetryIngestor::drain()
+{
+    if (!m_drainScheduled && (!m_reader || m_queue.sizeApprox() == 0))
+        return;
+
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    m_drainScheduled = false;
+    m_drainedThisFrame = m_window && m_window->isVisible();
+    if (m_reader)
+        m_reader->acknowledgeWake();
+
+    // The batch buffer is as large as the queue, so this is normally a
+    // single append; the loop only repeats if the reader refilled the queue
+    // while we were appending.
+    int total = 0;
+    int popped = 0;
+    do {
+        popped = m_queue.popInto(m_batch.data(), m_batch.size());
+        if (popped > 0) {
+            m_provider->appendPoints(m_batch.constData(), popped);
+            total += popped;
+        }
+    } while (popped == m_batch.size());
+
+    if (total == 0)
+        return;
+
+    m_lastBatchSize = total;
+    m_totalSamples += total;
+    GRAPH_TRACE_COUNTER(TraceIngest, "telemetryBatch", total);
+    emit batchApplied(total);
+}
@@ -0,0 +1,69 @@
+#ifndef TELEMETRYINGESTOR_H
+#define TELEMETRYINGESTOR_H
+
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include "DataPoint.h"
+#include "SpscQueue.h"
+
+class DataProvider;
+class QQuickWindow;
+class TelemetryReader;
+
+// GUI-side half of the telemetry pipeline. A TelemetryReader thread fills
+// the queue; the ingestor drains it at most once per frame of the frame
+// window and hands everything that arrived to DataProvider::appendPoints()
+// as one batch, so a burst of samples costs one append notification and one
+// repaint. The drain runs from the event loop, never from a frame: the
+// window emits afterAnimating only after items are polished, so a batch
+// appended there would miss that frame's mapping.
+class TelemetryIngestor : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(bool running READ isRunning NOTIFY runningChanged FINAL)
+    Q_PROPERTY(QString source READ getSource NOTIFY runningChanged FINAL)
+    Q_PROPERTY(int lastBatchSize READ getLastBatchSize NOTIFY batchApplied FINAL)
+    Q_PROPERTY(qint64 totalSamples READ getTotalSamples NOTIFY batchApplied FINAL)
+
+public:
+    static constexpr int QueueCapacity = 16384;
+
+    explicit TelemetryIngestor(DataProvider *provider, QObject *parent = nullptr);
+    ~TelemetryIngestor();
+
+    void setFrameWindow(QQuickWindow *window);
+
+    bool isRunning() const;
+    QString getSource() const;
+    int getLastBatchSize() const;
+    qint64 getTotalSamples() const;
+
+    Q_INVOKABLE bool start(const QString &source);
+    Q_INVOKABLE void stop();
+
+signals:
+    void runningChanged();
+    void batchApplied(int count);
+    void errorOccurred(const QString &message);
+
+private slots:
+    void onSamplesAvailable();
+    void onAfterAnimating();
+    void drain();
+
+private:
+    DataProvider *m_provider;
+    QPointer<QQuickWindow> m_window;
+    SpscQueue<DataPoint> m_queue;
+    TelemetryReader *m_reader;
+    QVector<DataPoint> m_batch;
+    bool m_drainScheduled;
+    // A drain ran since the frame window last animated; the next one waits
+    // for that frame.
+    bool m_drainedThisFrame;
+    int m_lastBatchSize;
+    qint64 m_totalSamples;
+};
+
+#endif // TELEMETRYINGESTOR_H
@@ -0,0 +1,208 @@
+#include "TelemetryReader.h"
+#include "Trace.h"
+#include <QLocalSocket>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QList>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr int PollIntervalMs = 50;
+constexpr int ReadBufferSize = 64 * 1024;
+
+} // namespace
+
+TelemetryReader::TelemetryReader(const QString &source, SpscQueue<DataPoint> *queue, QObject *parent)
+    : QThread{parent}
+    , m_source(source)
+    , m_queue(queue)
+    , m_wakePending(false)
+{
+}
+
+TelemetryReader::~TelemetryReader()
+{
+    requestInterruption();
+    wait();
+}
+
+QString TelemetryReader::source() const
+{
+    return m_source;
+}
+
+void TelemetryReader::acknowledgeWake()
+{
+    m_wakePending.store(false, std::memory_order_release);
+}
+
+bool TelemetryReader::parseLine(const QByteArray &line, DataPoint *point)
+{
+    QByteArray text = line.trimmed();
+    const int comment = text.indexOf('#');
+    if (comment >= 0)
+        text.truncate(comment);
+    if (text.isEmpty())
+        return false;
+
+    text.replace(';', ' ');
+    text.replace(',', ' ');
+    const QList<QByteArray> fields = text.simplified().split(' ');
+    if (fields.size() < 2)
+        return false;
+
+    bool socOk = false;
+    bool powerOk = false;
+    const double soc = fields.at(0).toDouble(&socOk);
+    const double power = fields.at(1).toDouble(&powerOk);
+    if (!socOk || !powerOk)
+        return false;
+
+    // An optional third field is the sample time in ms since the epoch.
+    qint64 timestamp = 0;
+    if (fields.size() >= 3) {
+        bool timestampOk = false;
+        timestamp = fields.at(2).toLongLong(&timestampOk);
+        if (!timestampOk)
+            timestamp = 0;
+    }
+
+    *point = DataPoint(soc, power, timestamp);
+    return true;
+}
+
+void TelemetryReader::run()
+{
+    if (m_source.startsWith(QLatin1String("socket:"))) {
+        readSocket(m_source.mid(7));
+        return;
+    }
+
+#ifdef Q_OS_UNIX
+    if (m_source == QLatin1String("-") || m_source == QLatin1String("stdin")) {
+        readFileDescriptor(STDIN_FILENO, false);
+        return;
+    }
+
+    // O_NONBLOCK keeps open() on a FIFO from blocking until a writer shows up.
+    const QByteArray path = QFile::encodeName(m_source);
+    const int fd = ::open(path.constData(), O_RDONLY | O_NONBLOCK);
+    if (fd < 0) {
+        emit errorOccurred(tr("Cannot open telemetry source %1").arg(m_source));
+        return;
+    }
+    readFileDescriptor(fd, QFileInfo(m_source).isFile());
+    ::close(fd);
+#else
+    QFile file(m_source);
+    if (!file.open(QIODevice::ReadOnly)) {
+        emit errorOccurred(tr("Cannot open telemetry source %1").arg(m_source));
+        return;
+    }
+    QByteArray buffer(ReadBufferSize, Qt::Uninitialized);
+    while (!isInterruptionRequested()) {
+        const qint64 size = file.read(buffer.data(), buffer.size());
+        if (size > 0)
+            consume(buffer.constData(), size);
+        else
+            msleep(PollIntervalMs);
+    }
+#endif
+}
+
+void TelemetryReader::readSocket(const QString &serverName)
+{
+    QLocalSocket socket;
+    QByteArray buffer(ReadBufferSize, Qt::Uninitialized);
+
+    while (!isInterruptionRequested()) {
+        if (socket.state() != QLocalSocket::ConnectedState) {
+            socket.abort();
+            socket.connectToServer(serverName, QIODevice::ReadOnly);
+            if (!socket.waitForConnected(PollIntervalMs * 10)) {
+                msleep(PollIntervalMs * 10);
+                continue;
+            }
+            m_partialLine.clear();
+        }
+
+        if (!socket.bytesAvailable() && !socket.waitForReadyRead(PollIntervalMs))
+            continue;
+
+        const qint64 size = socket.read(buffer.data(), buffer.size());
+        if (size > 0)
+            consume(buffer.constData(), size);
+    }
+}
+
+void TelemetryReader::readFileDescriptor(int fd, bool follow)
+{
+#ifdef Q_OS_UNIX
+    QByteArray buffer(ReadBufferSize, Qt::Uninitialized);
+    pollfd descriptor;
+    descriptor.fd = fd;
+    descriptor.events = POLLIN;
+
+    while (!isInterruptionRequested()) {
+        if (!follow) {
+            descriptor.revents = 0;
+            if (::poll(&descriptor, 1, PollIntervalMs) <= 0)
+                continue;
+        }
+
+        // End of file on a followed file, or a pipe whose writer went away:
+        // wait for more data or the next writer.
+        const ssize_t size = ::read(fd, buffer.data(), size_t(buffer.size()));
+        if (size > 0)
+            consume(buffer.constData(), qint64(size));
+        else
+            msleep(PollIntervalMs);
+    }
+#else
+    Q_UNUSED(fd)
+    Q_UNUSED(follow)
+#endif
+}
+
+void TelemetryReader::consume(const char *data, qint64 size)
+{
+    GRAPH_TRACE_FUNCTION(TraceIngest);
+    m_partialLine.append(data, int(size));
+
+    int lineStart = 0;
+    for (;;) {
+        const int lineEnd = m_partialLine.indexOf('\n', lineStart);
+        if (lineEnd < 0)
+            break;
+        DataPoint point;
+        if (parseLine(m_partialLine.mid(lineStart, lineEnd - lineStart), &point)) {
+            if (point.getTimestamp() == 0)
+                point.setTimestamp(QDateTime::currentMSecsSinceEpoch());
+            push(point);
+        }
+        lineStart = lineEnd + 1;
+    }
+    m_partialLine.remove(0, lineStart);
+}
+
+void TelemetryReader::push(const DataPoint &point)
+{
+    // Back-pressure instead of dropping: the GUI drains every frame, so a
+    // full queue only lasts until the next one.
+    while (!m_queue->tryPush(point)) {
+        if (isInterruptionRequested())
+            return;
+        GRAPH_TRACE_INSTANT(TraceIngest, "telemetryQueueFull");
+        usleep(500);
+    }
+
+    if (!m_wakePending.exchange(true, std::memory_order_acq_rel))
+        emit samplesAvailable();
+}
@@ -0,0 +1,55 @@
+#ifndef TELEMETRYREADER_H
+#define TELEMETRYREADER_H
+
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <atomic>
+#include "DataPoint.h"
+#include "SpscQueue.h"
+
+class QIODevice;
+
+// Worker thread that reads charger telemetry and parses it off the GUI
+// thread. Each line carries one sample as "soc,power" (commas, semicolons or
+// whitespace separate the fields; '#' starts a comment). Parsed samples go
+// into a single-producer/single-consumer queue; samplesAvailable() is only
+// emitted when the consumer has acknowledged the previous wake-up, so a
+// burst costs one cross-thread notification.
+//
+// Sources: "socket:<name>" for a QLocalSocket server, "-" or "stdin" for
+// standard input, and anything else as a file or named pipe path. Regular
+// files are followed like tail -f.
+class TelemetryReader : public QThread
+{
+    Q_OBJECT
+
+public:
+    TelemetryReader(const QString &source, SpscQueue<DataPoint> *queue, QObject *parent = nullptr);
+    ~TelemetryReader();
+
+    QString source() const;
+    void acknowledgeWake();
+
+    static bool parseLine(const QByteArray &line, DataPoint *point);
+
+signals:
+    void samplesAvailable();
+    void errorOccurred(const QString &message);
+
+protected:
+    void run() override;
+
+private:
+    void readSocket(const QString &serverName);
+    void readFileDescriptor(int fd, bool follow);
+    void consume(const char *data, qint64 size);
+    void push(const DataPoint &point);
+
+    QString m_source;
+    SpscQueue<DataPoint> *m_queue;
+    QByteArray m_partialLine;
+    std::atomic<bool> m_wakePending;
+};
+
+#endif // TELEMETRYREADER_H
@@ -0,0 +1,225 @@
+#include "Trace.h"
+#include <QFile>
+#include <QIODevice>
+#include <QStringList>
+#include <QTextStream>
+#include <QCoreApplication>
+#include <chrono>
+
+namespace {
+
+enum TracePhase : quint8 {
+    PhaseComplete,
+    PhaseInstant,
+    PhaseCounter
+};
+
+// Slots are claimed with a fetch_add on the head and published by storing
+// the claiming index + 1 into sequence last. The dump re-checks the
+// sequence after copying a slot, so events overwritten mid-copy are skipped
+// instead of torn.
+struct TraceEvent
+{
+    std::atomic<quint64> sequence { 0 };
+    std::atomic<const char *> name { nullptr };
+    std::atomic<qint64> timestamp { 0 };
+    std::atomic<qint64> value { 0 };
+    std::atomic<quint32> category { 0 };
+    std::atomic<quint32> threadId { 0 };
+    std::atomic<quint8> phase { PhaseComplete };
+};
+
+struct TraceBuffer
+{
+    std::atomic<quint64> head { 0 };
+    TraceEvent events[Trace::BufferCapacity];
+};
+
+static_assert((Trace::BufferCapacity & (Trace::BufferCapacity - 1)) == 0,
+              "BufferCapacity must be a power of two");
+
+TraceBuffer &buffer()
+{
+    static TraceBuffer instance;
+    return instance;
+}
+
+const std::chrono::steady_clock::time_point &epoch()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+quint32 currentThreadId()
+{
+    static std::atomic<quint32> nextId { 1 };
+    thread_local const quint32 id = nextId.fetch_add(1, std::memory_order_relaxed);
+    return id;
+}
+
+void record(quint32 category, TracePhase phase, const char *name, qint64 timestamp, qint64 value)
+{
+    TraceBuffer &b = buffer();
+    const quint64 index = b.head.fetch_add(1, std::memory_order_relaxed);
+    TraceEvent &event = b.events[index & (Trace::BufferCapacity - 1)];
+
+    event.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    event.name.store(name, std::memory_order_relaxed);
+    event.timestamp.store(timestamp, std::memory_order_relaxed);
+    event.value.store(value, std::memory_order_relaxed);
+    event.category.store(category, std::memory_order_relaxed);
+    event.threadId.store(currentThreadId(), std::memory_order_relaxed);
+    event.phase.store(phase, std::memory_order_relaxed);
+    event.sequence.store(index + 1, std::memory_order_release);
+}
+
+const char *categoryName(quint32 category)
+{
+    switch (category) {
+    case TraceData:
+        return "data";
+    case TraceRender:
+        return "render";
+    case TraceIngest:
+        return "ingest";
+    case TraceUi:
+        return "ui";
+    default:
+        return "other";
+    }
+}
+
+QString jsonEscaped(const char *text)
+{
+    QString escaped = QString::fromUtf8(text);
+    escaped.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+    escaped.replace(QLatin1Char('"'), QLatin1String("\\\""));
+    return escaped;
+}
+
+} // namespace
+
+std::atomic<quint32> Trace::s_enabledCategories { 0 };
+
+void Trace::setEnabledCategories(quint32 categories)
+{
+    epoch();
+    s_enabledCategories.store(categories, std::memory_order_relaxed);
+}
+
+quint32 Trace::enabledCategories()
+{
+    return s_enabledCategories.load(std::memory_order_relaxed);
+}
+
+quint32 Trace::parseCategories(const QString &spec)
+{
+    quint32 categories = 0;
+    const QStringList names = spec.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    for (const QString &name : names) {
+        const QString trimmed = name.trimmed().toLower();
+        if (trimmed == QLatin1String("all") || trimmed == QLatin1String("1"))
+            categories |= TraceAll;
+        else if (trimmed == QLatin1String("data"))
+            categories |= TraceData;
+        else if (trimmed == QLatin1String("render"))
+            categories |= TraceRender;
+        else if (trimmed == QLatin1String("ingest"))
+            categories |= TraceIngest;
+        else if (trimmed == QLatin1String("ui"))
+            categories |= TraceUi;
+    }
+    return categories;
+}
+
+qint64 Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch()).count();
+}
+
+void Trace::complete(quint32 category, const char *name, qint64 start, qint64 duration)
+{
+    record(category, PhaseComplete, name, start, duration);
+}
+
+void Trace::instant(quint32 category, const char *name)
+{
+    record(category, PhaseInstant, name, now(), 0);
+}
+
+void Trace::counter(quint32 category, const char *name, qint64 value)
+{
+    record(category, PhaseCounter, name, now(), value);
+}
+
+bool Trace::writeChromeJson(QIODevice *device)
+{
+    if (!device || !device->isWritable())
+        return false;
+
+    QTextStream out(device);
+    const qint64 pid = QCoreApplication::applicationPid();
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+    TraceBuffer &b = buffer();
+    const quint64 head = b.head.load(std::memory_order_acquire);
+    const quint64 first = head > quint64(BufferCapacity) ? head - BufferCapacity : 0;
+    bool separator = false;
+
+    for (quint64 index = first; index < head; ++index) {
+        TraceEvent &event = b.events[index & (BufferCapacity - 1)];
+        if (event.sequence.load(std::memory_order_acquire) != index + 1)
+            continue;
+
+        const char *name = event.name.load(std::memory_order_relaxed);
+        const qint64 timestamp = event.timestamp.load(std::memory_order_relaxed);
+        const qint64 value = event.value.load(std::memory_order_relaxed);
+        const quint32 category = event.category.load(std::memory_order_relaxed);
+        const quint32 threadId = event.threadId.load(std::memory_order_relaxed);
+        const quint8 phase = event.phase.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (event.sequence.load(std::memory_order_relaxed) != index + 1 || !name)
+            continue;
+
+        if (separator)
+            out << ',';
+        separator = true;
+
+        out << "{\"name\":\"" << jsonEscaped(name) << "\",\"cat\":\"" << categoryName(category)
+            << "\",\"pid\":" << pid << ",\"tid\":" << threadId
+            << ",\"ts\":" << QString::number(timestamp / 1000.0, 'f', 3);
+        switch (phase) {
+        case PhaseComplete:
+            out << ",\"ph\":\"X\",\"dur\":" << QString::number(value / 1000.0, 'f', 3);
+            break;
+        case PhaseInstant:
+            out << ",\"ph\":\"i\",\"s\":\"t\"";
+            break;
+        case PhaseCounter:
+            out << ",\"ph\":\"C\",\"args\":{\"value\":" << value << '}';
+            break;
+        }
+        out << '}';
+    }
+
+    out << "]}\n";
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+bool Trace::dumpToFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return false;
+    return writeChromeJson(&file);
+}
+
+void Trace::clear()
+{
+    TraceBuffer &b = buffer();
+    for (TraceEvent &event : b.events)
+        event.sequence.store(0, std::memory_order_relaxed);
+}
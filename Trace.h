@@ -0,0 +1,93 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QtGlobal>
+#include <QString>
+#include <atomic>
+
+class QIODevice;
+
+// Structured tracing for hot paths. Trace points record into a fixed-size,
+// lock-free ring buffer that can be dumped as Chrome/Perfetto trace JSON on
+// demand. A disabled category costs one relaxed atomic load per trace point,
+// and building without GRAPH_TRACING removes the trace points entirely.
+//
+// Event names must outlive the process (string literals or Q_FUNC_INFO),
+// since only the pointer is stored.
+enum TraceCategory : quint32 {
+    TraceData = 0x1,
+    TraceRender = 0x2,
+    TraceIngest = 0x4,
+    TraceUi = 0x8,
+    TraceAll = 0xffffffff
+};
+
+class Trace
+{
+public:
+    static constexpr int BufferCapacity = 1 << 16;
+
+    static bool isEnabled(quint32 category)
+    {
+        return s_enabledCategories.load(std::memory_order_relaxed) & category;
+    }
+    static void setEnabledCategories(quint32 categories);
+    static quint32 enabledCategories();
+    static quint32 parseCategories(const QString &spec);
+
+    static qint64 now();
+    static void complete(quint32 category, const char *name, qint64 start, qint64 duration);
+    static void instant(quint32 category, const char *name);
+    static void counter(quint32 category, const char *name, qint64 value);
+
+    static bool writeChromeJson(QIODevice *device);
+    static bool dumpToFile(const QString &path);
+    static void clear();
+
+private:
+    static std::atomic<quint32> s_enabledCategories;
+};
+
+class TraceScope
+{
+public:
+    TraceScope(quint32 category, const char *name)
+        : m_name(Trace::isEnabled(category) ? name : nullptr)
+        , m_category(category)
+        , m_start(m_name ? Trace::now() : 0)
+    {
+    }
+
+    ~TraceScope()
+    {
+        if (m_name)
+            Trace::complete(m_category, m_name, m_start, Trace::now() - m_start);
+    }
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+
+    const char *m_name;
+    quint32 m_category;
+    qint64 m_start;
+};
+
+#define GRAPH_TRACE_CONCAT_IMPL(a, b) a##b
+#define GRAPH_TRACE_CONCAT(a, b) GRAPH_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef GRAPH_TRACING
+#define GRAPH_TRACE_SCOPE(category, name) \
+    TraceScope GRAPH_TRACE_CONCAT(graphTraceScope_, __LINE__)(category, name)
+#define GRAPH_TRACE_FUNCTION(category) GRAPH_TRACE_SCOPE(category, Q_FUNC_INFO)
+#define GRAPH_TRACE_INSTANT(category, name) \
+    do { if (Trace::isEnabled(category)) Trace::instant(category, name); } while (0)
+#define GRAPH_TRACE_COUNTER(category, name, value) \
+    do { if (Trace::isEnabled(category)) Trace::counter(category, name, qint64(value)); } while (0)
+#else
+#define GRAPH_TRACE_SCOPE(category, name) do {} while (0)
+#define GRAPH_TRACE_FUNCTION(category) do {} while (0)
+#define GRAPH_TRACE_INSTANT(category, name) do {} while (0)
+#define GRAPH_TRACE_COUNTER(category, name, value) do {} while (0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,40 @@
+#include "TraceController.h"
+#include "Trace.h"
+
+TraceController::TraceController(QObject *parent)
+    : QObject{parent}
+{
+}
+
+QString TraceController::getCategories() const
+{
+    return m_categories;
+}
+
+void TraceController::setCategories(const QString &newCategories)
+{
+    if (m_categories == newCategories)
+        return;
+    m_categories = newCategories;
+    Trace::setEnabledCategories(Trace::parseCategories(m_categories));
+    emit categoriesChanged();
+}
+
+bool TraceController::isCompiledIn() const
+{
+#ifdef GRAPH_TRACING
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool TraceController::dump(const QString &path)
+{
+    return Trace::dumpToFile(path);
+}
+
+void TraceController::clear()
+{
+    Trace::clear();
+}
@@ -0,0 +1,33 @@
+#ifndef TRACECONTROLLER_H
+#define TRACECONTROLLER_H
+
+#include <QObject>
+#include <QString>
+
+// QML-facing switch for the Trace ring buffer, so tracing can be turned on
+// and dumped from a running session.
+class TraceController : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QString categories READ getCategories WRITE setCategories NOTIFY categoriesChanged FINAL)
+    Q_PROPERTY(bool compiledIn READ isCompiledIn CONSTANT FINAL)
+
+public:
+    explicit TraceController(QObject *parent = nullptr);
+
+    QString getCategories() const;
+    void setCategories(const QString &newCategories);
+
+    bool isCompiledIn() const;
+
+    Q_INVOKABLE bool dump(const QString &path);
+    Q_INVOKABLE void clear();
+
+signals:
+    void categoriesChanged();
+
+private:
+    QString m_categories;
+};
+
+#endif // TRACECONTROLLER_H
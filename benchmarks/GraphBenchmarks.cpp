@@ -0,0 +1,410 @@
+#include <QtTest>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <cstring>
+
+#include "AllocationCounter.h"
+#include "CompressedChunk.h"
+#include "DataProvider.h"
+#include "FleetEnvelope.h"
+#include "GraphItem.h"
+
+// Performance regression suite. Run with "-o results.xml,xml" and convert
+// the output with compare_benchmarks.py to get JSON that can be compared
+// against a stored baseline.
+class GraphBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void addPoint_data();
+    void addPoint();
+    void addLatePoint_data();
+    void addLatePoint();
+    void latePointBelowFirst();
+    void setDataPoints_data();
+    void setDataPoints();
+    void reassignDataPoints_data();
+    void reassignDataPoints();
+    void generateRandomData();
+    void compressChunk_data();
+    void compressChunk();
+    void compressedSize_data();
+    void compressedSize();
+    void decodeChunk_data();
+    void decodeChunk();
+    void fleetEnvelope_data();
+    void fleetEnvelope();
+    void paint_data();
+    void paint();
+    void paintAllocations_data();
+    void paintAllocations();
+
+private:
+    static void addCountRows();
+    static QVector<DataPoint> makePoints(int count);
+    static void addChunkRows();
+    static void fillChunk(DataChunk *chunk, bool decimal);
+    static bool sameSample(Sample a, Sample b);
+};
+
+void GraphBenchmarks::addCountRows()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1e2") << 100;
+    QTest::newRow("1e3") << 1000;
+    QTest::newRow("1e4") << 10000;
+    QTest::newRow("1e5") << 100000;
+    QTest::newRow("1e6") << 1000000;
+    QTest::newRow("1e7") << 10000000;
+}
+
+QVector<DataPoint> GraphBenchmarks::makePoints(int count)
+{
+    // SOC-sorted charging curve with a fixed seed, so runs are comparable.
+    QRandomGenerator random(42);
+    QVector<DataPoint> points;
+    points.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const double soc = 100.0 * i / qMax(1, count - 1);
+        const double power = 100.0 + 200.0 * soc / 100.0 + random.bounded(10.0) - 5.0;
+        points.append(DataPoint(soc, power, i));
+    }
+    return points;
+}
+
+void GraphBenchmarks::addPoint_data()
+{
+    addCountRows();
+}
+
+void GraphBenchmarks::addPoint()
+{
+    QFETCH(int, count);
+    const QVector<DataPoint> points = makePoints(count);
+    QBENCHMARK {
+        DataProvider provider;
+        for (const DataPoint &point : points)
+            provider.addPoint(point);
+    }
+}
+
+void GraphBenchmarks::addLatePoint_data()
+{
+    addCountRows();
+}
+
+void GraphBenchmarks::addLatePoint()
+{
+    // Every eighth sample arrives after the next one, as from a telemetry
+    // link that reorders now and then.
+    QFETCH(int, count);
+    QVector<DataPoint> points = makePoints(count);
+    for (int i = 0; i + 1 < points.size(); i += 8)
+        std::swap(points[i], points[i + 1]);
+    QBENCHMARK {
+        DataProvider provider;
+        for (const DataPoint &point : points)
+            provider.addPoint(point);
+    }
+}
+
+void GraphBenchmarks::latePointBelowFirst()
+{
+    // Nothing is sealed yet, so a late sample below the first SOC is still
+    // within reach and goes in front.
+    DataProvider provider;
+    provider.addPoint(DataPoint(50, 100, 1000));
+    provider.addPoint(DataPoint(60, 120, 2000));
+    provider.addPoint(DataPoint(49, 90, 3000));
+    QCOMPARE(provider.getDroppedSampleCount(), 0);
+    const QVector<DataPoint> points = provider.getDataPoints();
+    QCOMPARE(points.size(), 3);
+    QCOMPARE(points.at(0), DataPoint(49, 90, 3000));
+    QCOMPARE(points.at(1), DataPoint(50, 100, 1000));
+    QCOMPARE(points.at(2), DataPoint(60, 120, 2000));
+}
+
+void GraphBenchmarks::setDataPoints_data()
+{
+    addCountRows();
+}
+
+void GraphBenchmarks::setDataPoints()
+{
+    QFETCH(int, count);
+    const QVector<DataPoint> points = makePoints(count);
+    QBENCHMARK {
+        DataProvider provider;
+        provider.setDataPoints(points);
+    }
+}
+
+void GraphBenchmarks::reassignDataPoints_data()
+{
+    addCountRows();
+}
+
+void GraphBenchmarks::reassignDataPoints()
+{
+    // Setting equal points again, from a vector that shares nothing with
+    // the provider, as replay tooling does.
+    QFETCH(int, count);
+    DataProvider provider;
+    provider.setRawRetention(0);
+    provider.setDataPoints(makePoints(count));
+    const QVector<DataPoint> points = makePoints(count);
+    QBENCHMARK {
+        provider.setDataPoints(points);
+    }
+}
+
+void GraphBenchmarks::generateRandomData()
+{
+    DataProvider provider;
+    QBENCHMARK {
+        provider.generateRandomData();
+    }
+}
+
+void GraphBenchmarks::addChunkRows()
+{
+    QTest::addColumn<bool>("decimal");
+    QTest::newRow("decimal") << true;
+    QTest::newRow("xor") << false;
+}
+
+void GraphBenchmarks::fillChunk(DataChunk *chunk, bool decimal)
+{
+    QRandomGenerator random(42);
+    for (int i = 0; i < DataChunk::Capacity; ++i) {
+        // Jittered 1 s samples, so timestamp deltas shrink as well as grow.
+        const qint64 timestamp = 1700000000000LL + i * 1000LL + random.bounded(40) - 20;
+        if (decimal) {
+            // What a charger reports: SOC and power in 0.1 steps, power
+            // falling as often as rising and briefly negative while the
+            // charger backs off.
+            const double soc = qRound(200.0 + 600.0 * i / DataChunk::Capacity) / 10.0;
+            const double power = i % 512 < 8 ? -qRound(random.bounded(50.0)) / 10.0
+                                             : qRound(1500.0 + random.bounded(100.0) - 50.0) / 10.0;
+            chunk->append(DataPoint(soc, power, timestamp));
+        } else {
+            // Raw measurements that are no short decimals, with the values
+            // the XOR coding has to keep bit exact: NaN for a dropout, and
+            // signed zeros.
+            const double soc = 20.0 + 60.0 * i / 3001.0;
+            double power = 150.0 * qSin(i / 97.0) + random.generateDouble() - 0.5;
+            if (i % 256 == 100)
+                power = qQNaN();
+            else if (i % 256 == 200)
+                power = 0.0;
+            else if (i % 256 == 201)
+                power = -0.0;
+            chunk->append(DataPoint(i % 1024 == 512 ? -0.0 : soc, power, timestamp));
+        }
+    }
+}
+
+bool GraphBenchmarks::sameSample(Sample a, Sample b)
+{
+    // Bitwise, so that NaN matches NaN and -0.0 does not match 0.0.
+    return std::memcmp(&a, &b, sizeof(Sample)) == 0;
+}
+
+void GraphBenchmarks::compressChunk_data()
+{
+    addChunkRows();
+}
+
+void GraphBenchmarks::compressChunk()
+{
+    QFETCH(bool, decimal);
+    DataChunk chunk;
+    fillChunk(&chunk, decimal);
+    QBENCHMARK {
+        const CompressedChunk compressed(chunk);
+        Q_UNUSED(compressed)
+    }
+}
+
+void GraphBenchmarks::compressedSize_data()
+{
+    // Most bytes per point the encoding may take: a quarter of the plain
+    // columns for telemetry, less than the plain columns otherwise.
+    QTest::addColumn<bool>("decimal");
+    QTest::addColumn<double>("maxShare");
+    QTest::newRow("decimal") << true << 0.25;
+    QTest::newRow("xor") << false << 1.0;
+}
+
+void GraphBenchmarks::compressedSize()
+{
+    // A size bound rather than a benchmark result: the ratio is no time or
+    // allocation count, so QtTest has no metric for it.
+    QFETCH(bool, decimal);
+    QFETCH(double, maxShare);
+    DataChunk chunk;
+    fillChunk(&chunk, decimal);
+    const CompressedChunk compressed(chunk);
+    const double bytesPerPoint = double(compressed.byteSize()) / chunk.size();
+    const double plainBytesPerPoint = 2 * sizeof(Sample) + sizeof(qint64);
+    QVERIFY2(bytesPerPoint < maxShare * plainBytesPerPoint,
+             qPrintable(QString("%1 bytes per point, %2 uncompressed").arg(bytesPerPoint).arg(plainBytesPerPoint)));
+}
+
+void GraphBenchmarks::decodeChunk_data()
+{
+    addChunkRows();
+}
+
+void GraphBenchmarks::decodeChunk()
+{
+    QFETCH(bool, decimal);
+    DataChunk chunk;
+    fillChunk(&chunk, decimal);
+    const CompressedChunk compressed(chunk);
+    QVector<Sample> soc(chunk.size());
+    QVector<Sample> power(chunk.size());
+    QVector<qint64> timestamp(chunk.size());
+    QBENCHMARK {
+        CompressedChunk::Reader reader(compressed);
+        reader.read(soc.data(), power.data(), timestamp.data(), chunk.size());
+    }
+    for (int i = 0; i < chunk.size(); ++i) {
+        QVERIFY2(sameSample(soc.at(i), chunk.socData()[i]), qPrintable(QString::number(i)));
+        QVERIFY2(sameSample(power.at(i), chunk.powerData()[i]), qPrintable(QString::number(i)));
+        QCOMPARE(timestamp.at(i), chunk.timestampData()[i]);
+    }
+}
+
+void GraphBenchmarks::fleetEnvelope_data()
+{
+    QTest::addColumn<int>("sessions");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1000") << 1000;
+    QTest::newRow("5000") << 5000;
+}
+
+void GraphBenchmarks::fleetEnvelope()
+{
+    QFETCH(int, sessions);
+    // Sessions of 1 s samples that start and end at different SOC and
+    // charge at different rates.
+    QRandomGenerator random(42);
+    QVector<DataSnapshot> fleet;
+    fleet.reserve(sessions);
+    for (int session = 0; session < sessions; ++session) {
+        const double startSoc = random.bounded(40.0);
+        const double endSoc = 60.0 + random.bounded(40.0);
+        const int count = 1000 + random.bounded(3000);
+        const double peak = 150.0 + random.bounded(200.0);
+        QVector<DataPoint> points;
+        points.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            const double soc = startSoc + (endSoc - startSoc) * i / (count - 1);
+            const double power = peak * (soc < 50.0 ? 1.0 : 1.0 - (soc - 50.0) / 60.0) + random.bounded(10.0) - 5.0;
+            points.append(DataPoint(soc, power, i * 1000LL));
+        }
+        fleet.append(DataSnapshot::fromPoints(points));
+    }
+
+    PowerEnvelope envelope;
+    QBENCHMARK {
+        envelope = FleetEnvelope::compute(fleet, FleetEnvelope::DefaultSocStep);
+    }
+    QCOMPARE(envelope.sessionCount, sessions);
+    QVERIFY(envelope.lower.at(500) <= envelope.median.at(500));
+    QVERIFY(envelope.median.at(500) <= envelope.upper.at(500));
+}
+
+void GraphBenchmarks::paint_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<int>("count");
+    const QList<QSize> sizes = { QSize(640, 480), QSize(1920, 1080), QSize(3840, 2160) };
+    const QList<int> counts = { 1000, 100000, 1000000 };
+    for (const QSize &size : sizes) {
+        for (int count : counts) {
+            const QByteArray tag = QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height())
+                                   + '/' + QByteArray::number(count);
+            QTest::newRow(tag.constData()) << size << count;
+        }
+    }
+}
+
+void GraphBenchmarks::paint()
+{
+    QFETCH(QSize, size);
+    QFETCH(int, count);
+
+    DataProvider provider;
+    provider.setDataPoints(makePoints(count));
+    GraphItem item;
+    item.setGraphPointsProvider(&provider);
+    item.setSize(QSizeF(size));
+
+    // Points are mapped on the first paint; measure the steady state.
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    {
+        QPainter painter(&image);
+        item.paint(&painter);
+    }
+    QBENCHMARK {
+        image.fill(Qt::transparent);
+        QPainter painter(&image);
+        item.paint(&painter);
+    }
+}
+
+void GraphBenchmarks::paintAllocations_data()
+{
+    QTest::addColumn<bool>("zoomed");
+    QTest::newRow("full") << false;
+    QTest::newRow("zoomed") << true;
+}
+
+void GraphBenchmarks::paintAllocations()
+{
+    // Heap allocations of one steady-state paint, reported as a result
+    // rather than asserted so compare_benchmarks.py flags any increase.
+    // Everything on our side of the paint path is allocation free; what
+    // QPainter and the raster engine allocate (state per save(), clip data,
+    // stroker buffers) depends on the Qt version, so there is no fixed
+    // expected count.
+    if (!AllocationCounter::isEnabled())
+        QSKIP("Needs a debug build, which sets GRAPH_COUNT_ALLOCATIONS");
+    QFETCH(bool, zoomed);
+
+    DataProvider provider;
+    provider.setDataPoints(makePoints(100000));
+    GraphItem item;
+    item.setGraphPointsProvider(&provider);
+    item.setSize(QSizeF(1920, 1080));
+    if (zoomed)
+        item.setViewport(20, 60);
+
+    QImage image(1920, 1080, QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&image);
+    // Warm up the mapping buffers, text layouts and chrome layer.
+    item.paint(&painter);
+    item.paint(&painter);
+
+    const AllocationScope scope;
+    item.paint(&painter);
+    QTest::setBenchmarkResult(qreal(scope.allocations()), QTest::Events);
+}
+
+int main(int argc, char *argv[])
+{
+    // GraphItem needs a GUI application but no screen.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    QGuiApplication app(argc, argv);
+    GraphBenchmarks benchmarks;
+    return QTest::qExec(&benchmarks, argc, argv);
+}
+
+#include "GraphBenchmarks.moc"
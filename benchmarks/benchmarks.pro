@@ -0,0 +1,80 @@
+TEMPLATE = app
+TARGET = GraphBenchmarks
+QT += quick network svg testlib
+CONFIG += cmdline
+
+# Same feature switches as the application.
+CONFIG += graph_tracing
+graph_tracing: DEFINES += GRAPH_TRACING
+graph_float_samples: DEFINES += GRAPH_FLOAT_SAMPLES
+# Heap allocation counting (AllocationCounter) in debug builds; only the
+# benchmarks set this, it replaces the global allocation functions.
+CONFIG(debug, debug|release): DEFINES += GRAPH_COUNT_ALLOCATIONS
+
+INCLUDEPATH += ..
+
+SOURCES += \
+    GraphBenchmarks.cpp \
+    ../AllocationCounter.cpp \
+    ../BatchRenderer.cpp \
+    ../CompressedChunk.cpp \
+    ../DataChunk.cpp \
+    ../DataPoint.cpp \
+    ../DataPointModel.cpp \
+    ../DataProvider.cpp \
+    ../DataSnapshot.cpp \
+    ../Decimator.cpp \
+    ../FleetEnvelope.cpp \
+    ../FrameScheduler.cpp \
+    ../GeometryWorker.cpp \
+    ../GraphItem.cpp \
+    ../GraphNode.cpp \
+    ../GraphRenderer.cpp \
+    ../PointKernels.cpp \
+    ../PowerStatistics.cpp \
+    ../ProviderRegistry.cpp \
+    ../QuantileSketch.cpp \
+    ../RenderCache.cpp \
+    ../ReplayController.cpp \
+    ../ReplaySource.cpp \
+    ../RollupTier.cpp \
+    ../SessionFile.cpp \
+    ../SessionWriter.cpp \
+    ../TelemetryIngestor.cpp \
+    ../TelemetryReader.cpp \
+    ../Trace.cpp \
+    ../TraceController.cpp
+
+HEADERS += \
+    ../AllocationCounter.h \
+    ../BatchRenderer.h \
+    ../CompressedChunk.h \
+    ../DataChunk.h \
+    ../DataPoint.h \
+    ../DataPointModel.h \
+    ../DataProvider.h \
+    ../DataSnapshot.h \
+    ../Decimator.h \
+    ../FleetEnvelope.h \
+    ../FrameScheduler.h \
+    ../GeometryWorker.h \
+    ../GraphItem.h \
+    ../GraphNode.h \
+    ../GraphRenderer.h \
+    ../PointKernels.h \
+    ../PowerEnvelope.h \
+    ../PowerStatistics.h \
+    ../ProviderRegistry.h \
+    ../QuantileSketch.h \
+    ../RenderCache.h \
+    ../ReplayController.h \
+    ../ReplaySource.h \
+    ../RollupTier.h \
+    ../ScratchArena.h \
+    ../SessionFile.h \
+    ../SessionWriter.h \
+    ../SpscQueue.h \
+    ../TelemetryIngestor.h \
+    ../TelemetryReader.h \
+    ../Trace.h \
+    ../TraceController.h
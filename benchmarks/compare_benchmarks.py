@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Convert GraphBenchmarks results to JSON and compare them against a baseline.
+
+    compare_benchmarks.py convert results.xml results.json
+    compare_benchmarks.py compare baseline.json results.json [--threshold 10]
+
+"convert" reads the QtTest XML log ("GraphBenchmarks -o results.xml,xml").
+"compare" prints every benchmark with its relative change and exits with
+status 1 when any of them got slower by more than the threshold (percent).
+"""
+
+import argparse
+import json
+import sys
+import xml.etree.ElementTree as ET
+
+
+def convert(xml_path, json_path):
+    root = ET.parse(xml_path).getroot()
+    results = []
+    for function in root.iter("TestFunction"):
+        for result in function.iter("BenchmarkResult"):
+            tag = result.get("tag", "")
+            name = function.get("name") + ("/" + tag if tag else "")
+            results.append({
+                "name": name,
+                "metric": result.get("metric"),
+                # QtTest reports the per-iteration value.
+                "value": float(result.get("value")),
+                "iterations": int(result.get("iterations")),
+            })
+    with open(json_path, "w") as out:
+        json.dump({"benchmarks": results}, out, indent=2)
+        out.write("\n")
+    return 0
+
+
+def load(path):
+    with open(path) as f:
+        return {b["name"]: b for b in json.load(f)["benchmarks"]}
+
+
+def compare(baseline_path, current_path, threshold, min_value):
+    baseline = load(baseline_path)
+    current = load(current_path)
+    regressions = 0
+    for name in sorted(current):
+        value = current[name]["value"]
+        if name not in baseline:
+            print("%-40s %12.4f  (new)" % (name, value))
+            continue
+        base = baseline[name]["value"]
+        if base > 0:
+            change = (value - base) / base * 100.0
+        else:
+            # Counters such as paintAllocations have a baseline of zero.
+            change = float("inf") if value > 0 else 0.0
+        regressed = change > threshold and max(value, base) >= min_value
+        regressions += regressed
+        print("%-40s %12.4f %12.4f %+8.1f%%%s"
+              % (name, base, value, change, "  REGRESSION" if regressed else ""))
+    for name in sorted(set(baseline) - set(current)):
+        print("%-40s  (missing)" % name)
+    if regressions:
+        print("%d benchmark(s) regressed by more than %.1f%%" % (regressions, threshold))
+    return 1 if regressions else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    convert_parser = commands.add_parser("convert")
+    convert_parser.add_argument("xml")
+    convert_parser.add_argument("json")
+    compare_parser = commands.add_parser("compare")
+    compare_parser.add_argument("baseline")
+    compare_parser.add_argument("current")
+    compare_parser.add_argument("--threshold", type=float, default=10.0,
+                                help="allowed slowdown in percent (default 10)")
+    compare_parser.add_argument("--min-value", type=float, default=0.0,
+                                help="ignore results whose value is below this, as they are mostly noise")
+    args = parser.parse_args()
+
+    if args.command == "convert":
+        return convert(args.xml, args.json)
+    return compare(args.baseline, args.current, args.threshold, args.min_value)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -2,10 +2,21 @@
 #include <QQmlApplicationEngine>
 #include <QQmlContext>
 #include <QtQml>
+#include <QCommandLineParser>
+#include <QQuickWindow>
 
 #include "GraphItem.h"
+#include "FrameScheduler.h"
 #include "DataProvider.h"
+#include "DataPointModel.h"
+#include "FleetEnvelope.h"
+#include "ProviderRegistry.h"
 #include "DataPoint.h"
+#include "TraceController.h"
+#include "TelemetryIngestor.h"
+#include "SessionWriter.h"
+#include "ReplayController.h"
+#include "BatchRenderer.h"
 
 int main(int argc, char *argv[])
 {
@@ -13,19 +24,108 @@ int main(int argc, char *argv[])
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
 
+    if (BatchRenderer::isBatchInvocation(argc, argv)) {
+        // Headless export: no window and no QML engine, so no display is needed.
+        if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        QGuiApplication app(argc, argv);
+        return BatchRenderer::exec(app.arguments());
+    }
+
     QGuiApplication app(argc, argv);
 
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption telemetryOption(QStringList() << "t" << "telemetry",
+                                       "Read live telemetry from <source>: a file or pipe path, "
+                                       "\"-\" for stdin, or socket:<name> for a local socket.",
+                                       "source");
+    parser.addOption(telemetryOption);
+    QCommandLineOption sessionOption(QStringList() << "s" << "session",
+                                     "Open the recorded session <file> instead of generating data.",
+                                     "file");
+    parser.addOption(sessionOption);
+    QCommandLineOption recordOption(QStringList() << "r" << "record",
+                                    "Record the displayed data to the session <file>.",
+                                    "file");
+    parser.addOption(recordOption);
+    QCommandLineOption replayOption("replay",
+                                    "Replay the session or CSV log <file> into the graph.",
+                                    "file");
+    parser.addOption(replayOption);
+    QCommandLineOption replayRateOption("replay-rate",
+                                        "Playback speed for --replay, 0 for as fast as possible (default 1).",
+                                        "rate", "1");
+    parser.addOption(replayRateOption);
+    QCommandLineOption baysOption("bays",
+                                  "Show a dashboard of <count> charger bays with generated data "
+                                  "instead of the single graph.",
+                                  "count", "0");
+    parser.addOption(baysOption);
+    QCommandLineOption fleetOption("fleet",
+                                   "Draw the P10-P90 power envelope of the recorded session <file> "
+                                   "behind the graphs; repeat for every session of the fleet.",
+                                   "file");
+    parser.addOption(fleetOption);
+    parser.process(app);
+
     qmlRegisterType<GraphItem>("GraphComponents", 1, 0, "GraphItem");
     qmlRegisterType<DataProvider>("GraphComponents", 1, 0, "DataProvider");
+    qmlRegisterType<DataPointModel>("GraphComponents", 1, 0, "DataPointModel");
+    qmlRegisterType<FleetEnvelope>("GraphComponents", 1, 0, "FleetEnvelope");
     qmlRegisterUncreatableType<DataPoint>("GraphComponents", 1, 0, "DataPoint",
                                           "DataPoint can only be created in C++");
+    qmlRegisterUncreatableType<FrameScheduler>("GraphComponents", 1, 0, "FrameScheduler",
+                                               "FrameScheduler is created per window by GraphItem");
+
+    // GRAPH_TRACE=all (or a list such as "render,data") enables trace points
+    // from startup; GRAPH_TRACE_FILE is where the buffer is written on exit.
+    TraceController *traceController = new TraceController(&app);
+    traceController->setCategories(qEnvironmentVariable("GRAPH_TRACE"));
+    const QString traceFile = qEnvironmentVariable("GRAPH_TRACE_FILE");
+    if (!traceFile.isEmpty()) {
+        QObject::connect(&app, &QCoreApplication::aboutToQuit, traceController, [traceController, traceFile]() {
+            traceController->dump(traceFile);
+        });
+    }
+
+    ProviderRegistry *providerRegistry = new ProviderRegistry(&app);
+    const int bayCount = parser.value(baysOption).toInt();
+    for (int bay = 1; bay <= bayCount; ++bay)
+        providerRegistry->ensureProvider(QString("bay-%1").arg(bay, 2, 10, QChar('0')))->startRandomGeneration();
+
+    FleetEnvelope *fleetEnvelope = new FleetEnvelope(&app);
+    if (parser.isSet(fleetOption))
+        fleetEnvelope->loadSessions(parser.values(fleetOption));
 
     DataProvider *dataProvider = new DataProvider(&app);
 
-    dataProvider->startRandomGeneration();
+    TelemetryIngestor *telemetryIngestor = new TelemetryIngestor(dataProvider, &app);
+    const bool sessionOpened = parser.isSet(sessionOption)
+                               && dataProvider->openSession(parser.value(sessionOption));
+    ReplayController *replayController = new ReplayController(dataProvider, &app);
+    replayController->setRate(parser.value(replayRateOption).toDouble());
+    const bool replaying = parser.isSet(replayOption) && replayController->open(parser.value(replayOption));
+    if (replaying)
+        replayController->play();
+    else if (parser.isSet(telemetryOption))
+        telemetryIngestor->start(parser.value(telemetryOption));
+    else if (!sessionOpened && bayCount == 0)
+        dataProvider->startRandomGeneration();
+
+    SessionWriter *sessionWriter = new SessionWriter(dataProvider, &app);
+    if (parser.isSet(recordOption))
+        sessionWriter->start(parser.value(recordOption));
+    QObject::connect(&app, &QCoreApplication::aboutToQuit, sessionWriter, &SessionWriter::stop);
 
     QQmlApplicationEngine engine;
     engine.rootContext()->setContextProperty("primaryDataProvider", dataProvider);
+    engine.rootContext()->setContextProperty("traceController", traceController);
+    engine.rootContext()->setContextProperty("telemetryIngestor", telemetryIngestor);
+    engine.rootContext()->setContextProperty("sessionWriter", sessionWriter);
+    engine.rootContext()->setContextProperty("replayController", replayController);
+    engine.rootContext()->setContextProperty("providerRegistry", providerRegistry);
+    engine.rootContext()->setContextProperty("fleetEnvelope", fleetEnvelope);
 
 
     const QUrl url(QStringLiteral("qrc:/main.qml"));
@@ -42,5 +142,8 @@ int main(int argc, char *argv[])
 
     engine.load(url);
 
+    if (!engine.rootObjects().isEmpty())
+        telemetryIngestor->setFrameWindow(qobject_cast<QQuickWindow *>(engine.rootObjects().first()));
+
     return app.exec();
 }
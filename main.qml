@@ -15,12 +15,57 @@ Window {
         id: lineGraph
         anchors.fill: parent
         dataProvider: primaryDataProvider
+        envelope: fleetEnvelope
+        visible: providerRegistry.count === 0
     }
+
+    DashboardGrid {
+        anchors.fill: parent
+        registry: providerRegistry
+        envelope: fleetEnvelope
+        visible: providerRegistry.count > 0
+    }
+    Row {
+        anchors.bottom: buttonRow.top
+        anchors.horizontalCenter: parent.horizontalCenter
+        anchors.bottomMargin: 10
+        spacing: 10
+        visible: replayController.source !== ""
+
+        Button {
+            text: replayController.playing ? "Pause" : "Play"
+            onClicked: replayController.playing ? replayController.pause() : replayController.play()
+        }
+
+        Button {
+            text: "Step"
+            onClicked: replayController.step(1)
+        }
+
+        Slider {
+            width: 240
+            from: 0
+            to: Math.max(1, replayController.sampleCount)
+            value: replayController.position
+            enabled: replayController.sampleCount > 0
+            onMoved: replayController.seek(Math.round(value))
+        }
+
+        Text {
+            anchors.verticalCenter: parent.verticalCenter
+            color: "white"
+            text: replayController.position + " samples, "
+                  + Math.round(replayController.samplesPerSecond) + "/s"
+        }
+    }
+
     Row {
+        id: buttonRow
         anchors.bottom: parent.bottom
         anchors.horizontalCenter: parent.horizontalCenter
         anchors.bottomMargin: 20
         spacing: 20
+        visible: providerRegistry.count === 0
 
         Button {
             text: "Generate New Data"